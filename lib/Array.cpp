@@ -0,0 +1,174 @@
+#include "lib/Array.hpp"
+#include "lib/Error.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+using namespace loxlang;
+
+std::size_t Array::size() const {
+  return std::visit([](const auto &v) { return v.size(); }, elements);
+}
+
+Value Array::get(std::size_t index) const {
+  lox_assert(index < size(), "array index in range");
+  if (isNumeric()) {
+    return Value(numbers()[index]);
+  }
+  return std::get<std::vector<Value>>(elements)[index];
+}
+
+void Array::set(std::size_t index, Value value) {
+  lox_assert(index < size(), "array index in range");
+  if (isNumeric() && value.type() == Value::Type::Number) {
+    numbers()[index] = value.getNumber();
+  } else {
+    boxed()[index] = std::move(value);
+  }
+}
+
+std::size_t Array::footprint() const {
+  if (isNumeric()) {
+    return sizeof(Array) +
+           std::get<std::vector<double>>(elements).capacity() * sizeof(double);
+  }
+  return sizeof(Array) +
+         std::get<std::vector<Value>>(elements).capacity() * sizeof(Value);
+}
+
+/**
+ * @brief Make room for one more element, charging the heap before the
+ * elements grow.
+ */
+template <typename T> void Array::reserveOne(std::vector<T> &v) {
+  if (v.size() < v.capacity()) {
+    return;
+  }
+  std::size_t capacity = std::max<std::size_t>(4, 2 * v.capacity());
+  charge.resize(footprint() + (capacity - v.capacity()) * sizeof(T));
+  v.reserve(capacity);
+}
+
+void Array::push(Value value) {
+  if (isNumeric() && value.type() == Value::Type::Number) {
+    auto &unboxed = std::get<std::vector<double>>(elements);
+    reserveOne(unboxed);
+    unboxed.push_back(value.getNumber());
+  } else {
+    std::vector<Value> &values = boxed();
+    reserveOne(values);
+    values.push_back(std::move(value));
+  }
+}
+
+std::vector<Value> &Array::boxed() {
+  if (isNumeric()) {
+    std::span<const double> unboxed = numbers();
+    charge.resize(sizeof(Array) + unboxed.size() * sizeof(Value));
+    std::vector<Value> values(unboxed.begin(), unboxed.end());
+    elements = std::move(values);
+  }
+  return std::get<std::vector<Value>>(elements);
+}
+
+void loxlang::format(std::string &out, const Array &array) {
+  out += '[';
+  for (std::size_t i = 0; i < array.size(); ++i) {
+    out += i == 0 ? "" : ", ";
+    format(out, array.get(i));
+  }
+  out += ']';
+}
+
+std::ostream &loxlang::operator<<(std::ostream &out, const Array &array) {
+  std::string text;
+  format(text, array);
+  return out << text;
+}
+
+namespace {
+
+/**
+ * @brief The number of independent accumulators of a reduction.
+ * @details Enough to fill an AVX-512 register, or two AVX2 registers.
+ */
+constexpr std::size_t lanes = 8;
+
+template <typename F> double reduce(std::size_t n, F &&term) {
+  std::array<double, lanes> acc{};
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    for (std::size_t l = 0; l < lanes; ++l) {
+      acc[l] += term(i + l);
+    }
+  }
+  double result = 0;
+  for (; i < n; ++i) {
+    result += term(i);
+  }
+  for (double a : acc) {
+    result += a;
+  }
+  return result;
+}
+
+template <typename F>
+void transform(std::span<const double> xs, std::span<double> out, F &&f) {
+  lox_assert_eq(xs.size(), out.size(), "same length");
+  const double *in = xs.data();
+  double *result = out.data();
+  for (std::size_t i = 0; i < xs.size(); ++i) {
+    result[i] = f(in[i]);
+  }
+}
+
+} // namespace
+
+double kernels::sum(std::span<const double> xs) {
+  return reduce(xs.size(), [xs](std::size_t i) { return xs[i]; });
+}
+
+double kernels::dot(std::span<const double> xs, std::span<const double> ys) {
+  lox_assert_eq(xs.size(), ys.size(), "same length");
+  return reduce(xs.size(), [xs, ys](std::size_t i) { return xs[i] * ys[i]; });
+}
+
+void kernels::scale(std::span<const double> xs, double factor,
+                    std::span<double> out) {
+  transform(xs, out, [factor](double x) { return x * factor; });
+}
+
+void kernels::map(std::span<const double> xs, UnaryOp op,
+                  std::span<double> out) {
+  // one loop per operation, so that each one vectorizes on its own
+  switch (op) {
+  case UnaryOp::Abs:
+    transform(xs, out, [](double x) { return std::fabs(x); });
+    break;
+  case UnaryOp::Negate:
+    transform(xs, out, [](double x) { return -x; });
+    break;
+  case UnaryOp::Sqrt:
+    transform(xs, out, [](double x) { return std::sqrt(x); });
+    break;
+  case UnaryOp::Square:
+    transform(xs, out, [](double x) { return x * x; });
+    break;
+  case UnaryOp::Floor:
+    transform(xs, out, [](double x) { return std::floor(x); });
+    break;
+  case UnaryOp::Ceil:
+    transform(xs, out, [](double x) { return std::ceil(x); });
+    break;
+  default: lox_fail("bad unary op");
+  }
+}
+
+void kernels::sort(std::span<double> xs) {
+  // NaNs do not compare, keep them out of the way of std::sort
+  auto nans =
+      std::ranges::partition(xs, [](double x) { return !std::isnan(x); });
+  std::ranges::sort(xs.begin(), nans.begin());
+}
@@ -0,0 +1,104 @@
+#ifndef LOXLANG_LIB_ARRAY_HPP
+#define LOXLANG_LIB_ARRAY_HPP
+
+#include "lib/Heap.hpp"
+#include "lib/Objects.hpp"
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace loxlang {
+
+/**
+ * @brief The Lox array: a contiguous sequence of values.
+ * @details As long as an array only holds numbers, they are stored unboxed
+ * as plain `double`s, which the bulk operations in `kernels` work on
+ * directly. Storing anything else switches the array to boxed `Value`s for
+ * good.
+ *
+ * Arrays are shared by reference (`Value` holds a `std::shared_ptr`). An
+ * array that (indirectly) contains itself is never freed. The elements are
+ * charged to the heap the array was created on.
+ */
+class Array {
+public:
+  explicit Array(std::vector<double> numbers)
+      : elements{std::move(numbers)}, charge{HeapKind::Array, footprint()} {}
+  explicit Array(std::vector<Value> values)
+      : elements{std::move(values)}, charge{HeapKind::Array, footprint()} {}
+
+  std::size_t size() const;
+
+  /**
+   * @brief Whether the elements are stored as unboxed numbers.
+   */
+  bool isNumeric() const {
+    return std::holds_alternative<std::vector<double>>(elements);
+  }
+
+  /**
+   * @brief The unboxed elements of a numeric array.
+   */
+  std::span<double> numbers() {
+    return std::get<std::vector<double>>(elements);
+  }
+  std::span<const double> numbers() const {
+    return std::get<std::vector<double>>(elements);
+  }
+
+  Value get(std::size_t index) const;
+  void set(std::size_t index, Value value);
+  void push(Value value);
+
+private:
+  std::vector<Value> &boxed();
+  std::size_t footprint() const;
+  template <typename T> void reserveOne(std::vector<T> &v);
+
+  std::variant<std::vector<double>, std::vector<Value>> elements;
+  HeapCharge charge;
+};
+
+void format(std::string &out, const Array &array);
+std::ostream &operator<<(std::ostream &out, const Array &array);
+
+/**
+ * @brief Bulk operations on numbers.
+ * @details The loops keep several independent accumulators (or none at all),
+ * so that the compiler can turn them into SIMD instructions without having to
+ * reorder floating point operations itself.
+ */
+namespace kernels {
+
+double sum(std::span<const double> xs);
+
+/**
+ * @brief Dot product of two sequences of the same length.
+ */
+double dot(std::span<const double> xs, std::span<const double> ys);
+
+/**
+ * @brief `out[i] = xs[i] * factor`; `out` may be `xs`.
+ */
+void scale(std::span<const double> xs, double factor, std::span<double> out);
+
+enum class UnaryOp : std::uint8_t { Abs, Negate, Sqrt, Square, Floor, Ceil };
+
+/**
+ * @brief `out[i] = op(xs[i])`; `out` may be `xs`.
+ */
+void map(std::span<const double> xs, UnaryOp op, std::span<double> out);
+
+/**
+ * @brief Sort ascending, NaNs last.
+ */
+void sort(std::span<double> xs);
+
+} // namespace kernels
+
+} // namespace loxlang
+
+#endif
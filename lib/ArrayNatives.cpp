@@ -0,0 +1,111 @@
+#include "lib/ArrayNatives.hpp"
+#include "lib/Array.hpp"
+#include "lib/Heap.hpp"
+#include "lib/Map.hpp"
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace loxlang;
+using namespace loxlang::interpret;
+
+namespace {
+
+using ArrayPtr = std::shared_ptr<Array>;
+
+std::size_t lengthArg(double n) {
+  if (!(n >= 0) || n != std::floor(n)) {
+    throw NativeError("Expected a non-negative integer length");
+  }
+  if (n > static_cast<double>(std::vector<double>().max_size())) {
+    throw NativeError("Array length is out of range");
+  }
+  auto length = static_cast<std::size_t>(n);
+  Heap::reserve(length * sizeof(double));
+  return length;
+}
+
+std::span<double> numbersOf(const ArrayPtr &array) {
+  if (!array->isNumeric()) {
+    throw NativeError("Expected an array of numbers");
+  }
+  return array->numbers();
+}
+
+/**
+ * @brief Room for the result of an element-wise operation on `xs`, charged
+ * to the heap before it is allocated.
+ */
+std::vector<double> resultFor(std::span<const double> xs) {
+  Heap::reserve(xs.size() * sizeof(double));
+  return std::vector<double>(xs.size());
+}
+
+kernels::UnaryOp unaryOp(const std::string &name) {
+  static const std::unordered_map<std::string, kernels::UnaryOp> ops = {
+      {"abs", kernels::UnaryOp::Abs},     {"neg", kernels::UnaryOp::Negate},
+      {"sqrt", kernels::UnaryOp::Sqrt},   {"square", kernels::UnaryOp::Square},
+      {"floor", kernels::UnaryOp::Floor}, {"ceil", kernels::UnaryOp::Ceil},
+  };
+  auto op = ops.find(name);
+  if (op == ops.end()) {
+    throw NativeError("Unknown operation '" + name + "'");
+  }
+  return op->second;
+}
+
+} // namespace
+
+void interpret::defineArrayNatives(NativeRegistry &natives) {
+  natives.bind("array", [](double n) {
+    return std::make_shared<Array>(std::vector<double>(lengthArg(n)));
+  });
+  natives.bind("range", [](double n) {
+    std::vector<double> numbers(lengthArg(n));
+    for (std::size_t i = 0; i < numbers.size(); ++i) {
+      numbers[i] = static_cast<double>(i);
+    }
+    return std::make_shared<Array>(std::move(numbers));
+  });
+  natives.bind("len", [](const Value &v) {
+    switch (v.type()) {
+    case Value::Type::Array: return static_cast<double>(v.getArray()->size());
+    case Value::Type::Map: return static_cast<double>(v.getMap()->size());
+    default: throw NativeError("Expected an array or a map");
+    }
+  });
+  natives.bind("push", [](const ArrayPtr &a, const Value &v) {
+    a->push(v);
+    return a;
+  });
+  natives.bind("sum", [](const ArrayPtr &a) {
+    return kernels::sum(numbersOf(a));
+  });
+  natives.bind("dot", [](const ArrayPtr &a, const ArrayPtr &b) {
+    std::span<const double> xs = numbersOf(a);
+    std::span<const double> ys = numbersOf(b);
+    if (xs.size() != ys.size()) {
+      throw NativeError("Arrays must have the same length");
+    }
+    return kernels::dot(xs, ys);
+  });
+  natives.bind("scale", [](const ArrayPtr &a, double k) {
+    std::span<const double> xs = numbersOf(a);
+    auto result = std::make_shared<Array>(resultFor(xs));
+    kernels::scale(xs, k, result->numbers());
+    return result;
+  });
+  natives.bind("map", [](const ArrayPtr &a, const std::string &op) {
+    kernels::UnaryOp kernel = unaryOp(op);
+    std::span<const double> xs = numbersOf(a);
+    auto result = std::make_shared<Array>(resultFor(xs));
+    kernels::map(xs, kernel, result->numbers());
+    return result;
+  });
+  natives.bind("sort", [](const ArrayPtr &a) {
+    kernels::sort(numbersOf(a));
+    return a;
+  });
+}
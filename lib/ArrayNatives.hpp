@@ -0,0 +1,28 @@
+#ifndef LOXLANG_LIB_ARRAYNATIVES_HPP
+#define LOXLANG_LIB_ARRAYNATIVES_HPP
+
+#include "lib/Natives.hpp"
+
+namespace loxlang::interpret {
+
+/**
+ * @brief Define the natives for arrays.
+ * @details Elements are accessed with `a[i]` and `a[i] = v`. The bulk
+ * operations need arrays of numbers and run on the unboxed elements (see
+ * `kernels`).
+ *
+ * - `array(n)`: an array of `n` zeros
+ * - `range(n)`: the array `[0, 1, …, n - 1]`
+ * - `len(a)`: the length of an array, or the size of a map
+ * - `push(a, v)`: append `v` and return `a`
+ * - `sum(a)`, `dot(a, b)`
+ * - `scale(a, k)`, `map(a, op)`: a new array with each element multiplied by
+ *   `k` or passed through `op`, one of `"abs"`, `"neg"`, `"sqrt"`,
+ *   `"square"`, `"floor"` or `"ceil"`
+ * - `sort(a)`: sort `a` in place and return it
+ */
+void defineArrayNatives(NativeRegistry &natives);
+
+} // namespace loxlang::interpret
+
+#endif
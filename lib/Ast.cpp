@@ -1,6 +1,8 @@
 #include "lib/Ast.hpp"
 #include "lib/Util.hpp"
+#include <algorithm>
 #include <format>
+#include <ranges>
 #include <sstream>
 
 using namespace loxlang::ast;
@@ -13,8 +15,10 @@ BinaryExpr,
 CallExpr,
 GetExpr,
 GroupingExpr,
+IndexExpr,
 LiteralExpr,
 LogicalExpr,
+MapLiteralExpr,
 SetExpr,
 SuperExpr,
 ThisExpr,
@@ -35,25 +39,38 @@ WhileStmt,
 
 namespace {
 
-struct StringifyVisitor : public Visitor<void> {
+struct StringifyVisitor : public StaticVisitor<StringifyVisitor, void> {
 
   std::ostringstream text;
 
-  void visitAssignExpr(Assign *expr) override {
+  void visitAssignExpr(Assign *expr) {
     text << "(assign " << expr->name.text << " ";
     accept(expr->value.get());
     text << ')';
   }
 
-  void visitBinaryExpr(Binary *expr) override {
-    text << "(" << expr->op.text << ' ';
-    accept(expr->left.get());
-    text << ' ';
-    accept(expr->right.get());
-    text << ')';
+  void visitBinaryExpr(Binary *expr) {
+    if (expr->op.type == loxlang::scan::Token::Type::Eq) {
+      text << "(" << expr->op.text << ' ';
+      accept(expr->left.get());
+      text << ' ';
+      accept(expr->right.get());
+      text << ')';
+      return;
+    }
+    std::vector<Binary *> chain = leftChain(expr);
+    for (Binary *op : std::views::reverse(chain)) {
+      text << "(" << op->op.text << ' ';
+    }
+    accept(chain.front()->left.get());
+    for (Binary *op : chain) {
+      text << ' ';
+      accept(op->right.get());
+      text << ')';
+    }
   }
 
-  void visitCallExpr(Call *expr) override {
+  void visitCallExpr(Call *expr) {
     text << "(call ";
     accept(expr->callee.get());
     text << " (";
@@ -64,49 +81,68 @@ struct StringifyVisitor : public Visitor<void> {
     text << "))";
   }
 
-  void visitGetExpr(Get *expr) override {
+  void visitGetExpr(Get *expr) {
     text << "(get ";
     accept(expr->object.get());
     text << ' ' << expr->name.text << ')';
   }
 
-  void visitGroupingExpr(Grouping *expr) override {
+  void visitGroupingExpr(Grouping *expr) {
     text << "(grouping ";
     accept(expr->expression.get());
     text << ')';
   }
 
-  void visitLiteralExpr(Literal *expr) override { text << expr->value; }
+  void visitIndexExpr(Index *expr) {
+    text << "(index ";
+    accept(expr->object.get());
+    text << ' ';
+    accept(expr->index.get());
+    text << ')';
+  }
+
+  void visitLiteralExpr(Literal *expr) { text << expr->value; }
 
-  void visitLogicalExpr(Logical *expr) override {
+  void visitLogicalExpr(Logical *expr) {
     text << '(' << expr->op.text << ' ';
     accept(expr->left.get());
     text << ' ';
     accept(expr->right.get());
   }
 
-  void visitSetExpr(Set *expr) override {
+  void visitMapLiteralExpr(MapLiteral *expr) {
+    text << "(map";
+    for (std::size_t i = 0; i < expr->keys.size(); ++i) {
+      text << ' ';
+      accept(expr->keys[i].get());
+      text << ' ';
+      accept(expr->values[i].get());
+    }
+    text << ')';
+  }
+
+  void visitSetExpr(Set *expr) {
     text << "(set ";
     accept(expr->object.get());
     text << ' ' << expr->name.text << ' ';
     accept(expr->value.get());
   }
 
-  void visitSuperExpr(Super *expr) override {
+  void visitSuperExpr(Super *expr) {
     text << "(super " << expr->keyword.text << ' ' << expr->method.text << ')';
   }
 
-  void visitThisExpr(This *expr) override { text << expr->keyword.text; }
+  void visitThisExpr(This *expr) { text << expr->keyword.text; }
 
-  void visitUnaryExpr(Unary *expr) override {
+  void visitUnaryExpr(Unary *expr) {
     text << '(' << expr->op.text << ' ';
     accept(expr->right.get());
     text << ')';
   }
 
-  void visitVariableExpr(Variable *expr) override { text << expr->name.text; }
+  void visitVariableExpr(Variable *expr) { text << expr->name.text; }
 
-  void visitBlockStmt(Block *stmt) override {
+  void visitBlockStmt(Block *stmt) {
     text << "(block";
     for (const auto &s : stmt->statements) {
       text << ' ';
@@ -115,7 +151,7 @@ struct StringifyVisitor : public Visitor<void> {
     text << ')';
   }
 
-  void visitClassStmt(Class *stmt) override {
+  void visitClassStmt(Class *stmt) {
     text << "(class " << stmt->name.text << ' ';
     accept(stmt->superclass.get());
     text << " (methods";
@@ -126,13 +162,13 @@ struct StringifyVisitor : public Visitor<void> {
     text << "))";
   }
 
-  void visitExpressionStmt(Expression *stmt) override {
+  void visitExpressionStmt(Expression *stmt) {
     text << "(expressionStmt ";
     accept(stmt->expression.get());
     text << ')';
   }
 
-  void visitFunctionStmt(Function *stmt) override {
+  void visitFunctionStmt(Function *stmt) {
     text << "(funcDef " << stmt->name.text << " (params";
     for (const auto &p : stmt->params) {
       text << ' ' << p.text;
@@ -145,7 +181,7 @@ struct StringifyVisitor : public Visitor<void> {
     text << "))";
   }
 
-  void visitIfStmt(If *stmt) override {
+  void visitIfStmt(If *stmt) {
     text << "(if (cond ";
     accept(stmt->condition.get());
     text << ") (then ";
@@ -157,25 +193,25 @@ struct StringifyVisitor : public Visitor<void> {
     text << "))";
   }
 
-  void visitPrintStmt(Print *stmt) override {
+  void visitPrintStmt(Print *stmt) {
     text << "(print ";
     accept(stmt->expression.get());
     text << ')';
   }
 
-  void visitReturnStmt(Return *stmt) override {
+  void visitReturnStmt(Return *stmt) {
     text << "(return ";
     accept(stmt->value.get());
     text << ')';
   }
 
-  void visitVarStmt(Var *stmt) override {
+  void visitVarStmt(Var *stmt) {
     text << "(var " << stmt->name.text << ' ';
     accept(stmt->initializer.get());
     text << ')';
   }
 
-  void visitWhileStmt(While *stmt) override {
+  void visitWhileStmt(While *stmt) {
     text << "(while (cond ";
     accept(stmt->condition.get());
     text << ") (body ";
@@ -193,3 +229,49 @@ std::string Ast::stringify() {
 }
 
 Ast::~Ast() = default;
+
+void loxlang::ast::destroy(Ast *root) {
+  std::vector<Ast *> pending;
+  if (root != nullptr) {
+    pending.push_back(root);
+  }
+  while (!pending.empty()) {
+    Ast *ast = pending.back();
+    pending.pop_back();
+    forEachChild(ast,
+                 [&pending](auto &ptr) { pending.push_back(ptr.release()); });
+    // all children are detached now, so this does not recurse
+    delete ast;
+  }
+}
+
+std::size_t loxlang::ast::height(Ast *root) {
+  struct Entry {
+    Ast *ast;
+    std::size_t depth;
+  };
+  std::vector<Entry> pending = {Entry{root, 1}};
+  std::size_t maxDepth = 0;
+  while (!pending.empty()) {
+    Entry e = pending.back();
+    pending.pop_back();
+    maxDepth = std::max(maxDepth, e.depth);
+    forEachChild(e.ast, [&pending, &e](auto &ptr) {
+      pending.push_back(Entry{ptr.get(), e.depth + 1});
+    });
+  }
+  return maxDepth;
+}
+
+std::vector<Binary *> loxlang::ast::leftChain(Binary *expr) {
+  std::vector<Binary *> chain = {expr};
+  while (chain.back()->left->type() == AstType::BinaryExpr) {
+    auto *left = static_cast<Binary *>(chain.back()->left.get());
+    if (left->op.type == loxlang::scan::Token::Type::Eq) {
+      break;
+    }
+    chain.push_back(left);
+  }
+  std::ranges::reverse(chain);
+  return chain;
+}
@@ -7,6 +7,38 @@
 #include "lib/Scanner.hpp"
 #include <memory>
 #include <string>
+#include <vector>
+
+namespace loxlang::ast {
+struct Ast;
+
+/**
+ * @brief Destroy a syntax tree without recursing on the native stack.
+ * @details The children of every node are detached and put on an explicit
+ * work list before the node itself is deleted, so this works for trees of any
+ * depth. This is what `std::unique_ptr<Ast>` uses to delete its tree.
+ * @param root The tree to delete, may be nullptr
+ */
+void destroy(Ast *root);
+
+} // namespace loxlang::ast
+
+/**
+ * @brief Deleter for owning `Ast` pointers.
+ * @details The implicitly generated destructors of the node types would
+ * recurse once per nesting level, which overflows the stack on deeply nested
+ * (e.g. machine generated) programs. This specialization routes every
+ * `std::unique_ptr<Ast>` through `loxlang::ast::destroy` instead.
+ */
+template <> struct std::default_delete<loxlang::ast::Ast> {
+  constexpr default_delete() noexcept = default;
+  template <typename T>
+  // NOLINTNEXTLINE(google-explicit-constructor): mirrors the primary template
+  default_delete(const std::default_delete<T> & /*unused*/) noexcept {}
+  void operator()(loxlang::ast::Ast *ast) const {
+    loxlang::ast::destroy(ast);
+  }
+};
 
 namespace loxlang::ast {
 
@@ -16,8 +48,10 @@ enum class AstType : std::uint8_t {
   CallExpr,
   GetExpr,
   GroupingExpr,
+  IndexExpr,
   LiteralExpr,
   LogicalExpr,
+  MapLiteralExpr,
   SetExpr,
   SuperExpr,
   ThisExpr,
@@ -36,25 +70,35 @@ enum class AstType : std::uint8_t {
 std::string astTypeName(AstType type);
 
 struct Ast {
-  virtual AstType type() const = 0;
+  explicit Ast(AstType type) : astType{type} {}
   virtual ~Ast() = 0;
+
+  /**
+   * @brief The concrete node type.
+   * @details The tag is stored in the node itself, so that dispatching on it
+   * does not need a virtual call.
+   */
+  AstType type() const { return astType; }
+
   std::string stringify();
+
+private:
+  AstType astType;
 };
 
 struct Assign : public Ast {
   Assign(scan::Token name, std::unique_ptr<Ast> value)
-      : name{name}, value{std::move(value)} {}
+      : Ast{AstType::AssignExpr}, name{name}, value{std::move(value)} {}
   ~Assign() override = default;
-  AstType type() const override { return AstType::AssignExpr; }
   scan::Token name;
   std::unique_ptr<Ast> value;
 };
 
 struct Binary : public Ast {
   Binary(std::unique_ptr<Ast> left, scan::Token op, std::unique_ptr<Ast> right)
-      : left{std::move(left)}, op{op}, right{std::move(right)} {}
+      : Ast{AstType::BinaryExpr}, left{std::move(left)}, op{op},
+        right{std::move(right)} {}
   ~Binary() override = default;
-  AstType type() const override { return AstType::BinaryExpr; }
   std::unique_ptr<Ast> left;
   scan::Token op;
   std::unique_ptr<Ast> right;
@@ -63,10 +107,9 @@ struct Binary : public Ast {
 struct Call : public Ast {
   Call(std::unique_ptr<Ast> callee, scan::Token paren,
        std::vector<std::unique_ptr<Ast>> arguments)
-      : callee{std::move(callee)}, paren{paren},
+      : Ast{AstType::CallExpr}, callee{std::move(callee)}, paren{paren},
         arguments{std::move(arguments)} {}
   ~Call() override = default;
-  AstType type() const override { return AstType::CallExpr; }
   std::unique_ptr<Ast> callee;
   scan::Token paren;
   std::vector<std::unique_ptr<Ast>> arguments;
@@ -74,43 +117,67 @@ struct Call : public Ast {
 
 struct Get : public Ast {
   Get(std::unique_ptr<Ast> object, scan::Token name)
-      : object{std::move(object)}, name{name} {}
+      : Ast{AstType::GetExpr}, object{std::move(object)}, name{name} {}
   ~Get() override = default;
-  AstType type() const override { return AstType::GetExpr; }
   std::unique_ptr<Ast> object;
   scan::Token name;
 };
 
 struct Grouping : public Ast {
   explicit Grouping(std::unique_ptr<Ast> expression)
-      : expression{std::move(expression)} {}
+      : Ast{AstType::GroupingExpr}, expression{std::move(expression)} {}
   ~Grouping() override = default;
-  AstType type() const override { return AstType::GroupingExpr; }
   std::unique_ptr<Ast> expression;
 };
 
+struct Index : public Ast {
+  Index(std::unique_ptr<Ast> object, scan::Token bracket,
+        std::unique_ptr<Ast> index)
+      : Ast{AstType::IndexExpr}, object{std::move(object)}, bracket{bracket},
+        index{std::move(index)} {}
+  ~Index() override = default;
+  std::unique_ptr<Ast> object;
+  scan::Token bracket;
+  std::unique_ptr<Ast> index;
+};
+
 struct Literal : public Ast {
-  explicit Literal(Value value) : value{std::move(value)} {}
+  Literal(scan::Token token, Value value)
+      : Ast{AstType::LiteralExpr}, token{token}, value{std::move(value)} {}
   ~Literal() override = default;
-  AstType type() const override { return AstType::LiteralExpr; }
+  scan::Token token;
   Value value;
 };
 
 struct Logical : public Ast {
   Logical(std::unique_ptr<Ast> left, scan::Token op, std::unique_ptr<Ast> right)
-      : left{std::move(left)}, op{op}, right{std::move(right)} {}
+      : Ast{AstType::LogicalExpr}, left{std::move(left)}, op{op},
+        right{std::move(right)} {}
   ~Logical() override = default;
-  AstType type() const override { return AstType::LogicalExpr; }
   std::unique_ptr<Ast> left;
   scan::Token op;
   std::unique_ptr<Ast> right;
 };
 
+struct MapLiteral : public Ast {
+  MapLiteral(scan::Token brace, std::vector<std::unique_ptr<Ast>> keys,
+             std::vector<std::unique_ptr<Ast>> values)
+      : Ast{AstType::MapLiteralExpr}, brace{brace}, keys{std::move(keys)},
+        values{std::move(values)} {}
+  ~MapLiteral() override = default;
+  scan::Token brace;
+  /**
+   * @brief The keys and (at the same index) their values.
+   */
+  std::vector<std::unique_ptr<Ast>> keys;
+  std::vector<std::unique_ptr<Ast>> values;
+};
+
 struct Set : public Ast {
   Set(std::unique_ptr<Ast> object, scan::Token name, std::unique_ptr<Ast> value)
-      : object{std::move(object)}, name{name}, value{std::move(value)} {}
+      : Ast{AstType::SetExpr}, object{std::move(object)}, name{name},
+        value{std::move(value)} {}
   ~Set() override = default;
-  AstType type() const override { return AstType::SetExpr; }
   std::unique_ptr<Ast> object;
   scan::Token name;
   std::unique_ptr<Ast> value;
@@ -118,57 +185,53 @@ struct Set : public Ast {
 
 struct Super : public Ast {
   Super(scan::Token keyword, scan::Token method)
-      : keyword{keyword}, method{method} {}
+      : Ast{AstType::SuperExpr}, keyword{keyword}, method{method} {}
   ~Super() override = default;
-  AstType type() const override { return AstType::SuperExpr; }
   scan::Token keyword;
   scan::Token method;
 };
 
 struct This : public Ast {
-  explicit This(scan::Token keyword) : keyword{keyword} {}
+  explicit This(scan::Token keyword)
+      : Ast{AstType::ThisExpr}, keyword{keyword} {}
   ~This() override = default;
-  AstType type() const override { return AstType::ThisExpr; }
   scan::Token keyword;
 };
 
 struct Unary : public Ast {
   Unary(scan::Token op, std::unique_ptr<Ast> right)
-      : op{op}, right{std::move(right)} {}
+      : Ast{AstType::UnaryExpr}, op{op}, right{std::move(right)} {}
   ~Unary() override = default;
-  AstType type() const override { return AstType::UnaryExpr; }
   scan::Token op;
   std::unique_ptr<Ast> right;
 };
 
 struct Variable : public Ast {
-  explicit Variable(scan::Token name) : name{name} {}
+  explicit Variable(scan::Token name)
+      : Ast{AstType::VariableExpr}, name{name} {}
   ~Variable() override = default;
-  AstType type() const override { return AstType::VariableExpr; }
   scan::Token name;
 };
 
 struct Block : public Ast {
   explicit Block(std::vector<std::unique_ptr<Ast>> statements)
-      : statements{std::move(statements)} {}
+      : Ast{AstType::BlockStmt}, statements{std::move(statements)} {}
   ~Block() override = default;
-  AstType type() const override { return AstType::BlockStmt; }
   std::vector<std::unique_ptr<Ast>> statements;
 };
 
 struct Expression : public Ast {
   explicit Expression(std::unique_ptr<Ast> expression)
-      : expression{std::move(expression)} {}
+      : Ast{AstType::ExpressionStmt}, expression{std::move(expression)} {}
   ~Expression() override = default;
-  AstType type() const override { return AstType::ExpressionStmt; }
   std::unique_ptr<Ast> expression;
 };
 struct Function : public Ast {
   Function(scan::Token name, std::vector<scan::Token> params,
            std::vector<std::unique_ptr<Ast>> body)
-      : name{name}, params{std::move(params)}, body{std::move(body)} {}
+      : Ast{AstType::FunctionStmt}, name{name}, params{std::move(params)},
+        body{std::move(body)} {}
   ~Function() override = default;
-  AstType type() const override { return AstType::FunctionStmt; }
   scan::Token name;
   std::vector<scan::Token> params;
   std::vector<std::unique_ptr<Ast>> body;
@@ -176,43 +239,40 @@ struct Function : public Ast {
 struct If : public Ast {
   If(std::unique_ptr<Ast> condition, std::unique_ptr<Ast> thenBranch,
      std::unique_ptr<Ast> elseBranch)
-      : condition{std::move(condition)}, thenBranch{std::move(thenBranch)},
-        elseBranch{std::move(elseBranch)} {}
+      : Ast{AstType::IfStmt}, condition{std::move(condition)},
+        thenBranch{std::move(thenBranch)}, elseBranch{std::move(elseBranch)} {}
   ~If() override = default;
-  AstType type() const override { return AstType::IfStmt; }
   std::unique_ptr<Ast> condition;
   std::unique_ptr<Ast> thenBranch;
   std::unique_ptr<Ast> elseBranch;
 };
 struct Print : public Ast {
   explicit Print(std::unique_ptr<Ast> expression)
-      : expression{std::move(expression)} {}
+      : Ast{AstType::PrintStmt}, expression{std::move(expression)} {}
   ~Print() override = default;
-  AstType type() const override { return AstType::PrintStmt; }
   std::unique_ptr<Ast> expression;
 };
 struct Return : public Ast {
   Return(scan::Token keyword, std::unique_ptr<Ast> value)
-      : keyword{keyword}, value{std::move(value)} {}
+      : Ast{AstType::ReturnStmt}, keyword{keyword}, value{std::move(value)} {}
   ~Return() override = default;
-  AstType type() const override { return AstType::ReturnStmt; }
   scan::Token keyword;
   std::unique_ptr<Ast> value;
 };
 struct Var : public Ast {
   Var(scan::Token name, std::unique_ptr<Ast> initializer)
-      : name{name}, initializer{std::move(initializer)} {}
+      : Ast{AstType::VarStmt}, name{name},
+        initializer{std::move(initializer)} {}
   ~Var() override = default;
-  AstType type() const override { return AstType::VarStmt; }
   scan::Token name;
   std::unique_ptr<Ast> initializer;
 };
 
 struct While : public Ast {
   While(std::unique_ptr<Ast> condition, std::unique_ptr<Ast> body)
-      : condition{std::move(condition)}, body{std::move(body)} {}
+      : Ast{AstType::WhileStmt}, condition{std::move(condition)},
+        body{std::move(body)} {}
   ~While() override = default;
-  AstType type() const override { return AstType::WhileStmt; }
   std::unique_ptr<Ast> condition;
   std::unique_ptr<Ast> body;
 };
@@ -220,23 +280,161 @@ struct While : public Ast {
 struct Class : public Ast {
   Class(scan::Token name, std::unique_ptr<Variable> superclass,
         std::vector<std::unique_ptr<Function>> methods)
-      : name{name}, superclass{std::move(superclass)},
+      : Ast{AstType::ClassStmt}, name{name}, superclass{std::move(superclass)},
         methods{std::move(methods)} {}
   ~Class() override = default;
-  AstType type() const override { return AstType::ClassStmt; }
   scan::Token name;
   std::unique_ptr<Variable> superclass;
   std::vector<std::unique_ptr<Function>> methods;
 };
 
+/**
+ * @brief Call `f` on the owning pointer of every direct child of `ast`.
+ * @details Children are passed in source order as references to their
+ * `std::unique_ptr`, so `f` may also take ownership of them. Absent optional
+ * children (a missing `else` branch, superclass, …) are skipped.
+ */
+template <typename F> void forEachChild(Ast *ast, F &&f) {
+  lox_assert_neq(ast, nullptr, "Ast node should not be nullptr");
+  auto child = [&f](auto &ptr) {
+    if (ptr != nullptr) {
+      f(ptr);
+    }
+  };
+  auto children = [&child](auto &ptrs) {
+    for (auto &ptr : ptrs) {
+      child(ptr);
+    }
+  };
+
+  switch (ast->type()) {
+  case AstType::AssignExpr: child(static_cast<Assign *>(ast)->value); break;
+  case AstType::BinaryExpr: {
+    auto *expr = static_cast<Binary *>(ast);
+    child(expr->left);
+    child(expr->right);
+  } break;
+  case AstType::CallExpr: {
+    auto *expr = static_cast<Call *>(ast);
+    child(expr->callee);
+    children(expr->arguments);
+  } break;
+  case AstType::GetExpr: child(static_cast<Get *>(ast)->object); break;
+  case AstType::GroupingExpr:
+    child(static_cast<Grouping *>(ast)->expression);
+    break;
+  case AstType::IndexExpr: {
+    auto *expr = static_cast<Index *>(ast);
+    child(expr->object);
+    child(expr->index);
+  } break;
+  case AstType::LogicalExpr: {
+    auto *expr = static_cast<Logical *>(ast);
+    child(expr->left);
+    child(expr->right);
+  } break;
+  case AstType::MapLiteralExpr: {
+    auto *expr = static_cast<MapLiteral *>(ast);
+    for (std::size_t i = 0; i < expr->keys.size(); ++i) {
+      child(expr->keys[i]);
+      child(expr->values[i]);
+    }
+  } break;
+  case AstType::SetExpr: {
+    auto *expr = static_cast<Set *>(ast);
+    child(expr->object);
+    child(expr->value);
+  } break;
+  case AstType::UnaryExpr: child(static_cast<Unary *>(ast)->right); break;
+  case AstType::BlockStmt:
+    children(static_cast<Block *>(ast)->statements);
+    break;
+  case AstType::ClassStmt: {
+    auto *stmt = static_cast<Class *>(ast);
+    child(stmt->superclass);
+    children(stmt->methods);
+  } break;
+  case AstType::ExpressionStmt:
+    child(static_cast<Expression *>(ast)->expression);
+    break;
+  case AstType::FunctionStmt:
+    children(static_cast<Function *>(ast)->body);
+    break;
+  case AstType::IfStmt: {
+    auto *stmt = static_cast<If *>(ast);
+    child(stmt->condition);
+    child(stmt->thenBranch);
+    child(stmt->elseBranch);
+  } break;
+  case AstType::PrintStmt: child(static_cast<Print *>(ast)->expression); break;
+  case AstType::ReturnStmt: child(static_cast<Return *>(ast)->value); break;
+  case AstType::VarStmt: child(static_cast<Var *>(ast)->initializer); break;
+  case AstType::WhileStmt: {
+    auto *stmt = static_cast<While *>(ast);
+    child(stmt->condition);
+    child(stmt->body);
+  } break;
+
+  case AstType::LiteralExpr:
+  case AstType::SuperExpr:
+  case AstType::ThisExpr:
+  case AstType::VariableExpr: break;
+
+  default: lox_fail("bad ast type");
+  }
+}
+
+/**
+ * @brief Pre-order traversal of a syntax tree with an explicit stack.
+ * @details Unlike a recursive `Visitor`, this uses constant native stack
+ * space, no matter how deeply the tree is nested.
+ * @param root The tree to traverse
+ * @param f Called with every node (as `Ast *`) before any of its children
+ */
+template <typename F> void walk(Ast *root, F &&f) {
+  std::vector<Ast *> pending = {root};
+  std::vector<Ast *> children;
+  while (!pending.empty()) {
+    Ast *ast = pending.back();
+    pending.pop_back();
+    f(ast);
+
+    forEachChild(ast,
+                 [&children](auto &ptr) { children.push_back(ptr.get()); });
+    pending.insert(pending.end(), children.rbegin(), children.rend());
+    children.clear();
+  }
+}
+
+/**
+ * @brief The height of a syntax tree, i.e. the number of nodes on its longest
+ * path from the root to a leaf.
+ * @details Computed without recursion, see `walk`.
+ */
+std::size_t height(Ast *root);
+
+/**
+ * @brief The chain of binary operators that ends in `expr`, innermost first.
+ * @details A flat chain like `1 + 2 + … + n` parses to a left-nested tree as
+ * high as the chain is long, which the parser's nesting limit does not bound.
+ * Recursive passes visit the left operands of such a chain with a loop over
+ * this instead of recursing into them. Assignments end the chain.
+ * @param expr A binary operator other than an assignment
+ * @return The operators whose left operand is the next one, starting with the
+ * one whose left operand is not part of the chain and ending with `expr`.
+ */
+std::vector<Binary *> leftChain(Binary *expr);
+
 template <typename R> struct Visitor {
   virtual R visitAssignExpr(Assign *expr) = 0;
   virtual R visitBinaryExpr(Binary *expr) = 0;
   virtual R visitCallExpr(Call *expr) = 0;
   virtual R visitGetExpr(Get *expr) = 0;
   virtual R visitGroupingExpr(Grouping *expr) = 0;
+  virtual R visitIndexExpr(Index *expr) = 0;
   virtual R visitLiteralExpr(Literal *expr) = 0;
   virtual R visitLogicalExpr(Logical *expr) = 0;
+  virtual R visitMapLiteralExpr(MapLiteral *expr) = 0;
   virtual R visitSetExpr(Set *expr) = 0;
   virtual R visitSuperExpr(Super *expr) = 0;
   virtual R visitThisExpr(This *expr) = 0;
@@ -264,10 +462,13 @@ template <typename R> struct Visitor {
     case AstType::GetExpr: return visitGetExpr(static_cast<Get *>(ast));
     case AstType::GroupingExpr:
       return visitGroupingExpr(static_cast<Grouping *>(ast));
+    case AstType::IndexExpr: return visitIndexExpr(static_cast<Index *>(ast));
     case AstType::LiteralExpr:
       return visitLiteralExpr(static_cast<Literal *>(ast));
     case AstType::LogicalExpr:
       return visitLogicalExpr(static_cast<Logical *>(ast));
+    case AstType::MapLiteralExpr:
+      return visitMapLiteralExpr(static_cast<MapLiteral *>(ast));
     case AstType::SetExpr: return visitSetExpr(static_cast<Set *>(ast));
     case AstType::SuperExpr: return visitSuperExpr(static_cast<Super *>(ast));
     case AstType::ThisExpr: return visitThisExpr(static_cast<This *>(ast));
@@ -292,6 +493,75 @@ template <typename R> struct Visitor {
   }
 };
 
+/**
+ * @brief A visitor that is resolved at compile time.
+ * @details `Derived` has to provide the `visitXxx` member functions of
+ * `Visitor`, but they need not (and should not) be virtual. `accept` switches
+ * once on the node type and calls the member function of `Derived` directly,
+ * so that the compiler is free to inline the whole pass.
+ *
+ * ```cpp
+ * struct MyPass : public StaticVisitor<MyPass, void> {
+ *   void visitAssignExpr(Assign *expr) { ... }
+ *   // ...
+ * };
+ * ```
+ *
+ * @tparam Derived The concrete visitor (CRTP)
+ * @tparam R The result type of the visit functions
+ */
+template <typename Derived, typename R> struct StaticVisitor {
+  R accept(Ast *ast) {
+    lox_assert_neq(ast, nullptr, "Ast node should not be nullptr");
+    Derived &self = static_cast<Derived &>(*this);
+    switch (ast->type()) {
+
+    case AstType::AssignExpr:
+      return self.visitAssignExpr(static_cast<Assign *>(ast));
+    case AstType::BinaryExpr:
+      return self.visitBinaryExpr(static_cast<Binary *>(ast));
+    case AstType::CallExpr: return self.visitCallExpr(static_cast<Call *>(ast));
+    case AstType::GetExpr: return self.visitGetExpr(static_cast<Get *>(ast));
+    case AstType::GroupingExpr:
+      return self.visitGroupingExpr(static_cast<Grouping *>(ast));
+    case AstType::IndexExpr:
+      return self.visitIndexExpr(static_cast<Index *>(ast));
+    case AstType::LiteralExpr:
+      return self.visitLiteralExpr(static_cast<Literal *>(ast));
+    case AstType::LogicalExpr:
+      return self.visitLogicalExpr(static_cast<Logical *>(ast));
+    case AstType::MapLiteralExpr:
+      return self.visitMapLiteralExpr(static_cast<MapLiteral *>(ast));
+    case AstType::SetExpr: return self.visitSetExpr(static_cast<Set *>(ast));
+    case AstType::SuperExpr:
+      return self.visitSuperExpr(static_cast<Super *>(ast));
+    case AstType::ThisExpr: return self.visitThisExpr(static_cast<This *>(ast));
+    case AstType::UnaryExpr:
+      return self.visitUnaryExpr(static_cast<Unary *>(ast));
+    case AstType::VariableExpr:
+      return self.visitVariableExpr(static_cast<Variable *>(ast));
+    case AstType::BlockStmt:
+      return self.visitBlockStmt(static_cast<Block *>(ast));
+    case AstType::ClassStmt:
+      return self.visitClassStmt(static_cast<Class *>(ast));
+    case AstType::ExpressionStmt:
+      return self.visitExpressionStmt(static_cast<Expression *>(ast));
+    case AstType::FunctionStmt:
+      return self.visitFunctionStmt(static_cast<Function *>(ast));
+    case AstType::IfStmt: return self.visitIfStmt(static_cast<If *>(ast));
+    case AstType::PrintStmt:
+      return self.visitPrintStmt(static_cast<Print *>(ast));
+    case AstType::ReturnStmt:
+      return self.visitReturnStmt(static_cast<Return *>(ast));
+    case AstType::VarStmt: return self.visitVarStmt(static_cast<Var *>(ast));
+    case AstType::WhileStmt:
+      return self.visitWhileStmt(static_cast<While *>(ast));
+
+    default: lox_fail("bad ast type");
+    }
+  }
+};
+
 } // namespace loxlang::ast
 
 #endif
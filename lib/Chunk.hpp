@@ -0,0 +1,69 @@
+#ifndef LOXLANG_LIB_CHUNK_HPP
+#define LOXLANG_LIB_CHUNK_HPP
+
+#include "lib/Objects.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace loxlang::compile {
+
+/**
+ * @brief The instructions of the Lox virtual machine.
+ * @details The machine is a stack machine: operands are popped from and
+ * results are pushed onto the operand stack of the executing fiber.
+ */
+enum class OpCode : std::uint8_t {
+  // clang-format off
+  Constant, GetGlobal, SetGlobal,
+  Equal, NotEqual, Greater, GreaterEq, Less, LessEq,
+  Add, Subtract, Multiply, Divide, Not, Negate,
+  Call, JumpIfFalse, JumpIfTrue, Pop, Return,
+  GetIndex, SetIndex, BuildMap,
+  Breakpoint,
+  // clang-format on
+};
+
+/**
+ * @brief Retrieves the name of an op code
+ */
+std::string opCodeName(OpCode op);
+
+/**
+ * @brief A single instruction.
+ */
+struct Instruction {
+  OpCode op;
+
+  /**
+   * @brief Argument count of `Call`, entry count of `BuildMap`
+   */
+  std::uint16_t count = 0;
+
+  /**
+   * @brief Index into the constants (`Constant`) or names (`GetGlobal`,
+   * `SetGlobal`) of the chunk, the native slot (`Call`) or the jump target
+   */
+  std::uint32_t index = 0;
+};
+
+/**
+ * @brief A compiled piece of Lox code.
+ */
+struct Chunk {
+  std::vector<Instruction> code;
+
+  /**
+   * @brief For every instruction, the program text it was compiled from. This
+   * is used to report runtime errors.
+   */
+  std::vector<std::string_view> locations;
+
+  std::vector<Value> constants;
+  std::vector<std::string> names;
+};
+
+} // namespace loxlang::compile
+
+#endif
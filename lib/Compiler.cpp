@@ -0,0 +1,221 @@
+#include "lib/Compiler.hpp"
+#include "lib/Ast.hpp"
+#include "lib/Error.hpp"
+#include "lib/Trace.hpp"
+#include "lib/Util.hpp"
+#include <limits>
+#include <string_view>
+#include <vector>
+
+using namespace loxlang;
+using namespace loxlang::ast;
+using namespace loxlang::compile;
+using namespace loxlang::scan;
+
+namespace {
+
+struct Compiler : public StaticVisitor<Compiler, void> {
+  Compiler(Program &program, interpret::NativeRegistry &natives)
+      : program{program}, natives{natives} {}
+
+  Program &program;
+  interpret::NativeRegistry &natives;
+  Chunk chunk;
+  // indexed by symbol
+  std::vector<std::uint32_t> nameIndices;
+  bool hadError = false;
+
+  void error(Token source, std::string_view msg) {
+    program.error(msg, source.text);
+    hadError = true;
+  }
+
+  std::size_t emit(OpCode op, Token source, std::uint32_t index = 0,
+                   std::uint16_t count = 0) {
+    chunk.code.push_back(Instruction{op, count, index});
+    chunk.locations.push_back(source.text);
+    return chunk.code.size() - 1;
+  }
+
+  std::uint32_t name(Token ident) {
+    lox_assert_neq(ident.symbol, noSymbol, "identifier is interned");
+    if (ident.symbol >= nameIndices.size()) {
+      nameIndices.resize(program.symbols().size(), noSymbol);
+    }
+    std::uint32_t &index = nameIndices[ident.symbol];
+    if (index == noSymbol) {
+      index = static_cast<std::uint32_t>(chunk.names.size());
+      chunk.names.emplace_back(program.symbols().name(ident.symbol));
+    }
+    return index;
+  }
+
+  void patchJump(std::size_t jump) {
+    chunk.code[jump].index = static_cast<std::uint32_t>(chunk.code.size());
+  }
+
+  void assign(Binary *expr) {
+    switch (expr->left->type()) {
+    case AstType::VariableExpr:
+      accept(expr->right.get());
+      emit(OpCode::SetGlobal, expr->op,
+           name(static_cast<Variable *>(expr->left.get())->name));
+      break;
+    case AstType::IndexExpr: {
+      auto *target = static_cast<Index *>(expr->left.get());
+      accept(target->object.get());
+      accept(target->index.get());
+      accept(expr->right.get());
+      emit(OpCode::SetIndex, target->bracket);
+    } break;
+    default: error(expr->op, "Invalid assignment target"); break;
+    }
+  }
+
+  void visitAssignExpr(Assign *expr) {
+    accept(expr->value.get());
+    emit(OpCode::SetGlobal, expr->name, name(expr->name));
+  }
+
+  void visitBinaryExpr(Binary *expr) {
+    if (expr->op.type == Token::Type::Eq) {
+      assign(expr);
+      return;
+    }
+
+    std::vector<Binary *> chain = leftChain(expr);
+    accept(chain.front()->left.get());
+    for (Binary *op : chain) {
+      accept(op->right.get());
+      binaryOp(op->op);
+    }
+  }
+
+  void binaryOp(Token op) {
+    switch (op.type) {
+    case Token::Type::Plus: emit(OpCode::Add, op); break;
+    case Token::Type::Minus: emit(OpCode::Subtract, op); break;
+    case Token::Type::Star: emit(OpCode::Multiply, op); break;
+    case Token::Type::Slash: emit(OpCode::Divide, op); break;
+    case Token::Type::Greater: emit(OpCode::Greater, op); break;
+    case Token::Type::GreaterEq: emit(OpCode::GreaterEq, op); break;
+    case Token::Type::Less: emit(OpCode::Less, op); break;
+    case Token::Type::LessEq: emit(OpCode::LessEq, op); break;
+    case Token::Type::EqEq: emit(OpCode::Equal, op); break;
+    case Token::Type::BangEq: emit(OpCode::NotEqual, op); break;
+    default: lox_fail("bad binary operator");
+    }
+  }
+
+  void visitCallExpr(Call *expr) {
+    if (expr->callee->type() != AstType::VariableExpr) {
+      error(expr->paren, "Can only call functions");
+      return;
+    }
+    if (expr->arguments.size() > std::numeric_limits<std::uint16_t>::max()) {
+      error(expr->paren, "Too many arguments");
+      return;
+    }
+    for (auto &arg : expr->arguments) {
+      accept(arg.get());
+    }
+    Token callee = static_cast<Variable *>(expr->callee.get())->name;
+    emit(OpCode::Call, callee, natives.slot(callee.text),
+         static_cast<std::uint16_t>(expr->arguments.size()));
+  }
+
+  void visitGroupingExpr(Grouping *expr) { accept(expr->expression.get()); }
+
+  void visitIndexExpr(Index *expr) {
+    accept(expr->object.get());
+    accept(expr->index.get());
+    emit(OpCode::GetIndex, expr->bracket);
+  }
+
+  void visitLiteralExpr(Literal *expr) {
+    chunk.constants.push_back(expr->value);
+    emit(OpCode::Constant, expr->token,
+         static_cast<std::uint32_t>(chunk.constants.size() - 1));
+  }
+
+  void visitLogicalExpr(Logical *expr) {
+    accept(expr->left.get());
+    bool isOr = expr->op.type == Token::Type::Or;
+    std::size_t jump =
+        emit(isOr ? OpCode::JumpIfTrue : OpCode::JumpIfFalse, expr->op);
+    emit(OpCode::Pop, expr->op);
+    accept(expr->right.get());
+    patchJump(jump);
+  }
+
+  void visitMapLiteralExpr(MapLiteral *expr) {
+    if (expr->keys.size() > std::numeric_limits<std::uint16_t>::max()) {
+      error(expr->brace, "Too many entries in map literal");
+      return;
+    }
+    for (std::size_t i = 0; i < expr->keys.size(); ++i) {
+      accept(expr->keys[i].get());
+      accept(expr->values[i].get());
+    }
+    emit(OpCode::BuildMap, expr->brace, 0,
+         static_cast<std::uint16_t>(expr->keys.size()));
+  }
+
+  void visitUnaryExpr(Unary *expr) {
+    accept(expr->right.get());
+    switch (expr->op.type) {
+    case Token::Type::Minus: emit(OpCode::Negate, expr->op); break;
+    case Token::Type::Bang: emit(OpCode::Not, expr->op); break;
+    default: lox_fail("bad unary operator");
+    }
+  }
+
+  void visitVariableExpr(Variable *expr) {
+    emit(OpCode::GetGlobal, expr->name, name(expr->name));
+  }
+
+  // The parser does not produce these yet
+
+  void visitGetExpr(Get *) { lox_fail("not supported yet"); }
+  void visitSetExpr(Set *) { lox_fail("not supported yet"); }
+  void visitSuperExpr(Super *) { lox_fail("not supported yet"); }
+  void visitThisExpr(This *) { lox_fail("not supported yet"); }
+  void visitBlockStmt(Block *) { lox_fail("not supported yet"); }
+  void visitClassStmt(Class *) { lox_fail("not supported yet"); }
+  void visitExpressionStmt(Expression *) { lox_fail("not supported yet"); }
+  void visitFunctionStmt(Function *) { lox_fail("not supported yet"); }
+  void visitIfStmt(If *) { lox_fail("not supported yet"); }
+  void visitPrintStmt(Print *) { lox_fail("not supported yet"); }
+  void visitReturnStmt(Return *) { lox_fail("not supported yet"); }
+  void visitVarStmt(Var *) { lox_fail("not supported yet"); }
+  void visitWhileStmt(While *) { lox_fail("not supported yet"); }
+};
+
+} // namespace
+
+std::optional<Chunk> compile::compile(Program &p, Ast *ast,
+                                      interpret::NativeRegistry &natives) {
+  lox_trace_scope("compile");
+  Compiler compiler = Compiler(p, natives);
+  compiler.accept(ast);
+  // the implicit return is at the end of the program
+  std::string_view text = p.programText();
+  compiler.emit(OpCode::Return,
+                Token(Token::Type::Eof, text.substr(text.size())));
+  if (compiler.hadError) {
+    return std::nullopt;
+  }
+  return std::move(compiler.chunk);
+}
+
+std::string compile::opCodeName(OpCode op) {
+  std::string_view asText = R"ENUMS(
+    Constant, GetGlobal, SetGlobal,
+    Equal, NotEqual, Greater, GreaterEq, Less, LessEq,
+    Add, Subtract, Multiply, Divide, Not, Negate,
+    Call, JumpIfFalse, JumpIfTrue, Pop, Return,
+    GetIndex, SetIndex, BuildMap,
+    Breakpoint,
+  )ENUMS";
+  return util::enumName(asText, static_cast<std::size_t>(op));
+}
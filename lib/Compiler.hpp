@@ -0,0 +1,28 @@
+#ifndef LOXLANG_LIB_COMPILER_HPP
+#define LOXLANG_LIB_COMPILER_HPP
+
+#include "lib/Chunk.hpp"
+#include "lib/Natives.hpp"
+#include "lib/Program.hpp"
+#include <optional>
+
+namespace loxlang::ast {
+struct Ast;
+} // namespace loxlang::ast
+
+namespace loxlang::compile {
+
+/**
+ * @brief Compile a syntax tree to instructions of the virtual machine.
+ * @param p The program the tree was parsed from, used for error reporting
+ * @param ast The tree to compile
+ * @param natives The host functions that calls are resolved against
+ * @return The compiled code, ending with a `Return` of the value of the tree;
+ * or `std::nullopt` if an error was reported.
+ */
+std::optional<Chunk> compile(Program &p, ast::Ast *ast,
+                             interpret::NativeRegistry &natives);
+
+} // namespace loxlang::compile
+
+#endif
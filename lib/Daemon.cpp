@@ -0,0 +1,262 @@
+#include "lib/Daemon.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+using namespace loxlang;
+
+namespace {
+
+/**
+ * @brief Longer argument lists are rejected.
+ */
+constexpr std::uint32_t maxRequestSize = std::uint32_t{1} << 20;
+
+[[noreturn]] void systemError(const char *what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+sockaddr_un unixAddress(const std::filesystem::path &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  const std::string &name = path.native();
+  if (name.size() >= sizeof(addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    systemError("socket path");
+  }
+  std::memcpy(addr.sun_path, name.c_str(), name.size() + 1);
+  return addr;
+}
+
+/**
+ * @brief Let blocking reads and writes on a socket fail after `timeout`.
+ */
+bool setTimeout(int fd, std::chrono::milliseconds timeout) {
+  auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+  auto micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(timeout - seconds);
+  timeval time{};
+  time.tv_sec = static_cast<time_t>(seconds.count());
+  time.tv_usec = static_cast<suseconds_t>(micros.count());
+  return setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &time, sizeof(time)) == 0 &&
+         setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &time, sizeof(time)) == 0;
+}
+
+bool readAll(int fd, void *data, std::size_t size) {
+  auto *bytes = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = read(fd, bytes, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+bool sendAll(int fd, const void *data, std::size_t size) {
+  const auto *bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    bytes += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+} // namespace
+
+Daemon::Daemon(const std::filesystem::path &socket, Handler handler,
+               std::chrono::milliseconds requestTimeout)
+    : path{socket}, handler{std::move(handler)},
+      requestTimeout{requestTimeout} {
+  sockaddr_un addr = unixAddress(path);
+  struct stat info {};
+  if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+    unlink(path.c_str());
+  }
+  listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listener < 0) {
+    systemError("socket");
+  }
+  if (bind(listener, reinterpret_cast<const sockaddr *>(&addr),
+           sizeof(addr)) < 0 ||
+      listen(listener, SOMAXCONN) < 0) {
+    int error = errno;
+    close(listener);
+    errno = error;
+    systemError("bind");
+  }
+}
+
+Daemon::~Daemon() {
+  close(listener);
+  unlink(path.c_str());
+}
+
+void Daemon::serve() {
+  while (!stopping.load()) {
+    int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+      if (stopping.load()) {
+        break;
+      }
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      int error = errno;
+      reap(true);
+      errno = error;
+      systemError("accept");
+    }
+    reap(false);
+    Client &served = clients.emplace_back();
+    served.thread = std::thread([this, client, &served] {
+      if (setTimeout(client, requestTimeout)) {
+        handle(client);
+      }
+      close(client);
+      served.done.store(true);
+    });
+  }
+  reap(true);
+}
+
+void Daemon::reap(bool all) {
+  for (auto client = clients.begin(); client != clients.end();) {
+    if (all || client->done.load()) {
+      client->thread.join();
+      client = clients.erase(client);
+    } else {
+      ++client;
+    }
+  }
+}
+
+void Daemon::stop() {
+  stopping.store(true);
+  // wakes up a blocked accept
+  shutdown(listener, SHUT_RDWR);
+}
+
+void Daemon::handle(int client) {
+  std::uint32_t length = 0;
+  iovec header{&length, sizeof(length)};
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(3 * sizeof(int))> control{};
+  msghdr message{};
+  message.msg_iov = &header;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+  ssize_t received = recvmsg(client, &message, MSG_CMSG_CLOEXEC);
+
+  std::array<int, 3> stdio = {-1, -1, -1};
+  cmsghdr *fds = CMSG_FIRSTHDR(&message);
+  if (received > 0 && fds != nullptr && fds->cmsg_level == SOL_SOCKET &&
+      fds->cmsg_type == SCM_RIGHTS &&
+      fds->cmsg_len == CMSG_LEN(3 * sizeof(int))) {
+    std::memcpy(stdio.data(), CMSG_DATA(fds), 3 * sizeof(int));
+  }
+  auto closeStdio = [&] {
+    for (int fd : stdio) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  };
+
+  if (length > maxRequestSize) {
+    closeStdio();
+    return;
+  }
+  std::vector<char> text(length);
+  bool complete = received == sizeof(length) &&
+                  std::ranges::find(stdio, -1) == stdio.end() &&
+                  readAll(client, text.data(), text.size());
+  if (!complete) {
+    closeStdio();
+    return;
+  }
+  std::vector<std::string> args;
+  for (std::size_t start = 0; start < text.size();) {
+    std::size_t end = start;
+    while (end < text.size() && text[end] != '\0') {
+      ++end;
+    }
+    args.emplace_back(text.data() + start, end - start);
+    start = end + 1;
+  }
+
+  std::int32_t status = handler(args, stdio);
+  closeStdio();
+  sendAll(client, &status, sizeof(status));
+}
+
+int loxlang::sendRequest(const std::filesystem::path &socket,
+                         std::span<const std::string_view> args,
+                         std::array<int, 3> stdio) {
+  sockaddr_un addr = unixAddress(socket);
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    systemError("socket");
+  }
+  auto fail = [&](const char *what) {
+    int error = errno;
+    close(fd);
+    errno = error;
+    systemError(what);
+  };
+  if (connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) <
+      0) {
+    fail("connect");
+  }
+
+  std::string text;
+  for (std::string_view arg : args) {
+    text += arg;
+    text += '\0';
+  }
+  auto length = static_cast<std::uint32_t>(text.size());
+  iovec header{&length, sizeof(length)};
+  alignas(cmsghdr) std::array<char, CMSG_SPACE(3 * sizeof(int))> control{};
+  msghdr message{};
+  message.msg_iov = &header;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+  cmsghdr *fds = CMSG_FIRSTHDR(&message);
+  fds->cmsg_level = SOL_SOCKET;
+  fds->cmsg_type = SCM_RIGHTS;
+  fds->cmsg_len = CMSG_LEN(3 * sizeof(int));
+  std::memcpy(CMSG_DATA(fds), stdio.data(), 3 * sizeof(int));
+  if (sendmsg(fd, &message, MSG_NOSIGNAL) != sizeof(length) ||
+      !sendAll(fd, text.data(), text.size())) {
+    fail("send");
+  }
+
+  std::int32_t status = 0;
+  if (!readAll(fd, &status, sizeof(status))) {
+    errno = ECONNRESET;
+    fail("receive");
+  }
+  close(fd);
+  return status;
+}
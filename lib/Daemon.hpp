@@ -0,0 +1,106 @@
+#ifndef LOXLANG_LIB_DAEMON_HPP
+#define LOXLANG_LIB_DAEMON_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace loxlang {
+
+/**
+ * @brief Serves run requests on a local Unix socket.
+ * @details A request is what a program invocation would get: its arguments
+ * and its standard input, output and error. Every client is served on a
+ * thread of its own, so a long running request does not hold up the others.
+ * The handler gets the client's standard streams as descriptors; the
+ * streams of the daemon itself are left alone. So a long running daemon can
+ * keep state such as compiled code between invocations, while every
+ * invocation behaves like a process of its own.
+ *
+ * The protocol: the client sends the length of the arguments as a 32 bit
+ * integer, passing its standard streams along (`SCM_RIGHTS`), followed by
+ * the arguments, each terminated by '\0'. Once the request is done, the
+ * daemon answers with the exit status as a 32 bit integer. A client that does
+ * not send its whole request within the request timeout is disconnected, so
+ * it does not tie up a thread.
+ */
+class Daemon {
+public:
+  static constexpr std::chrono::milliseconds defaultRequestTimeout =
+      std::chrono::seconds(5);
+
+  /**
+   * @brief Handles a request. Called on the client's thread, so possibly
+   * for several clients at once.
+   * @param args The arguments of the request
+   * @param stdio The client's standard input, output and error. They are
+   * closed once the handler returns.
+   * @return The exit status for the client
+   */
+  using Handler = std::function<int(std::span<const std::string> args,
+                                    const std::array<int, 3> &stdio)>;
+
+  /**
+   * @brief Listen on a socket. A stale socket file is replaced.
+   * @param requestTimeout How long to wait for a request, and for a client to
+   * take its exit status
+   * @throw std::system_error If the socket cannot be created
+   */
+  Daemon(const std::filesystem::path &socket, Handler handler,
+         std::chrono::milliseconds requestTimeout = defaultRequestTimeout);
+  Daemon(const Daemon &) = delete;
+  Daemon &operator=(const Daemon &) = delete;
+  ~Daemon();
+
+  /**
+   * @brief Handle requests until `stop` is called.
+   * @details Returns once the requests being handled are done.
+   */
+  void serve();
+
+  /**
+   * @brief Let `serve` stop accepting clients. May be called from any thread.
+   */
+  void stop();
+
+private:
+  struct Client {
+    std::thread thread;
+    std::atomic<bool> done = false;
+  };
+
+  void handle(int client);
+  // joins the threads of the clients that are done
+  void reap(bool all);
+
+  std::filesystem::path path;
+  Handler handler;
+  std::chrono::milliseconds requestTimeout;
+  int listener = -1;
+  std::atomic<bool> stopping = false;
+  // only used by the thread running `serve`
+  std::list<Client> clients;
+};
+
+/**
+ * @brief Send a request to a daemon and wait for it to be handled.
+ * @param socket The socket the daemon listens on
+ * @param args The arguments of the request
+ * @param stdio The standard input, output and error for the request
+ * @return The exit status
+ * @throw std::system_error If the daemon cannot be reached
+ */
+int sendRequest(const std::filesystem::path &socket,
+                std::span<const std::string_view> args,
+                std::array<int, 3> stdio = {0, 1, 2});
+
+} // namespace loxlang
+
+#endif
@@ -0,0 +1,148 @@
+#include "lib/Debugger.hpp"
+#include "lib/Error.hpp"
+#include "lib/Interpreter.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace loxlang;
+using namespace loxlang::compile;
+using namespace loxlang::interpret;
+
+void Debugger::load(Program &program, Chunk &chunk, const Globals &globals) {
+  Script script{&program, &chunk, &globals, {}, {}, {}};
+  for (std::size_t pc = 0; pc < chunk.code.size(); ++pc) {
+    lox_assert_neq(chunk.code[pc].op, OpCode::Breakpoint, "chunk not loaded");
+    script.original.push_back(chunk.code[pc].op);
+    script.lines.push_back(program.lineOf(chunk.locations[pc]));
+  }
+  repatch(scripts.insert_or_assign(&chunk, std::move(script)).first->second);
+}
+
+void Debugger::unload(Chunk &chunk) {
+  auto entry = scripts.find(&chunk);
+  if (entry == scripts.end()) {
+    return;
+  }
+  for (std::size_t pc = 0; pc < entry->second.original.size(); ++pc) {
+    chunk.code[pc].op = entry->second.original[pc];
+  }
+  scripts.erase(entry);
+}
+
+void Debugger::unloadAll() {
+  while (!scripts.empty()) {
+    unload(*scripts.begin()->second.chunk);
+  }
+}
+
+void Debugger::setBreakpoint(std::size_t line) {
+  breakpoints.insert(line);
+  repatchAll();
+}
+
+void Debugger::clearBreakpoint(std::size_t line) {
+  breakpoints.erase(line);
+  repatchAll();
+}
+
+void Debugger::pause() {
+  stepping = true;
+  repatchAll();
+}
+
+Instruction Debugger::hit(Fiber &fiber) {
+  auto entry = scripts.find(fiber.chunk);
+  lox_assert(entry != scripts.end(), "breakpoint in a loaded script");
+  Script &script = entry->second;
+  if (stepping || script.breakAt[fiber.pc]) {
+    stepping = false;
+    stop(fiber, script);
+    repatchAll();
+  }
+  Instruction in = script.chunk->code[fiber.pc];
+  in.op = script.original[fiber.pc];
+  return in;
+}
+
+void Debugger::stop(Fiber &fiber, Script &script) {
+  auto where = [&] {
+    out << "stopped at line ";
+    if (script.lines[fiber.pc].has_value()) {
+      out << *script.lines[fiber.pc];
+    } else {
+      out << '?';
+    }
+    out << ", " << opCodeName(script.original[fiber.pc]) << '\n';
+  };
+  where();
+
+  std::string line;
+  while (out.flush() && std::getline(in, line)) {
+    std::istringstream words(line);
+    std::string command;
+    words >> command;
+    if (command == "continue") {
+      return;
+    }
+    if (command == "step") {
+      stepping = true;
+      return;
+    }
+    if (command == "where") {
+      where();
+    } else if (command == "stack") {
+      out << "stack:";
+      for (const Value &v : fiber.stack) {
+        out << ' ' << v;
+      }
+      out << '\n';
+    } else if (command == "print") {
+      std::string name;
+      words >> name;
+      const Value *value = script.globals->variables.find(name);
+      if (value == nullptr) {
+        out << "undefined variable " << name << '\n';
+      } else {
+        out << name << " = " << *value << '\n';
+      }
+    } else if (command == "break" || command == "clear") {
+      std::size_t at = 0;
+      if (!(words >> at)) {
+        out << "expected a line number\n";
+      } else if (command == "break") {
+        breakpoints.insert(at);
+        out << "breakpoint at line " << at << '\n';
+      } else {
+        breakpoints.erase(at);
+        out << "cleared line " << at << '\n';
+      }
+    } else if (!command.empty()) {
+      out << "unknown command " << command << '\n';
+    }
+  }
+}
+
+void Debugger::repatch(Script &script) {
+  std::size_t size = script.original.size();
+  script.breakAt.assign(size, false);
+  std::set<std::size_t> seen;
+  for (std::size_t pc = 0; pc < size; ++pc) {
+    const std::optional<std::size_t> &line = script.lines[pc];
+    if (line.has_value() && breakpoints.contains(*line) &&
+        seen.insert(*line).second) {
+      script.breakAt[pc] = true;
+    }
+  }
+  for (std::size_t pc = 0; pc < size; ++pc) {
+    script.chunk->code[pc].op = stepping || script.breakAt[pc]
+                                    ? OpCode::Breakpoint
+                                    : script.original[pc];
+  }
+}
+
+void Debugger::repatchAll() {
+  for (auto &[chunk, script] : scripts) {
+    repatch(script);
+  }
+}
@@ -0,0 +1,103 @@
+#ifndef LOXLANG_LIB_DEBUGGER_HPP
+#define LOXLANG_LIB_DEBUGGER_HPP
+
+#include "lib/Chunk.hpp"
+#include "lib/Program.hpp"
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace loxlang::interpret {
+
+struct Fiber;
+struct Globals;
+
+/**
+ * @brief Breakpoints, single stepping and inspection for running scripts.
+ * @details The debugger never slows down code it does not stop in: it
+ * replaces the op code of every instruction it wants to stop at with
+ * `Breakpoint` and remembers the original. Only the patched instructions
+ * call into the debugger, which then runs the original instruction; code
+ * without a debugger attached runs unchanged. Stepping patches every loaded
+ * instruction until the next one is reached.
+ *
+ * While a fiber is stopped, the debugger reads commands, one per line, from
+ * its input and answers on its output:
+ *
+ * - `break <line>`, `clear <line>`: set or remove a breakpoint at the first
+ *   instruction of a line (counted from 0, as in error reports) of every
+ *   script
+ * - `step`: stop again at the next instruction
+ * - `continue`: run until the next breakpoint; also at the end of the input
+ * - `print <name>`: the value of a global variable
+ * - `stack`: the operand stack of the stopped fiber, bottom first
+ * - `where`: the line and instruction the fiber is stopped at
+ */
+class Debugger {
+public:
+  Debugger(std::istream &in, std::ostream &out) : in{in}, out{out} {}
+  Debugger(const Debugger &) = delete;
+  Debugger &operator=(const Debugger &) = delete;
+
+  /**
+   * @brief Make a compiled script known to the debugger, so that breakpoints
+   * apply to it.
+   */
+  void load(Program &program, compile::Chunk &chunk, const Globals &globals);
+
+  /**
+   * @brief Restore the patched instructions of a script and forget it.
+   */
+  void unload(compile::Chunk &chunk);
+
+  /**
+   * @brief Restore all patched instructions and forget the scripts.
+   */
+  void unloadAll();
+
+  void setBreakpoint(std::size_t line);
+  void clearBreakpoint(std::size_t line);
+
+  /**
+   * @brief Stop at the next instruction of any loaded script.
+   */
+  void pause();
+
+  /**
+   * @brief Called by the interpreter for a `Breakpoint` instruction.
+   * @details Stops the fiber and handles commands if this is a breakpoint or
+   * a step was requested.
+   * @return The original instruction, to be executed in its place
+   */
+  compile::Instruction hit(Fiber &fiber);
+
+private:
+  struct Script {
+    Program *program;
+    compile::Chunk *chunk;
+    const Globals *globals;
+    std::vector<compile::OpCode> original;
+    // the line of every instruction, if it has one
+    std::vector<std::optional<std::size_t>> lines;
+    // whether an instruction is the first one of a line with a breakpoint
+    std::vector<bool> breakAt;
+  };
+
+  void stop(Fiber &fiber, Script &script);
+  void repatch(Script &script);
+  void repatchAll();
+
+  std::istream &in;
+  std::ostream &out;
+  std::unordered_map<const compile::Chunk *, Script> scripts;
+  std::set<std::size_t> breakpoints;
+  bool stepping = false;
+};
+
+} // namespace loxlang::interpret
+
+#endif
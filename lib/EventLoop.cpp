@@ -0,0 +1,87 @@
+#include "lib/EventLoop.hpp"
+#include "lib/Error.hpp"
+#include "lib/Interpreter.hpp"
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+using namespace loxlang::interpret;
+
+namespace {
+
+[[noreturn]] void systemError() { throw NativeError(std::strerror(errno)); }
+
+} // namespace
+
+EventLoop::~EventLoop() {
+  if (epoll >= 0) {
+    close(epoll);
+  }
+}
+
+bool EventLoop::add(int fd, Interest interest, Fiber *fiber) {
+  if (epoll < 0) {
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll < 0) {
+      systemError();
+    }
+  }
+
+  Waiters &w = waiters[fd];
+  bool isNew = w.fibers.empty();
+  std::uint32_t events =
+      w.events | (interest == Interest::Read ? EPOLLIN : EPOLLOUT);
+
+  epoll_event ev{};
+  ev.events = events | EPOLLONESHOT;
+  ev.data.fd = fd;
+  if (epoll_ctl(epoll, isNew ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) < 0) {
+    int err = errno;
+    if (isNew) {
+      waiters.erase(fd);
+    }
+    if (err == EPERM) {
+      // regular files and the like are always ready
+      return false;
+    }
+    errno = err;
+    systemError();
+  }
+
+  w.events = events;
+  w.fibers.push_back(fiber);
+  return true;
+}
+
+void EventLoop::wait(std::vector<Fiber *> &ready, int timeout) {
+  lox_assert(hasWaiters(), "waiting without waiters would block forever");
+  constexpr int maxEvents = 64;
+  std::array<epoll_event, maxEvents> events{};
+  int count = -1;
+  do {
+    count = epoll_wait(epoll, events.data(), maxEvents, timeout);
+  } while (count < 0 && errno == EINTR);
+  lox_assert(count >= 0, "epoll_wait failed");
+
+  for (int i = 0; i < count; ++i) {
+    int fd = events[i].data.fd;
+    auto w = waiters.find(fd);
+    if (w == waiters.end()) {
+      continue;
+    }
+    // All waiters retry their operation, so they are woken up together and
+    // the descriptor leaves the interest list until someone waits again.
+    ready.insert(ready.end(), w->second.fibers.begin(), w->second.fibers.end());
+    epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+    waiters.erase(w);
+  }
+}
+
+void EventLoop::clear() {
+  for (auto &[fd, w] : waiters) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+  }
+  waiters.clear();
+}
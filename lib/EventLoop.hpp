@@ -0,0 +1,66 @@
+#ifndef LOXLANG_LIB_EVENTLOOP_HPP
+#define LOXLANG_LIB_EVENTLOOP_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace loxlang::interpret {
+
+struct Fiber;
+
+/**
+ * @brief Waits for file descriptors to become ready, on behalf of fibers.
+ * @details A thin wrapper around epoll. Fibers register interest in a file
+ * descriptor and are handed back once it is ready (or had an error, or was
+ * hung up). A fiber may be woken up spuriously and is expected to retry its
+ * operation and wait again if needed.
+ */
+class EventLoop {
+public:
+  enum class Interest : std::uint8_t { Read, Write };
+
+  EventLoop() = default;
+  EventLoop(const EventLoop &) = delete;
+  EventLoop &operator=(const EventLoop &) = delete;
+  ~EventLoop();
+
+  /**
+   * @brief Let `fiber` wait until `fd` is ready.
+   * @return `false` if `fd` cannot be waited for since it is always ready (a
+   * regular file, for example). The fiber has not been registered then.
+   */
+  bool add(int fd, Interest interest, Fiber *fiber);
+
+  /**
+   * @brief Whether any fiber is waiting.
+   */
+  bool hasWaiters() const { return !waiters.empty(); }
+
+  /**
+   * @brief Block until at least one file descriptor is ready.
+   * @param ready The fibers waiting for ready file descriptors are appended
+   * here.
+   * @param timeout Return after this many milliseconds even if nothing is
+   * ready; -1 waits as long as it takes.
+   */
+  void wait(std::vector<Fiber *> &ready, int timeout = -1);
+
+  /**
+   * @brief Forget all waiting fibers.
+   */
+  void clear();
+
+private:
+  struct Waiters {
+    std::uint32_t events = 0;
+    std::vector<Fiber *> fibers;
+  };
+
+  int epoll = -1;
+  std::unordered_map<int, Waiters> waiters;
+};
+
+} // namespace loxlang::interpret
+
+#endif
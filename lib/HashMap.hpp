@@ -0,0 +1,224 @@
+#ifndef LOXLANG_LIB_HASHMAP_HPP
+#define LOXLANG_LIB_HASHMAP_HPP
+
+#include "lib/Error.hpp"
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace loxlang::util {
+
+/**
+ * @brief Hash map with open addressing and Robin Hood probing.
+ * @details All entries live in one array and collisions are resolved by
+ * probing the following slots, so a lookup usually touches a single cache
+ * line. On insertion, an entry that is further from its home slot takes the
+ * place of one that is closer ("Robin Hood"), which keeps probe sequences
+ * short and lets a lookup stop as soon as it passes the probe distance a
+ * matching key would have. Erasing shifts the following entries back instead
+ * of leaving tombstones, so the table never degrades from deletions.
+ *
+ * The probe metadata (distance from the home slot and the low bits of the
+ * hash) is kept apart from the entries, so probing does not load keys unless
+ * the hashes match.
+ *
+ * `Hash` and `Eq` may be transparent, then `find` and `erase` accept any key
+ * type they accept. Keys and values must be default constructible. Pointers
+ * returned by `find` and `insertOrAssign` are invalidated by any insertion
+ * or erasure.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename Eq = std::equal_to<K>>
+class OpenHashMap {
+public:
+  /**
+   * @brief The value of `key`, or nullptr.
+   */
+  template <typename Q> V *find(const Q &key) {
+    std::size_t slot = lookup(key);
+    return slot == notFound ? nullptr : &entries[slot].second;
+  }
+  template <typename Q> const V *find(const Q &key) const {
+    std::size_t slot = lookup(key);
+    return slot == notFound ? nullptr : &entries[slot].second;
+  }
+
+  template <typename Q> bool contains(const Q &key) const {
+    return lookup(key) != notFound;
+  }
+
+  /**
+   * @brief Set the value of `key`, adding it if it is new.
+   * @details The key is only converted to a `K` if it is new.
+   * @return The stored value
+   */
+  template <typename Q> V &insertOrAssign(Q &&key, V value) {
+    std::size_t slot = lookup(key);
+    if (slot != notFound) {
+      entries[slot].second = std::move(value);
+      return entries[slot].second;
+    }
+    std::size_t capacity = capacityFor(count + 1);
+    if (capacity != meta.size()) {
+      rehash(capacity);
+    }
+    std::uint32_t hashBits = truncatedHash(key);
+    return entries[place(K(std::forward<Q>(key)), std::move(value), hashBits)]
+        .second;
+  }
+
+  /**
+   * @brief Remove `key`.
+   * @return Whether the key was present
+   */
+  template <typename Q> bool erase(const Q &key) {
+    std::size_t slot = lookup(key);
+    if (slot == notFound) {
+      return false;
+    }
+    // shift the rest of the cluster one slot back
+    std::size_t next = (slot + 1) & mask();
+    while (meta[next].distance > 1) {
+      meta[slot] = Meta{meta[next].distance - 1, meta[next].hash};
+      entries[slot] = std::move(entries[next]);
+      slot = next;
+      next = (next + 1) & mask();
+    }
+    meta[slot] = Meta{};
+    entries[slot] = {};
+    --count;
+    return true;
+  }
+
+  void clear() {
+    meta.clear();
+    entries.clear();
+    count = 0;
+  }
+
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  /**
+   * @brief The number of slots, each taking `slotBytes()` bytes.
+   */
+  std::size_t capacity() const { return meta.size(); }
+  static constexpr std::size_t slotBytes() {
+    return sizeof(Meta) + sizeof(std::pair<K, V>);
+  }
+
+  /**
+   * @brief The number of slots the table grows to before it holds `n`
+   * entries.
+   */
+  std::size_t capacityFor(std::size_t n) const {
+    std::size_t capacity = meta.size();
+    while (n * maxLoadDenominator > capacity * maxLoadNumerator) {
+      capacity = capacity == 0 ? minCapacity : capacity * 2;
+    }
+    return capacity;
+  }
+
+  /**
+   * @brief Call `f(key, value)` for every entry, in no particular order.
+   */
+  template <typename F> void forEach(F &&f) const {
+    for (std::size_t i = 0; i < meta.size(); ++i) {
+      if (meta[i].distance != 0) {
+        f(entries[i].first, entries[i].second);
+      }
+    }
+  }
+
+private:
+  struct Meta {
+    /**
+     * @brief 0 for an empty slot, else 1 + the distance from the home slot
+     */
+    std::uint32_t distance = 0;
+    std::uint32_t hash = 0;
+  };
+
+  static constexpr std::size_t notFound = static_cast<std::size_t>(-1);
+  static constexpr std::size_t minCapacity = 8;
+  static constexpr std::size_t maxLoadNumerator = 7;
+  static constexpr std::size_t maxLoadDenominator = 8;
+
+  std::size_t mask() const { return meta.size() - 1; }
+
+  template <typename Q> std::uint32_t truncatedHash(const Q &key) const {
+    // spread the bits, as std::hash of integers is often the identity
+    std::uint64_t h = static_cast<std::uint64_t>(Hash{}(key));
+    h *= 0x9e3779b97f4a7c15ULL;
+    return static_cast<std::uint32_t>(h >> 32);
+  }
+
+  template <typename Q> std::size_t lookup(const Q &key) const {
+    if (count == 0) {
+      return notFound;
+    }
+    std::uint32_t hashBits = truncatedHash(key);
+    std::size_t slot = hashBits & mask();
+    for (std::uint32_t distance = 1;; ++distance) {
+      const Meta &m = meta[slot];
+      if (m.distance < distance) {
+        // a matching key would have displaced this entry
+        return notFound;
+      }
+      if (m.hash == hashBits && Eq{}(entries[slot].first, key)) {
+        return slot;
+      }
+      slot = (slot + 1) & mask();
+    }
+  }
+
+  std::size_t place(K key, V value, std::uint32_t hashBits) {
+    std::pair<K, V> entry{std::move(key), std::move(value)};
+    Meta m{1, hashBits};
+    std::size_t slot = hashBits & mask();
+    std::size_t placed = notFound;
+    while (true) {
+      if (meta[slot].distance == 0) {
+        meta[slot] = m;
+        entries[slot] = std::move(entry);
+        ++count;
+        return placed == notFound ? slot : placed;
+      }
+      if (meta[slot].distance < m.distance) {
+        std::swap(meta[slot], m);
+        std::swap(entries[slot], entry);
+        if (placed == notFound) {
+          placed = slot;
+        }
+      }
+      ++m.distance;
+      slot = (slot + 1) & mask();
+    }
+  }
+
+  void rehash(std::size_t capacity) {
+    lox_assert(std::has_single_bit(capacity), "capacity is a power of two");
+    std::vector<Meta> oldMeta =
+        std::exchange(meta, std::vector<Meta>(capacity));
+    std::vector<std::pair<K, V>> oldEntries =
+        std::exchange(entries, std::vector<std::pair<K, V>>(capacity));
+    count = 0;
+    for (std::size_t i = 0; i < oldMeta.size(); ++i) {
+      if (oldMeta[i].distance != 0) {
+        place(std::move(oldEntries[i].first), std::move(oldEntries[i].second),
+              oldMeta[i].hash);
+      }
+    }
+  }
+
+  std::vector<Meta> meta;
+  std::vector<std::pair<K, V>> entries;
+  std::size_t count = 0;
+};
+
+} // namespace loxlang::util
+
+#endif
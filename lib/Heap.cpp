@@ -0,0 +1,107 @@
+#include "lib/Heap.hpp"
+#include "lib/Error.hpp"
+#include "lib/Trace.hpp"
+
+using namespace loxlang;
+
+namespace {
+
+thread_local const std::shared_ptr<Heap> *currentHeap = nullptr;
+
+std::size_t index(HeapKind kind) { return static_cast<std::size_t>(kind); }
+
+} // namespace
+
+Heap::Scope::Scope(const std::shared_ptr<Heap> &heap) : previous{currentHeap} {
+  lox_assert_neq(heap, nullptr, "scope of a heap");
+  currentHeap = &heap;
+}
+
+Heap::Scope::~Scope() { currentHeap = previous; }
+
+HeapStats Heap::stats() const {
+  HeapStats stats;
+  for (std::size_t i = 0; i < heapKindCount; ++i) {
+    stats.liveBytes[i] = liveBytes[i].load(std::memory_order_relaxed);
+  }
+  stats.totalBytes = totalBytes.load(std::memory_order_relaxed);
+  stats.peakBytes = peakBytes.load(std::memory_order_relaxed);
+  stats.softLimitCrossings =
+      softLimitCrossings.load(std::memory_order_relaxed);
+  stats.limitErrors = limitErrors.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void Heap::resetCounters() {
+  peakBytes.store(totalBytes.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  softLimitCrossings.store(0, std::memory_order_relaxed);
+  limitErrors.store(0, std::memory_order_relaxed);
+}
+
+void Heap::reserve(std::size_t bytes) {
+  if (currentHeap != nullptr && !(*currentHeap)->fits(bytes)) {
+    throw HeapLimitError();
+  }
+}
+
+const std::shared_ptr<Heap> *Heap::current() { return currentHeap; }
+
+bool Heap::fits(std::size_t bytes) {
+  std::size_t total = totalBytes.load(std::memory_order_relaxed);
+  if (bytes > limits.hard || total > limits.hard - bytes) {
+    limitErrors.fetch_add(1, std::memory_order_relaxed);
+    lox_trace_instant("heap limit exceeded");
+    return false;
+  }
+  return true;
+}
+
+void Heap::grow(HeapKind kind, std::size_t bytes) {
+  liveBytes[index(kind)].fetch_add(bytes, std::memory_order_relaxed);
+  std::size_t before = totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+  std::size_t after = before + bytes;
+  if (before <= limits.soft && after > limits.soft) {
+    softLimitCrossings.fetch_add(1, std::memory_order_relaxed);
+    lox_trace_instant("heap soft limit crossed");
+  }
+  std::size_t peak = peakBytes.load(std::memory_order_relaxed);
+  while (peak < after && !peakBytes.compare_exchange_weak(
+                             peak, after, std::memory_order_relaxed)) {
+  }
+}
+
+void Heap::shrink(HeapKind kind, std::size_t bytes) {
+  liveBytes[index(kind)].fetch_sub(bytes, std::memory_order_relaxed);
+  totalBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+HeapCharge::HeapCharge(HeapKind kind, std::size_t bytes) : kind{kind} {
+  if (currentHeap != nullptr) {
+    heap = *currentHeap;
+    resize(bytes);
+  }
+}
+
+HeapCharge::~HeapCharge() {
+  if (heap != nullptr) {
+    heap->shrink(kind, bytes);
+  }
+}
+
+void HeapCharge::resize(std::size_t bytes) {
+  if (heap == nullptr) {
+    return;
+  }
+  if (bytes > this->bytes) {
+    std::size_t growth = bytes - this->bytes;
+    if (currentHeap != nullptr && currentHeap->get() == heap.get() &&
+        !heap->fits(growth)) {
+      throw HeapLimitError();
+    }
+    heap->grow(kind, growth);
+  } else {
+    heap->shrink(kind, this->bytes - bytes);
+  }
+  this->bytes = bytes;
+}
@@ -0,0 +1,165 @@
+#ifndef LOXLANG_LIB_HEAP_HPP
+#define LOXLANG_LIB_HEAP_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace loxlang {
+
+enum class HeapKind : std::uint8_t { String, Array, Map };
+
+constexpr std::size_t heapKindCount = 3;
+
+/**
+ * @brief Memory limits of a `Heap`, in bytes.
+ */
+struct HeapLimits {
+  static constexpr std::size_t unlimited =
+      std::numeric_limits<std::size_t>::max();
+
+  /**
+   * @brief Allocations of a running script beyond this fail with a
+   * `HeapLimitError`.
+   */
+  std::size_t hard = unlimited;
+
+  /**
+   * @brief Exceeding this is counted in `HeapStats::softLimitCrossings`, so
+   * the host can shed load before the hard limit is reached.
+   */
+  std::size_t soft = unlimited;
+};
+
+/**
+ * @brief A snapshot of the memory use of a `Heap`, in bytes.
+ */
+struct HeapStats {
+  /**
+   * @brief Live bytes, indexed by `HeapKind`
+   */
+  std::array<std::size_t, heapKindCount> liveBytes{};
+  std::size_t totalBytes = 0;
+  std::size_t peakBytes = 0;
+
+  /**
+   * @brief How often the live bytes went from below to above the soft limit
+   */
+  std::size_t softLimitCrossings = 0;
+
+  /**
+   * @brief How many allocations were refused because of the hard limit
+   */
+  std::size_t limitErrors = 0;
+
+  std::size_t live(HeapKind kind) const {
+    return liveBytes[static_cast<std::size_t>(kind)];
+  }
+};
+
+/**
+ * @brief Thrown when an allocation would exceed the hard limit of the heap of
+ * the running script.
+ */
+struct HeapLimitError : public std::runtime_error {
+  HeapLimitError() : std::runtime_error("Heap limit exceeded") {}
+};
+
+/**
+ * @brief Memory accounting for the Lox objects of one interpreter instance.
+ * @details Lox values are reference counted, so a heap does not own or free
+ * anything; it only counts the bytes of strings, arrays and maps created
+ * while it is the current heap of the thread (see `Scope`). Objects remember
+ * the heap they were charged to, so they are credited back even if they are
+ * freed on another thread or after the heap's owner has gone.
+ *
+ * Only growth on the thread's current heap is checked against the hard
+ * limit: the host may still read and copy script values after the script
+ * has run.
+ */
+class Heap {
+public:
+  /**
+   * @brief Makes a heap the current one of the thread for its lifetime.
+   */
+  class Scope {
+  public:
+    explicit Scope(const std::shared_ptr<Heap> &heap);
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope();
+
+  private:
+    const std::shared_ptr<Heap> *previous;
+  };
+
+  void setLimits(HeapLimits limits) { this->limits = limits; }
+  HeapLimits getLimits() const { return limits; }
+
+  HeapStats stats() const;
+
+  /**
+   * @brief Forget the peak usage and the counters, e.g. between jobs.
+   */
+  void resetCounters();
+
+  /**
+   * @brief Fail early if the current heap cannot grow by `bytes`.
+   * @details For natives that are about to make one large allocation, so the
+   * limit is enforced before the memory is touched.
+   * @throw HeapLimitError If the hard limit would be exceeded
+   */
+  static void reserve(std::size_t bytes);
+
+  /**
+   * @brief The current heap of the thread, or nullptr outside of a `Scope`.
+   */
+  static const std::shared_ptr<Heap> *current();
+
+private:
+  friend class HeapCharge;
+
+  void grow(HeapKind kind, std::size_t bytes);
+  void shrink(HeapKind kind, std::size_t bytes);
+  bool fits(std::size_t bytes);
+
+  HeapLimits limits;
+  std::array<std::atomic<std::size_t>, heapKindCount> liveBytes{};
+  std::atomic<std::size_t> totalBytes = 0;
+  std::atomic<std::size_t> peakBytes = 0;
+  std::atomic<std::size_t> softLimitCrossings = 0;
+  std::atomic<std::size_t> limitErrors = 0;
+};
+
+/**
+ * @brief The bytes an object occupies on the heap it was created on.
+ * @details A member of every accounted object: created with the thread's
+ * current heap (if any), updated with `resize` whenever the object's size
+ * changes and credited back when the object is destroyed.
+ */
+class HeapCharge {
+public:
+  HeapCharge(HeapKind kind, std::size_t bytes);
+  HeapCharge(const HeapCharge &) = delete;
+  HeapCharge &operator=(const HeapCharge &) = delete;
+  ~HeapCharge();
+
+  /**
+   * @throw HeapLimitError If the object grows beyond the hard limit of the
+   * current heap. The charge is unchanged then.
+   */
+  void resize(std::size_t bytes);
+
+private:
+  std::shared_ptr<Heap> heap;
+  HeapKind kind;
+  std::size_t bytes = 0;
+};
+
+} // namespace loxlang
+
+#endif
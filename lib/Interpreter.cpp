@@ -0,0 +1,454 @@
+#include "lib/Interpreter.hpp"
+#include "lib/Array.hpp"
+#include "lib/Debugger.hpp"
+#include "lib/Error.hpp"
+#include "lib/Heap.hpp"
+#include "lib/Map.hpp"
+#include "lib/Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+
+using namespace loxlang;
+using namespace loxlang::compile;
+using namespace loxlang::interpret;
+
+namespace {
+
+struct RuntimePanic : public std::logic_error {
+  RuntimePanic() : std::logic_error("interpreter unwinding") {}
+};
+
+bool isTruthy(const Value &v) {
+  switch (v.type()) {
+  case Value::Type::Nil: return false;
+  case Value::Type::Boolean: return v.getBool();
+  default: return true;
+  }
+}
+
+[[noreturn]] void runtimeError(Fiber &fiber, std::string_view msg) {
+  fiber.program->error(msg, fiber.chunk->locations[fiber.pc]);
+  throw RuntimePanic();
+}
+
+double number(Fiber &fiber, const Value &v) {
+  if (v.type() != Value::Type::Number) {
+    runtimeError(fiber, "Operand must be a number");
+  }
+  return v.getNumber();
+}
+
+std::size_t arrayIndex(Fiber &fiber, const Array &array, const Value &v) {
+  double index = number(fiber, v);
+  if (index != std::floor(index)) {
+    runtimeError(fiber, "Array index must be an integer");
+  }
+  if (index < 0 || index >= static_cast<double>(array.size())) {
+    runtimeError(fiber, "Array index out of range");
+  }
+  return static_cast<std::size_t>(index);
+}
+
+const Value &mapKey(Fiber &fiber, const Value &key) {
+  if (!Map::isKey(key)) {
+    runtimeError(fiber, "Map keys must be strings or numbers");
+  }
+  return key;
+}
+
+std::uint64_t saturatingAdd(std::uint64_t a, std::uint64_t b) {
+  return b > RunLimits::unlimited - a ? RunLimits::unlimited : a + b;
+}
+
+Value pop(std::vector<Value> &stack) {
+  Value v = std::move(stack.back());
+  stack.pop_back();
+  return v;
+}
+
+} // namespace
+
+std::size_t Scheduler::spawn(Program &program, const Chunk &chunk) {
+  std::size_t id = fibers.size();
+  Fiber &fiber = *fibers.emplace_back(std::make_unique<Fiber>());
+  fiber.id = id;
+  fiber.program = &program;
+  fiber.chunk = &chunk;
+  runnable.push_back(&fiber);
+  return id;
+}
+
+void Scheduler::run() {
+  using Clock = std::chrono::steady_clock;
+  executed = 0;
+  granted = 0;
+  fuel = 0;
+  aborted = false;
+  deadline = limits.time < Clock::time_point::max() - Clock::now()
+                 ? Clock::now() + limits.time
+                 : Clock::time_point::max();
+  timeCheck = deadline != Clock::time_point::max()
+                  ? RunLimits::timeCheckInterval
+                  : RunLimits::unlimited;
+
+  std::vector<Fiber *> ready;
+  while (true) {
+    while (!runnable.empty()) {
+      Fiber *fiber = runnable.front();
+      runnable.pop_front();
+      execute(*fiber);
+      if (aborted) {
+        abortRun();
+        return;
+      }
+    }
+    if (!events.hasWaiters()) {
+      return;
+    }
+
+    int timeout = -1;
+    if (deadline != Clock::time_point::max()) {
+      auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline -
+                                                               Clock::now());
+      timeout = static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(
+          left.count(), 0, std::numeric_limits<int>::max()));
+    }
+    events.wait(ready, timeout);
+    if (ready.empty() && Clock::now() >= deadline) {
+      for (auto &fiber : fibers) {
+        if (fiber->state == Fiber::State::Blocked) {
+          fiber->program->error("Time limit exceeded",
+                                fiber->chunk->locations[fiber->pc]);
+          break;
+        }
+      }
+      abortRun();
+      return;
+    }
+    for (Fiber *fiber : ready) {
+      fiber->state = Fiber::State::Runnable;
+      runnable.push_back(fiber);
+    }
+    ready.clear();
+  }
+}
+
+const Fiber *Scheduler::fiber(std::size_t id) const {
+  if (id >= fibers.size()) {
+    return nullptr;
+  }
+  return fibers[id].get();
+}
+
+void Scheduler::yield() { yieldRequested = true; }
+
+std::optional<Value> Scheduler::join(std::size_t id) {
+  lox_assert_neq(current, nullptr, "join outside of a running fiber");
+  if (id >= fibers.size()) {
+    throw NativeError("No such fiber");
+  }
+  Fiber &target = *fibers[id];
+  switch (target.state) {
+  case Fiber::State::Done: return target.result;
+  case Fiber::State::Failed: return Value();
+  default:
+    if (&target == current) {
+      throw NativeError("A fiber cannot wait for itself");
+    }
+    target.joiners.push_back(current);
+    blockRequested = true;
+    return std::nullopt;
+  }
+}
+
+bool Scheduler::waitFor(int fd, EventLoop::Interest interest) {
+  lox_assert_neq(current, nullptr, "waitFor outside of a running fiber");
+  if (!events.add(fd, interest, current)) {
+    return false;
+  }
+  blockRequested = true;
+  return true;
+}
+
+void Scheduler::clear() {
+  lox_assert_eq(current, nullptr, "cannot clear while a fiber is running");
+  events.clear();
+  runnable.clear();
+  fibers.clear();
+}
+
+void Scheduler::finish(Fiber &fiber, Fiber::State state) {
+  fiber.state = state;
+  fiber.stack = {};
+  for (Fiber *joiner : fiber.joiners) {
+    joiner->state = Fiber::State::Runnable;
+    runnable.push_back(joiner);
+  }
+  fiber.joiners = {};
+}
+
+void Scheduler::fail(Fiber &fiber) {
+  yieldRequested = false;
+  blockRequested = false;
+  finish(fiber, Fiber::State::Failed);
+  current = nullptr;
+}
+
+void Scheduler::abortRun() {
+  events.clear();
+  runnable.clear();
+  for (auto &fiber : fibers) {
+    if (fiber->state == Fiber::State::Runnable ||
+        fiber->state == Fiber::State::Blocked) {
+      fiber->state = Fiber::State::Failed;
+      fiber->stack = {};
+      fiber->joiners = {};
+    }
+  }
+}
+
+void Scheduler::refuel() {
+  std::uint64_t until = std::min({limits.instructions, sliceEnd, timeCheck});
+  granted = until - std::min(executed, until);
+  fuel = granted;
+}
+
+bool Scheduler::safepoint(Fiber &fiber) {
+  executed += granted - fuel;
+  granted = 0;
+  fuel = 0;
+  if (executed >= limits.instructions) {
+    aborted = true;
+    runtimeError(fiber, "Instruction budget exhausted");
+  }
+  if (executed >= timeCheck) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      aborted = true;
+      runtimeError(fiber, "Time limit exceeded");
+    }
+    timeCheck = saturatingAdd(executed, RunLimits::timeCheckInterval);
+  }
+  if (executed >= sliceEnd) {
+    if (!runnable.empty()) {
+      lox_trace_instant("preempt");
+      ++preempted;
+      runnable.push_back(&fiber);
+      current = nullptr;
+      return false;
+    }
+    sliceEnd = saturatingAdd(executed, limits.timeSlice);
+  }
+  refuel();
+  return true;
+}
+
+void Scheduler::execute(Fiber &fiber) {
+  lox_trace_scope("fiber");
+  current = &fiber;
+  fiber.state = Fiber::State::Runnable;
+  const Chunk &chunk = *fiber.chunk;
+  std::vector<Value> &stack = fiber.stack;
+  executed += granted - fuel;
+  sliceEnd = saturatingAdd(executed, limits.timeSlice);
+  refuel();
+
+  try {
+    while (true) {
+      if (fuel == 0) [[unlikely]] {
+        if (!safepoint(fiber)) {
+          return;
+        }
+      }
+      --fuel;
+      Instruction in = chunk.code[fiber.pc];
+    dispatch:
+      switch (in.op) {
+      case OpCode::Constant: stack.push_back(chunk.constants[in.index]); break;
+
+      case OpCode::GetGlobal: {
+        const Value *var = globals.variables.find(chunk.names[in.index]);
+        if (var == nullptr) {
+          runtimeError(fiber, "Undefined variable");
+        }
+        stack.push_back(*var);
+      } break;
+      case OpCode::SetGlobal:
+        globals.variables.insertOrAssign(chunk.names[in.index], stack.back());
+        break;
+
+      case OpCode::Equal: {
+        Value right = pop(stack);
+        stack.back() = stack.back() == right;
+      } break;
+      case OpCode::NotEqual: {
+        Value right = pop(stack);
+        stack.back() = !(stack.back() == right);
+      } break;
+      case OpCode::Greater: {
+        double right = number(fiber, pop(stack));
+        stack.back() = number(fiber, stack.back()) > right;
+      } break;
+      case OpCode::GreaterEq: {
+        double right = number(fiber, pop(stack));
+        stack.back() = number(fiber, stack.back()) >= right;
+      } break;
+      case OpCode::Less: {
+        double right = number(fiber, pop(stack));
+        stack.back() = number(fiber, stack.back()) < right;
+      } break;
+      case OpCode::LessEq: {
+        double right = number(fiber, pop(stack));
+        stack.back() = number(fiber, stack.back()) <= right;
+      } break;
+
+      case OpCode::Add: {
+        Value right = pop(stack);
+        Value &left = stack.back();
+        if (left.type() == Value::Type::String &&
+            right.type() == Value::Type::String) {
+          left = LoxString::concat(left.getLoxString(), right.getLoxString());
+        } else if (left.type() == Value::Type::Number &&
+                   right.type() == Value::Type::Number) {
+          left = left.getNumber() + right.getNumber();
+        } else {
+          runtimeError(fiber, "Operands must be two numbers or two strings");
+        }
+      } break;
+      case OpCode::Subtract: {
+        double right = number(fiber, pop(stack));
+        stack.back() = number(fiber, stack.back()) - right;
+      } break;
+      case OpCode::Multiply: {
+        double right = number(fiber, pop(stack));
+        stack.back() = number(fiber, stack.back()) * right;
+      } break;
+      case OpCode::Divide: {
+        double right = number(fiber, pop(stack));
+        stack.back() = number(fiber, stack.back()) / right;
+      } break;
+      case OpCode::Not: stack.back() = !isTruthy(stack.back()); break;
+      case OpCode::Negate:
+        stack.back() = -number(fiber, stack.back());
+        break;
+
+      case OpCode::GetIndex: {
+        Value index = pop(stack);
+        Value &container = stack.back();
+        if (container.type() == Value::Type::Array) {
+          const Array &a = *container.getArray();
+          container = a.get(arrayIndex(fiber, a, index));
+        } else if (container.type() == Value::Type::Map) {
+          const Value *value = container.getMap()->get(mapKey(fiber, index));
+          // copy before the map (possibly the last owner of value) is released
+          Value result = value != nullptr ? *value : Value();
+          container = std::move(result);
+        } else {
+          runtimeError(fiber, "Only arrays and maps can be indexed");
+        }
+      } break;
+      case OpCode::SetIndex: {
+        Value value = pop(stack);
+        Value index = pop(stack);
+        Value &container = stack.back();
+        if (container.type() == Value::Type::Array) {
+          Array &a = *container.getArray();
+          a.set(arrayIndex(fiber, a, index), value);
+        } else if (container.type() == Value::Type::Map) {
+          container.getMap()->set(mapKey(fiber, index), value);
+        } else {
+          runtimeError(fiber, "Only arrays and maps can be indexed");
+        }
+        container = std::move(value);
+      } break;
+      case OpCode::BuildMap: {
+        auto map = std::make_shared<Map>();
+        auto entries = std::span<const Value>(stack).last(2 * in.count);
+        for (std::size_t i = 0; i < entries.size(); i += 2) {
+          map->set(mapKey(fiber, entries[i]), entries[i + 1]);
+        }
+        stack.resize(stack.size() - entries.size());
+        stack.push_back(std::move(map));
+      } break;
+
+      case OpCode::Call: {
+        const Native &native = globals.natives.at(in.index);
+        if (!native.fn) {
+          runtimeError(fiber, "Can only call functions");
+        }
+        if (native.arity != in.count) {
+          runtimeError(fiber, "Wrong number of arguments");
+        }
+
+        auto args = std::span<const Value>(stack).last(in.count);
+        Value result;
+        try {
+          const trace::Scope traced(native.traceName);
+          result = native.fn(args);
+        } catch (NativeError &e) {
+          runtimeError(fiber, e.what());
+        } catch (HeapLimitError &e) {
+          runtimeError(fiber, e.what());
+        } catch (std::bad_alloc &) {
+          runtimeError(fiber, "Out of memory");
+        } catch (std::length_error &) {
+          runtimeError(fiber, "Out of memory");
+        }
+
+        if (blockRequested) {
+          // Leave the arguments where they are; the call is repeated once the
+          // fiber is resumed.
+          blockRequested = false;
+          fiber.state = Fiber::State::Blocked;
+          current = nullptr;
+          return;
+        }
+        stack.resize(stack.size() - in.count);
+        stack.push_back(std::move(result));
+        if (yieldRequested) {
+          yieldRequested = false;
+          fiber.pc++;
+          runnable.push_back(&fiber);
+          current = nullptr;
+          return;
+        }
+      } break;
+
+      case OpCode::JumpIfFalse:
+        if (!isTruthy(stack.back())) {
+          fiber.pc = in.index;
+          continue;
+        }
+        break;
+      case OpCode::JumpIfTrue:
+        if (isTruthy(stack.back())) {
+          fiber.pc = in.index;
+          continue;
+        }
+        break;
+      case OpCode::Pop: stack.pop_back(); break;
+
+      case OpCode::Breakpoint:
+        lox_assert_neq(debugger, nullptr, "breakpoint without a debugger");
+        in = debugger->hit(fiber);
+        goto dispatch;
+
+      case OpCode::Return:
+        fiber.result = pop(stack);
+        finish(fiber, Fiber::State::Done);
+        current = nullptr;
+        return;
+
+      default: lox_fail("bad op code");
+      }
+      fiber.pc++;
+    }
+  } catch (HeapLimitError &e) {
+    fiber.program->error(e.what(), chunk.locations[fiber.pc]);
+    fail(fiber);
+  } catch (RuntimePanic &) {
+    fail(fiber);
+  }
+}
@@ -0,0 +1,217 @@
+#ifndef LOXLANG_LIB_INTERPRETER_HPP
+#define LOXLANG_LIB_INTERPRETER_HPP
+
+#include "lib/Chunk.hpp"
+#include "lib/EventLoop.hpp"
+#include "lib/HashMap.hpp"
+#include "lib/Natives.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Program.hpp"
+#include "lib/Util.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace loxlang::interpret {
+
+class Debugger;
+
+/**
+ * @brief The global state a Lox program is evaluated in.
+ */
+struct Globals {
+  util::OpenHashMap<std::string, Value, util::StringHash, std::equal_to<>>
+      variables;
+  NativeRegistry natives;
+};
+
+/**
+ * @brief A lightweight thread of Lox execution.
+ * @details A fiber is just an instruction pointer into a chunk and its own
+ * operand stack, so it can be suspended between any two instructions at the
+ * cost of a few hundred bytes.
+ */
+struct Fiber {
+  enum class State : std::uint8_t { Runnable, Blocked, Done, Failed };
+
+  std::size_t id;
+  Program *program;
+  const compile::Chunk *chunk;
+  std::size_t pc = 0;
+  std::vector<Value> stack;
+  State state = State::Runnable;
+
+  /**
+   * @brief The value of the chunk, once the fiber is `Done`
+   */
+  Value result;
+
+  /**
+   * @brief Fibers blocked until this one has finished
+   */
+  std::vector<Fiber *> joiners;
+};
+
+/**
+ * @brief Limits on the execution of the fibers of a `Scheduler::run`.
+ */
+struct RunLimits {
+  static constexpr std::uint64_t unlimited =
+      std::numeric_limits<std::uint64_t>::max();
+
+  /**
+   * @brief The number of instructions all fibers of a run may execute
+   * together. Then the run is aborted: the running fiber fails with a runtime
+   * error, and all others fail, too.
+   */
+  std::uint64_t instructions = unlimited;
+
+  /**
+   * @brief The wall clock time a run may take, after which it is aborted
+   * like for `instructions`. Checked every `timeCheckInterval` instructions
+   * and while fibers wait for I/O.
+   */
+  std::chrono::nanoseconds time = std::chrono::nanoseconds::max();
+
+  /**
+   * @brief A fiber that executed this many instructions in a row is
+   * preempted if another fiber is runnable, so that a busy fiber does not
+   * starve the others.
+   */
+  std::uint64_t timeSlice = unlimited;
+
+  static constexpr std::uint64_t timeCheckInterval = 1024;
+};
+
+/**
+ * @brief Single threaded scheduler for fibers.
+ * @details Fibers run until they finish, yield, wait for another fiber or are
+ * preempted at the end of their time slice (see `RunLimits`); runnable
+ * fibers are then resumed in round-robin order.
+ *
+ * The interpreter counts the executed instructions with a single counter
+ * that runs down to the next safepoint, the nearest point at which a limit
+ * might be reached. Only there are the limits checked.
+ */
+class Scheduler {
+public:
+  explicit Scheduler(Globals &globals) : globals{globals} {}
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  /**
+   * @brief Create a new runnable fiber.
+   * @param program The program the chunk was compiled from, used for error
+   * reporting
+   * @param chunk The code of the fiber. It has to outlive the fiber.
+   * @return The id of the new fiber
+   */
+  std::size_t spawn(Program &program, const compile::Chunk &chunk);
+
+  /**
+   * @brief Run fibers until none is runnable any more.
+   * @details While fibers wait for I/O, this blocks until one of them can
+   * continue.
+   */
+  void run();
+
+  /**
+   * @brief Access a fiber by its id.
+   * @return The fiber, or nullptr if there is no such fiber.
+   */
+  const Fiber *fiber(std::size_t id) const;
+
+  /**
+   * @brief For host functions: suspend the calling fiber after the call
+   * returns and let the other fibers run.
+   */
+  void yield();
+
+  /**
+   * @brief For host functions: wait for a fiber to finish.
+   * @details If the fiber has not finished yet, the calling fiber is
+   * suspended, and the call will be repeated once the fiber has finished.
+   * @return The result of the fiber (nil if it failed), or `std::nullopt` if
+   * the caller has to be suspended. In that case, the host function should
+   * return right away; its return value is discarded.
+   */
+  std::optional<Value> join(std::size_t id);
+
+  /**
+   * @brief For host functions: wait until a file descriptor is ready.
+   * @details The calling fiber is suspended, and the call will be repeated
+   * once `fd` is ready. Other fibers continue to run in the meantime.
+   * @return `true` if the caller has to be suspended. In that case, the host
+   * function should return right away; its return value is discarded. `false`
+   * if `fd` is always ready, so waiting makes no sense.
+   */
+  bool waitFor(int fd, EventLoop::Interest interest);
+
+  /**
+   * @brief Delete all fibers.
+   */
+  void clear();
+
+  /**
+   * @brief Limit the following runs.
+   */
+  void setLimits(RunLimits limits) { this->limits = limits; }
+
+  /**
+   * @brief The number of instructions executed by the last run.
+   */
+  std::uint64_t instructions() const { return executed + (granted - fuel); }
+
+  /**
+   * @brief The number of times a fiber was preempted, over all runs.
+   */
+  std::uint64_t preemptions() const { return preempted; }
+
+  /**
+   * @brief Hand `Breakpoint` instructions to a debugger.
+   * @param debugger The debugger, or nullptr. It has to outlive the fibers it
+   * stops.
+   */
+  void setDebugger(Debugger *debugger) { this->debugger = debugger; }
+
+private:
+  void execute(Fiber &fiber);
+  void finish(Fiber &fiber, Fiber::State state);
+  void fail(Fiber &fiber);
+  bool safepoint(Fiber &fiber);
+  void refuel();
+  void abortRun();
+
+  Globals &globals;
+  std::vector<std::unique_ptr<Fiber>> fibers;
+  std::deque<Fiber *> runnable;
+  EventLoop events;
+  Debugger *debugger = nullptr;
+  Fiber *current = nullptr;
+  bool yieldRequested = false;
+  bool blockRequested = false;
+
+  RunLimits limits;
+  std::chrono::steady_clock::time_point deadline;
+  // instructions until the next safepoint, and as many as were granted
+  std::uint64_t fuel = 0;
+  std::uint64_t granted = 0;
+  // instructions of the run up to the last refuel
+  std::uint64_t executed = 0;
+  // the end of the time slice of the current fiber
+  std::uint64_t sliceEnd = 0;
+  // when the clock is read next
+  std::uint64_t timeCheck = 0;
+  std::uint64_t preempted = 0;
+  bool aborted = false;
+};
+
+} // namespace loxlang::interpret
+
+#endif
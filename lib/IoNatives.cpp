@@ -0,0 +1,239 @@
+#include "lib/IoNatives.hpp"
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace loxlang;
+using namespace loxlang::interpret;
+
+namespace {
+
+constexpr std::size_t readChunkSize = 64 * 1024;
+
+[[noreturn]] void systemError() { throw NativeError(std::strerror(errno)); }
+
+bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+
+/**
+ * @brief The descriptor a script passes; 0, 1 and 2 are the standard streams
+ * of its session.
+ */
+int fdArg(const Value &v, const StdStreams &stdio) {
+  if (v.type() != Value::Type::Number || v.getNumber() < 0) {
+    throw NativeError("Expected a file descriptor");
+  }
+  auto fd = static_cast<int>(v.getNumber());
+  return fd < static_cast<int>(stdio.size()) ? stdio[static_cast<std::size_t>(fd)]
+                                             : fd;
+}
+
+const std::string &stringArg(const Value &v) {
+  if (v.type() != Value::Type::String) {
+    throw NativeError("Expected a string");
+  }
+  return v.getString();
+}
+
+/**
+ * @brief Whether I/O on a descriptor may block the thread.
+ * @details The descriptors the natives create are non-blocking. Inherited
+ * ones (such as 0, 1 and 2) are left alone: `O_NONBLOCK` is shared with
+ * every process using the same open file, like the parent shell.
+ */
+bool isBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) {
+    systemError();
+  }
+  return (flags & O_NONBLOCK) == 0;
+}
+
+bool isReady(int fd, short events) {
+  pollfd ready{.fd = fd, .events = events, .revents = 0};
+  int count = -1;
+  do {
+    count = poll(&ready, 1, 0);
+  } while (count < 0 && errno == EINTR);
+  if (count < 0) {
+    systemError();
+  }
+  return count > 0;
+}
+
+sockaddr_un unixAddress(const std::string &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw NativeError("Socket path too long");
+  }
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return addr;
+}
+
+int unixSocket() {
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    systemError();
+  }
+  return fd;
+}
+
+Value openFile(std::span<const Value> args) {
+  const std::string &mode = stringArg(args[1]);
+  int flags = O_CLOEXEC | O_NONBLOCK;
+  if (mode == "r") {
+    flags |= O_RDONLY;
+  } else if (mode == "w") {
+    flags |= O_WRONLY | O_CREAT | O_TRUNC;
+  } else if (mode == "a") {
+    flags |= O_WRONLY | O_CREAT | O_APPEND;
+  } else {
+    throw NativeError("Mode must be \"r\", \"w\" or \"a\"");
+  }
+  constexpr mode_t permissions = 0666;
+  int fd = open(stringArg(args[0]).c_str(), flags, permissions);
+  if (fd < 0) {
+    systemError();
+  }
+  return static_cast<double>(fd);
+}
+
+Value closeFd(const StdStreams &stdio, std::span<const Value> args) {
+  int fd = fdArg(args[0], stdio);
+  if (std::ranges::find(stdio, fd) != stdio.end()) {
+    // they belong to the host, which may still write to them
+    throw NativeError("Cannot close a standard stream");
+  }
+  if (close(fd) < 0) {
+    systemError();
+  }
+  return Value();
+}
+
+Value readFd(Scheduler &scheduler, const StdStreams &stdio,
+             std::span<const Value> args) {
+  int fd = fdArg(args[0], stdio);
+  if (isBlocking(fd) && !isReady(fd, POLLIN) &&
+      scheduler.waitFor(fd, EventLoop::Interest::Read)) {
+    return Value();
+  }
+  std::string buffer(readChunkSize, '\0');
+  ssize_t count = -1;
+  do {
+    count = read(fd, buffer.data(), buffer.size());
+  } while (count < 0 && errno == EINTR);
+
+  if (count < 0) {
+    if (wouldBlock() && scheduler.waitFor(fd, EventLoop::Interest::Read)) {
+      return Value();
+    }
+    systemError();
+  }
+  if (count == 0) {
+    return Value();
+  }
+  buffer.resize(static_cast<std::size_t>(count));
+  return Value(std::move(buffer));
+}
+
+Value writeFd(Scheduler &scheduler, const StdStreams &stdio,
+              std::span<const Value> args) {
+  int fd = fdArg(args[0], stdio);
+  const std::string &data = stringArg(args[1]);
+  std::size_t size = data.size();
+  if (isBlocking(fd)) {
+    if (!isReady(fd, POLLOUT) &&
+        scheduler.waitFor(fd, EventLoop::Interest::Write)) {
+      return Value();
+    }
+    // a ready pipe takes this much without blocking
+    size = std::min<std::size_t>(size, PIPE_BUF);
+  }
+  ssize_t count = -1;
+  do {
+    count = write(fd, data.data(), size);
+  } while (count < 0 && errno == EINTR);
+
+  if (count < 0) {
+    if (wouldBlock() && scheduler.waitFor(fd, EventLoop::Interest::Write)) {
+      return Value();
+    }
+    systemError();
+  }
+  return static_cast<double>(count);
+}
+
+Value listenOn(std::span<const Value> args) {
+  sockaddr_un addr = unixAddress(stringArg(args[0]));
+  int fd = unixSocket();
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto *sa = reinterpret_cast<sockaddr *>(&addr);
+  constexpr int backlog = 128;
+  if (bind(fd, sa, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+    int err = errno;
+    close(fd);
+    errno = err;
+    systemError();
+  }
+  return static_cast<double>(fd);
+}
+
+Value acceptOn(Scheduler &scheduler, const StdStreams &stdio,
+               std::span<const Value> args) {
+  int fd = fdArg(args[0], stdio);
+  int client = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (client < 0) {
+    if (wouldBlock() && scheduler.waitFor(fd, EventLoop::Interest::Read)) {
+      return Value();
+    }
+    systemError();
+  }
+  return static_cast<double>(client);
+}
+
+Value connectTo(std::span<const Value> args) {
+  sockaddr_un addr = unixAddress(stringArg(args[0]));
+  int fd = unixSocket();
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+  auto *sa = reinterpret_cast<sockaddr *>(&addr);
+  // Connecting to a local socket does not wait for the peer, only for room in
+  // its backlog.
+  if (connect(fd, sa, sizeof(addr)) < 0) {
+    int err = errno;
+    close(fd);
+    errno = err;
+    systemError();
+  }
+  return static_cast<double>(fd);
+}
+
+} // namespace
+
+void interpret::defineIoNatives(Globals &globals, Scheduler &scheduler,
+                                StdStreams stdio) {
+  auto define = [&globals](const char *name, std::size_t arity, NativeFn fn) {
+    globals.natives.define(name, arity, std::move(fn));
+  };
+  define("open", 2, openFile);
+  define("close", 1, [stdio](std::span<const Value> args) {
+    return closeFd(stdio, args);
+  });
+  define("read", 1, [&scheduler, stdio](std::span<const Value> args) {
+    return readFd(scheduler, stdio, args);
+  });
+  define("write", 2, [&scheduler, stdio](std::span<const Value> args) {
+    return writeFd(scheduler, stdio, args);
+  });
+  define("listen", 1, listenOn);
+  define("accept", 1, [&scheduler, stdio](std::span<const Value> args) {
+    return acceptOn(scheduler, stdio, args);
+  });
+  define("connect", 1, connectTo);
+}
@@ -0,0 +1,46 @@
+#ifndef LOXLANG_LIB_IONATIVES_HPP
+#define LOXLANG_LIB_IONATIVES_HPP
+
+#include "lib/Interpreter.hpp"
+#include <array>
+#include <unistd.h>
+
+namespace loxlang::interpret {
+
+/**
+ * @brief Standard input, output and error, in this order.
+ */
+using StdStreams = std::array<int, 3>;
+
+/**
+ * @brief The standard streams of the process.
+ */
+inline constexpr StdStreams standardStreams = {STDIN_FILENO, STDOUT_FILENO,
+                                               STDERR_FILENO};
+
+/**
+ * @brief Define the natives for non-blocking I/O.
+ * @details File descriptors are passed around as numbers. Operations that
+ * would block suspend only the calling fiber until the descriptor is ready;
+ * the other fibers keep running.
+ * Inherited descriptors, such as the standard input and output, keep their
+ * blocking mode: they are polled before every read or write, and writes to
+ * them are limited to `PIPE_BUF` bytes.
+ *
+ * - `open(path, mode)`: open a file, `mode` is one of `"r"`, `"w"` or `"a"`
+ * - `close(fd)`
+ * - `read(fd)`: the next chunk of available data as a string, or nil at the
+ *   end of the input
+ * - `write(fd, string)`: the number of bytes written, which may be less than
+ *   the length of the string
+ * - `listen(path)`, `accept(fd)`, `connect(path)`: Unix domain sockets
+ *
+ * The descriptors 0, 1 and 2 stand for `stdio`, the standard streams of the
+ * script, which cannot be closed.
+ */
+void defineIoNatives(Globals &globals, Scheduler &scheduler,
+                     StdStreams stdio = standardStreams);
+
+} // namespace loxlang::interpret
+
+#endif
@@ -1,28 +1,55 @@
 #include "lib/LoxLang.hpp"
+#include "lib/Array.hpp"
 #include "lib/Ast.hpp"
+#include "lib/Daemon.hpp"
+#include "lib/Debugger.hpp"
+#include "lib/ModuleCache.hpp"
+#include "lib/Objects.hpp"
 #include "lib/Parser.hpp"
-#include "lib/Program.hpp"
 #include "lib/Scanner.hpp"
+#include "lib/ScriptPool.hpp"
+#include "lib/Session.hpp"
+#include "lib/Snapshot.hpp"
+#include "lib/Transpiler.hpp"
+#include <array>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <print>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <unistd.h>
+#include <vector>
 
-using namespace loxlang::scan;
-using namespace loxlang::ast;
-using namespace loxlang::parse;
+using namespace loxlang;
 
 namespace {
 
-std::string readFile(std::string_view name) {
+/**
+ * @brief The number of files whose compiled code a daemon keeps.
+ */
+constexpr std::size_t daemonCacheSize = 256;
+
+std::optional<FlushPolicy> flushPolicy;
+
+void setup(Session &session) {
+  session.defineIoNatives();
+  if (flushPolicy.has_value()) {
+    session.output().setPolicy(*flushPolicy);
+  }
+}
+
+std::string readFile(std::string_view name, Output &out) {
   using namespace std::filesystem;
 
-  std::println("run file {}...", name);
+  out.println("run file {}...", name);
   path path = absolute(name);
 
   if (!exists(path)) {
-    std::println("file {} does not exist", path.c_str());
+    out.println("file {} does not exist", path.c_str());
     return "";
   }
 
@@ -32,41 +59,246 @@ std::string readFile(std::string_view name) {
   return std::string(begin, end);
 }
 
-std::string readFromPrompt() {
-  std::print("\033[1mlox>\033[0m ");
+std::string readFromPrompt(Output &out) {
+  out.print("\033[1mlox>\033[0m ");
+  out.flush();
   std::string line;
   std::getline(std::cin, line);
   return line;
 }
 
+void printResult(Output &out, const std::optional<Value> &result) {
+  if (!result.has_value()) {
+    return;
+  }
+  std::string text;
+  format(text, result.value());
+  out.println("{}", text);
+}
+
 } // namespace
 
+void loxlang::setFlushPolicy(FlushPolicy policy) {
+  flushPolicy = policy;
+  Output::standard().setPolicy(policy);
+}
+
 void loxlang::runPrompt() {
+  Session session;
+  setup(session);
   while (true) {
-    std::string text = readFromPrompt();
+    std::string text = readFromPrompt(session.output());
     if (text.empty()) {
       break;
     }
-    run("REPL", text);
+    printResult(session.output(), session.eval(text, "REPL"));
   }
 }
 
 void loxlang::runFile(std::string_view name) {
-  std::string text = readFile(name);
-  run(name, text);
+  Session session;
+  setup(session);
+  std::string text = readFile(name, session.output());
+  if (text.empty()) {
+    return;
+  }
+  printResult(session.output(), session.eval(text, name));
 }
 
-void loxlang::run(std::string_view filename, std::string_view text) {
+void loxlang::makeSnapshot(std::string_view prelude,
+                           std::string_view snapshot) {
+  Session session;
+  setup(session);
+  std::string text = readFile(prelude, session.output());
+  if (!session.eval(text, prelude).has_value()) {
+    return;
+  }
+  try {
+    session.saveSnapshot(snapshot);
+  } catch (snapshot::SnapshotError &e) {
+    session.output().println("{}", e.what());
+  }
+}
+
+void loxlang::runFileWithSnapshot(std::string_view snapshot,
+                                  std::string_view name) {
+  Session session;
+  setup(session);
+  std::string text = readFile(name, session.output());
   if (text.empty()) {
     return;
   }
+  try {
+    session.loadSnapshot(snapshot);
+  } catch (std::runtime_error &e) {
+    session.output().println("{}", e.what());
+    return;
+  }
+  printResult(session.output(), session.eval(text, name));
+}
+
+void loxlang::runDaemon(std::string_view socket) {
+  Output &out = Output::standard();
+  ModuleCache cache(daemonCacheSize);
+  auto handle = [&cache](std::span<const std::string> args,
+                         const std::array<int, 3> &stdio) {
+    // every request gets a fresh session, writing to the client's output
+    Session session(stdio);
+    setup(session);
+    Output &clientOut = session.output();
+    if (args.empty()) {
+      clientOut.println("no script given");
+      return 1;
+    }
+    std::vector<Value> scriptArgs;
+    for (const std::string &arg : args.subspan(1)) {
+      scriptArgs.emplace_back(std::string(arg));
+    }
+    session.setGlobal("args", std::make_shared<Array>(std::move(scriptArgs)));
+    Session::Script *script = cache.get(session, args[0]);
+    std::optional<Value> result = std::nullopt;
+    if (script != nullptr) {
+      result = session.run(*script);
+      printResult(clientOut, result);
+    }
+    return result.has_value() ? 0 : 1;
+  };
+
+  try {
+    Daemon daemon(socket, handle);
+    out.println("listening on {}", socket);
+    out.flush();
+    daemon.serve();
+  } catch (std::runtime_error &e) {
+    out.println("{}", e.what());
+  }
+}
 
-  auto program = Program(filename, text);
-  Scanner scanner = Scanner(program);
-  std::unique_ptr<Ast> ast = parse::parse(program, scanner);
-  if (ast == nullptr) {
+int loxlang::runClient(std::string_view socket,
+                       std::span<const std::string_view> args) {
+  if (args.empty()) {
+    return 1;
+  }
+  // the daemon runs in a different working directory
+  std::string script = std::filesystem::absolute(args[0]).string();
+  std::vector<std::string_view> request(args.begin(), args.end());
+  request[0] = script;
+  try {
+    return sendRequest(socket, request);
+  } catch (std::runtime_error &e) {
+    Output::standard().println("{}", e.what());
+    return 1;
+  }
+}
+
+void loxlang::debugFile(std::string_view name) {
+  Session session;
+  setup(session);
+  // the debugger talks on std::cout in between
+  session.output().setPolicy(FlushPolicy::Line);
+  std::string text = readFile(name, session.output());
+  if (text.empty()) {
     return;
   }
+  interpret::Debugger debugger(std::cin, std::cout);
+  session.attachDebugger(&debugger);
+  debugger.pause();
+  printResult(session.output(), session.eval(text, name));
+  session.attachDebugger(nullptr);
+}
+
+bool loxlang::checkFile(std::string_view name) {
+  Output &out = Output::standard();
+  std::ifstream file;
+  if (name != "-") {
+    file.open(std::filesystem::path(name));
+    if (!file) {
+      out.println("cannot read {}", name);
+      return false;
+    }
+  }
+  std::istream &in = name == "-" ? std::cin : file;
+  Program program(name, "");
+  scan::Scanner scanner(program, scan::streamSource(in));
+  std::size_t tokens = 0;
+  for (scan::Token t = scanner.next(); t.type != scan::Token::Type::Eof;
+       t = scanner.next()) {
+    tokens++;
+  }
+  out.println("{}: {} tokens", name, tokens);
+  return !program.hadError();
+}
+
+bool loxlang::transpileFile(std::string_view name, std::string_view output) {
+  Output &out = Output::standard();
+  std::ifstream in{std::filesystem::path(name)};
+  if (!in) {
+    out.println("cannot read {}", name);
+    return false;
+  }
+  std::string text{std::istreambuf_iterator<char>(in),
+                   std::istreambuf_iterator<char>()};
+  Program program(name, text);
+  scan::Scanner scanner(program);
+  std::unique_ptr<ast::Ast> ast = parse::parse(program, scanner);
+  if (ast == nullptr || program.hadError()) {
+    return false;
+  }
+  std::optional<std::string> code =
+      transpile::transpile(program, ast.get(), name);
+  if (!code.has_value()) {
+    return false;
+  }
+  std::ofstream file{std::filesystem::path(output)};
+  file << *code;
+  if (!file.flush()) {
+    out.println("cannot write {}", output);
+    return false;
+  }
+  return true;
+}
+
+void loxlang::run(std::string_view filename, std::string_view text) {
+  if (text.empty()) {
+    return;
+  }
+
+  Session session;
+  setup(session);
+  printResult(session.output(), session.eval(text, filename));
+}
+
+void loxlang::runFiles(std::span<const std::string_view> names,
+                       std::size_t threads) {
+  Output &out = Output::standard();
+  std::vector<Job> jobs;
+  jobs.reserve(names.size());
+  for (std::string_view name : names) {
+    jobs.push_back(Job{readFile(name, out), Value(), std::string(name)});
+  }
+  out.flush();
+
+  ScriptPool pool = ScriptPool(threads, setup);
+  BatchReport report = pool.run(jobs);
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    if (!report.results[i].value.has_value()) {
+      out.println("{}: error", names[i]);
+      continue;
+    }
+    out.print("{}: ", names[i]);
+    printResult(out, report.results[i].value);
+  }
 
-  std::println("AST:\n{}\n", ast->stringify());
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  out.println("{} jobs in {} µs, {:.1f} jobs/s", report.results.size(),
+              duration_cast<microseconds>(report.elapsed).count(),
+              report.throughput());
+  out.println("latency p50 {} µs, p90 {} µs, p99 {} µs, max {} µs",
+              duration_cast<microseconds>(report.p50).count(),
+              duration_cast<microseconds>(report.p90).count(),
+              duration_cast<microseconds>(report.p99).count(),
+              duration_cast<microseconds>(report.max).count());
+  out.println("longest queue wait {} µs",
+              duration_cast<microseconds>(report.maxWait).count());
 }
@@ -10,6 +10,9 @@
 #ifndef LOXLANG_LIB_LOXLANG_HPP
 #define LOXLANG_LIB_LOXLANG_HPP
 
+#include "lib/Output.hpp"
+#include <cstddef>
+#include <span>
 #include <string_view>
 
 /**
@@ -18,10 +21,19 @@
  */
 namespace loxlang {
 
+/**
+ * @brief Choose when the output of the following runs is written.
+ * @details Applies to the standard `Output` and to the sessions created by
+ * the functions of this header. By default, output to a terminal is line
+ * buffered, and other output is fully buffered (see `FlushPolicy`).
+ */
+void setFlushPolicy(FlushPolicy policy);
+
 /**
  * @brief Run a Read-Evaluate-Print loop on the standard input/output.
  * @details This is roughly equivalent to run `loxlang` without any additional
- * parameters to enter the REPL.
+ * parameters to enter the REPL. All lines are evaluated in the same
+ * `Session`, so later lines see the definitions of earlier ones.
  */
 void runPrompt();
 
@@ -32,6 +44,72 @@ void runPrompt();
  */
 void runFile(std::string_view name);
 
+/**
+ * @brief Evaluate a prelude and save the resulting global variables.
+ * @details See `Session::saveSnapshot`.
+ * @param prelude the name of the file with the prelude
+ * @param snapshot the name of the snapshot file to write
+ */
+void makeSnapshot(std::string_view prelude, std::string_view snapshot);
+
+/**
+ * @brief Interpret a file, starting with the global variables of a snapshot.
+ * @details Equivalent to running the prelude the snapshot was made from
+ * before the file, without the cost of evaluating it again.
+ * @param snapshot the name of the snapshot file
+ * @param name the name of the file
+ */
+void runFileWithSnapshot(std::string_view snapshot, std::string_view name);
+
+/**
+ * @brief Serve run requests of `runClient` on a Unix socket, forever.
+ * @details Every request runs a script file in a fresh `Session`, the
+ * global `args` holding the remaining arguments of the request. Requests are
+ * served concurrently. The compiled code of recently used files is shared by
+ * the sessions (see `ModuleCache`), so running a file again skips parsing and
+ * compiling it.
+ * @param socket the path of the socket
+ */
+void runDaemon(std::string_view socket);
+
+/**
+ * @brief Run a script file on a daemon started with `runDaemon`.
+ * @details The script uses the standard input and output of this process.
+ * @param socket the path of the daemon's socket
+ * @param args the name of the file, followed by the arguments for the script
+ * @return the exit status: 0 if the script ran without errors
+ */
+int runClient(std::string_view socket, std::span<const std::string_view> args);
+
+/**
+ * @brief Interpret a file under the control of a debugger.
+ * @details The program stops before its first instruction and reads debugger
+ * commands from the standard input (see `interpret::Debugger`).
+ * @param name the name of the file
+ */
+void debugFile(std::string_view name);
+
+/**
+ * @brief Check that a file consists of valid Lox tokens.
+ * @details The file is read through a streaming `scan::Scanner`, so files of
+ * any size are checked in constant memory. Running a file needs all of its
+ * text, as the syntax tree points into it.
+ * @param name the name of the file, or "-" for the standard input
+ * @return `true` if no error was reported
+ */
+bool checkFile(std::string_view name);
+
+/**
+ * @brief Translate a file to a standalone C++ program.
+ * @details See `transpile::transpile`. Compiled with the system compiler and
+ * linked against the `lox` library, the program behaves like running the
+ * file with `runFile`, at native speed.
+ * @param name the name of the file
+ * @param output the name of the C++ file to write
+ * @return `true` if the file was written, `false` if an error was reported
+ */
+bool transpileFile(std::string_view name, std::string_view output);
+
 /**
  * @brief Interpret the contents of a string as a Lox program.
  * @param filename The name that the interpreter will use when telling the user
@@ -39,9 +117,21 @@ void runFile(std::string_view name);
  * be an arbitrary string that will be helpfull to the user. The
  * Read-Evaluate-Print Loop will pass "REPL" here.
  * @param text The program text to interpret.
+ * @details Every call uses a fresh interpreter state; use a `Session` (see
+ * `lib/Session.hpp`) to keep definitions between calls.
  */
 void run(std::string_view filename, std::string_view text);
 
+/**
+ * @brief Interpret many files concurrently.
+ * @details Runs every file as one job of a `ScriptPool` (see
+ * `lib/ScriptPool.hpp`) and prints the results followed by throughput,
+ * latency and queue wait statistics.
+ * @param names the names of the files
+ * @param threads the number of worker threads
+ */
+void runFiles(std::span<const std::string_view> names, std::size_t threads);
+
 } // namespace loxlang
 
 #endif
@@ -0,0 +1,59 @@
+#include "lib/Map.hpp"
+#include "lib/Error.hpp"
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+
+using namespace loxlang;
+
+std::size_t KeyHash::operator()(const Value &key) const {
+  switch (key.type()) {
+  case Value::Type::String: return key.getLoxString().hash();
+  case Value::Type::Number: {
+    double n = key.getNumber();
+    // 0.0 == -0.0, so they need the same hash
+    return std::hash<double>{}(n == 0 ? 0.0 : n);
+  }
+  default: lox_fail("not a map key");
+  }
+}
+
+bool Map::isKey(const Value &key) {
+  switch (key.type()) {
+  case Value::Type::String: return true;
+  case Value::Type::Number: return !std::isnan(key.getNumber());
+  default: return false;
+  }
+}
+
+Map::Map() : charge{HeapKind::Map, footprint(0)} {}
+
+void Map::set(Value key, Value value) {
+  lox_assert(isKey(key), "valid map key");
+  std::size_t capacity = entries.capacityFor(entries.size() + 1);
+  if (capacity != entries.capacity() && !entries.contains(key)) {
+    // charge the table before it grows
+    charge.resize(footprint(capacity));
+  }
+  entries.insertOrAssign(std::move(key), std::move(value));
+}
+
+void loxlang::format(std::string &out, const Map &map) {
+  out += '{';
+  bool first = true;
+  map.forEach([&out, &first](const Value &key, const Value &value) {
+    out += first ? "" : ", ";
+    format(out, key);
+    out += ": ";
+    format(out, value);
+    first = false;
+  });
+  out += '}';
+}
+
+std::ostream &loxlang::operator<<(std::ostream &out, const Map &map) {
+  std::string text;
+  format(text, map);
+  return out << text;
+}
@@ -0,0 +1,71 @@
+#ifndef LOXLANG_LIB_MAP_HPP
+#define LOXLANG_LIB_MAP_HPP
+
+#include "lib/HashMap.hpp"
+#include "lib/Heap.hpp"
+#include "lib/Objects.hpp"
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <utility>
+
+namespace loxlang {
+
+/**
+ * @brief Hash of a valid map key (see `Map::isKey`).
+ * @details String hashes are cached in the string, so looking up the same
+ * string again does not hash its characters again.
+ */
+struct KeyHash {
+  std::size_t operator()(const Value &key) const;
+};
+
+/**
+ * @brief The Lox map: an unordered dictionary from strings and numbers to
+ * values.
+ * @details Shared by reference, like `Array`. The table is charged to the
+ * heap the map was created on.
+ */
+class Map {
+public:
+  Map();
+
+  /**
+   * @brief Whether `key` may be used as a key: a string or a number other
+   * than NaN.
+   */
+  static bool isKey(const Value &key);
+
+  /**
+   * @brief The value of `key`, or nullptr if it is not in the map.
+   */
+  const Value *get(const Value &key) const { return entries.find(key); }
+
+  void set(Value key, Value value);
+  bool remove(const Value &key) { return entries.erase(key); }
+  std::size_t size() const { return entries.size(); }
+
+  /**
+   * @brief Call `f(key, value)` for every entry, in no particular order.
+   */
+  template <typename F> void forEach(F &&f) const {
+    entries.forEach(std::forward<F>(f));
+  }
+
+private:
+  using Table = util::OpenHashMap<Value, Value, KeyHash>;
+
+  static std::size_t footprint(std::size_t capacity) {
+    return sizeof(Map) + capacity * Table::slotBytes();
+  }
+
+  Table entries;
+  HeapCharge charge;
+};
+
+void format(std::string &out, const Map &map);
+std::ostream &operator<<(std::ostream &out, const Map &map);
+
+} // namespace loxlang
+
+#endif
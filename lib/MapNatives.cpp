@@ -0,0 +1,38 @@
+#include "lib/MapNatives.hpp"
+#include "lib/Array.hpp"
+#include "lib/Map.hpp"
+#include <memory>
+#include <vector>
+
+using namespace loxlang;
+using namespace loxlang::interpret;
+
+namespace {
+
+using MapPtr = std::shared_ptr<Map>;
+
+const Value &keyArg(const Value &key) {
+  if (!Map::isKey(key)) {
+    throw NativeError("Map keys must be strings or numbers");
+  }
+  return key;
+}
+
+} // namespace
+
+void interpret::defineMapNatives(NativeRegistry &natives) {
+  natives.bind("has", [](const MapPtr &m, const Value &key) {
+    return m->get(keyArg(key)) != nullptr;
+  });
+  natives.bind("remove", [](const MapPtr &m, const Value &key) {
+    return m->remove(keyArg(key));
+  });
+  natives.bind("keys", [](const MapPtr &m) {
+    std::vector<Value> keys;
+    keys.reserve(m->size());
+    m->forEach([&keys](const Value &key, const Value & /*unused*/) {
+      keys.push_back(key);
+    });
+    return std::make_shared<Array>(std::move(keys));
+  });
+}
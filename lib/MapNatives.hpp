@@ -0,0 +1,22 @@
+#ifndef LOXLANG_LIB_MAPNATIVES_HPP
+#define LOXLANG_LIB_MAPNATIVES_HPP
+
+#include "lib/Natives.hpp"
+
+namespace loxlang::interpret {
+
+/**
+ * @brief Define the natives for maps.
+ * @details Maps are created with `{key: value, …}` and their entries accessed
+ * with `m[key]` (nil for missing keys) and `m[key] = v`; `len(m)` is their
+ * size.
+ *
+ * - `has(m, key)`: whether `key` is in `m`
+ * - `remove(m, key)`: remove `key`, returns whether it was in `m`
+ * - `keys(m)`: the keys of `m` as an array, in no particular order
+ */
+void defineMapNatives(NativeRegistry &natives);
+
+} // namespace loxlang::interpret
+
+#endif
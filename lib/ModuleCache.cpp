@@ -0,0 +1,103 @@
+#include "lib/ModuleCache.hpp"
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+
+using namespace loxlang;
+
+namespace {
+
+std::optional<std::string> readText(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return std::nullopt;
+  }
+  std::ostringstream text;
+  text << in.rdbuf();
+  return std::move(text).str();
+}
+
+} // namespace
+
+Session::Script *ModuleCache::get(Session &session,
+                                  const std::filesystem::path &path) {
+  std::string key = path.string();
+  std::error_code error;
+  std::filesystem::file_time_type mtime =
+      std::filesystem::last_write_time(path, error);
+  if (error) {
+    session.output().println("cannot read {}: {}", key, error.message());
+    return nullptr;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard{lock};
+    auto cached = byPath.find(key);
+    if (cached != byPath.end() && cached->second->mtime == mtime) {
+      hitCount++;
+      entries.splice(entries.begin(), entries, cached->second);
+      return session.adopt(store, *cached->second->script);
+    }
+  }
+
+  std::optional<std::string> text = readText(path);
+  if (!text.has_value()) {
+    session.output().println("cannot read {}", key);
+    return nullptr;
+  }
+  std::size_t hash = std::hash<std::string_view>{}(*text);
+  {
+    std::lock_guard<std::mutex> guard{lock};
+    auto cached = byPath.find(key);
+    if (cached != byPath.end() && cached->second->hash == hash) {
+      // touched, but not changed
+      hitCount++;
+      cached->second->mtime = mtime;
+      entries.splice(entries.begin(), entries, cached->second);
+      return session.adopt(store, *cached->second->script);
+    }
+  }
+
+  Session::Script *script = session.compile(*text, key);
+  if (script == nullptr) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> guard{lock};
+  missCount++;
+  if (auto cached = byPath.find(key); cached != byPath.end()) {
+    drop(cached->second);
+  }
+  Session::Script *stored = store.adopt(session, *script);
+  store.pin(*stored);
+  entries.push_front(Entry{key, mtime, hash, stored});
+  byPath.insert_or_assign(key, entries.begin());
+  if (entries.size() > capacity) {
+    drop(std::prev(entries.end()));
+  }
+  return script;
+}
+
+std::size_t ModuleCache::size() const {
+  std::lock_guard<std::mutex> guard{lock};
+  return entries.size();
+}
+
+std::size_t ModuleCache::hits() const {
+  std::lock_guard<std::mutex> guard{lock};
+  return hitCount;
+}
+
+std::size_t ModuleCache::misses() const {
+  std::lock_guard<std::mutex> guard{lock};
+  return missCount;
+}
+
+void ModuleCache::drop(std::list<Entry>::iterator entry) {
+  store.forget(*entry->script);
+  byPath.erase(entry->path);
+  entries.erase(entry);
+}
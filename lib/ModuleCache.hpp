@@ -0,0 +1,70 @@
+#ifndef LOXLANG_LIB_MODULECACHE_HPP
+#define LOXLANG_LIB_MODULECACHE_HPP
+
+#include "lib/Session.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace loxlang {
+
+/**
+ * @brief The compiled code of recently used script files, shared by many
+ * sessions.
+ * @details A file is compiled once, by the first session that asks for it;
+ * later sessions get a copy of the compiled code (see `Session::adopt`),
+ * which is much cheaper than compiling it again. The cache keeps its own
+ * copies in a session of its own that never runs anything.
+ *
+ * An entry is looked up by path and is valid as long as the file's
+ * modification time is unchanged. If the file has been touched but its
+ * content hash is the same, the entry is still used. Once there are more
+ * than `capacity` entries, the least recently used one is dropped.
+ *
+ * The cache is thread safe: sessions on different threads may use it at the
+ * same time. Compiling happens outside of the cache's lock, copying inside.
+ */
+class ModuleCache {
+public:
+  explicit ModuleCache(std::size_t capacity) : capacity{capacity} {}
+  ModuleCache(const ModuleCache &) = delete;
+  ModuleCache &operator=(const ModuleCache &) = delete;
+
+  /**
+   * @brief The compiled script in a file, in `session`.
+   * @return The script, valid like one returned by `Session::compile`, or
+   * nullptr if the file cannot be read or has errors. The errors have already
+   * been reported to the session's output.
+   */
+  Session::Script *get(Session &session, const std::filesystem::path &path);
+
+  std::size_t size() const;
+  std::size_t hits() const;
+  std::size_t misses() const;
+
+private:
+  struct Entry {
+    std::string path;
+    std::filesystem::file_time_type mtime;
+    std::size_t hash;
+    Session::Script *script;
+  };
+
+  void drop(std::list<Entry>::iterator entry);
+
+  mutable std::mutex lock;
+  Session store;
+  std::size_t capacity;
+  // most recently used first
+  std::list<Entry> entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> byPath;
+  std::size_t hitCount = 0;
+  std::size_t missCount = 0;
+};
+
+} // namespace loxlang
+
+#endif
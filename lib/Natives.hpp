@@ -0,0 +1,229 @@
+#ifndef LOXLANG_LIB_NATIVES_HPP
+#define LOXLANG_LIB_NATIVES_HPP
+
+#include "lib/Objects.hpp"
+#include "lib/Trace.hpp"
+#include "lib/Util.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace loxlang::interpret {
+
+/**
+ * @brief A function implemented by the host program.
+ * @param args The evaluated arguments of the call. This is a view into the
+ * operand stack of the calling fiber; it is only valid during the call.
+ * @return The result of the call
+ */
+using NativeFn = std::function<Value(std::span<const Value> args)>;
+
+/**
+ * @brief A host function together with the number of arguments it expects.
+ */
+struct Native {
+  std::size_t arity;
+  NativeFn fn;
+
+  /**
+   * @brief The name calls are traced as, see `trace::intern`
+   */
+  std::uint32_t traceName = 0;
+};
+
+/**
+ * @brief Thrown by host functions to report a runtime error to the script.
+ * @details The error is reported at the call site and ends the calling fiber.
+ */
+struct NativeError : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+/**
+ * @brief How a parameter type of a bound host function is read from a `Value`.
+ * @details Specialized for `double`, `bool`, `std::string` (passed by const
+ * reference into the argument, without a copy), `std::shared_ptr<Array>`,
+ * `std::shared_ptr<Map>` and `Value` (any argument).
+ */
+template <typename T> struct NativeArg;
+
+template <> struct NativeArg<double> {
+  static constexpr std::string_view expected = "a number";
+  static bool matches(const Value &v) {
+    return v.type() == Value::Type::Number;
+  }
+  static double get(const Value &v) { return v.getNumber(); }
+};
+
+template <> struct NativeArg<bool> {
+  static constexpr std::string_view expected = "a boolean";
+  static bool matches(const Value &v) {
+    return v.type() == Value::Type::Boolean;
+  }
+  static bool get(const Value &v) { return v.getBool(); }
+};
+
+template <> struct NativeArg<std::string> {
+  static constexpr std::string_view expected = "a string";
+  static bool matches(const Value &v) {
+    return v.type() == Value::Type::String;
+  }
+  static const std::string &get(const Value &v) { return v.getString(); }
+};
+
+template <> struct NativeArg<std::shared_ptr<Array>> {
+  static constexpr std::string_view expected = "an array";
+  static bool matches(const Value &v) {
+    return v.type() == Value::Type::Array;
+  }
+  static const std::shared_ptr<Array> &get(const Value &v) {
+    return v.getArray();
+  }
+};
+
+template <> struct NativeArg<std::shared_ptr<Map>> {
+  static constexpr std::string_view expected = "a map";
+  static bool matches(const Value &v) { return v.type() == Value::Type::Map; }
+  static const std::shared_ptr<Map> &get(const Value &v) { return v.getMap(); }
+};
+
+template <> struct NativeArg<Value> {
+  static constexpr std::string_view expected = "a value";
+  static bool matches(const Value & /*unused*/) { return true; }
+  static const Value &get(const Value &v) { return v; }
+};
+
+namespace detail {
+
+template <typename F> struct Signature : Signature<decltype(&F::operator())> {};
+
+template <typename R, typename... A> struct Signature<R (*)(A...)> {
+  using Result = R;
+  using Args = std::tuple<std::remove_cvref_t<A>...>;
+};
+
+template <typename C, typename R, typename... A>
+struct Signature<R (C::*)(A...)> : Signature<R (*)(A...)> {};
+
+template <typename C, typename R, typename... A>
+struct Signature<R (C::*)(A...) const> : Signature<R (*)(A...)> {};
+
+template <typename T>
+concept SupportedArg = requires(const Value &v) {
+  { NativeArg<T>::matches(v) } -> std::same_as<bool>;
+  NativeArg<T>::get(v);
+};
+
+template <typename Arg>
+decltype(auto) checkedArg(std::span<const Value> args, std::size_t i) {
+  if (!NativeArg<Arg>::matches(args[i])) {
+    throw NativeError("Argument " + std::to_string(i + 1) + " must be " +
+                      std::string(NativeArg<Arg>::expected));
+  }
+  return NativeArg<Arg>::get(args[i]);
+}
+
+template <typename R, typename F, typename... A, std::size_t... I>
+NativeFn makeThunk(F fn, std::tuple<A...> * /*unused*/,
+                   std::index_sequence<I...> /*unused*/) {
+  static_assert((SupportedArg<A> && ...),
+                "native parameters must be double, bool, std::string, "
+                "std::shared_ptr<Array>, std::shared_ptr<Map> or Value");
+  static_assert(std::is_void_v<R> || std::is_convertible_v<R, Value>,
+                "natives must return void or something convertible to Value");
+  return [fn = std::move(fn)](std::span<const Value> args) -> Value {
+    if constexpr (std::is_void_v<R>) {
+      fn(checkedArg<A>(args, I)...);
+      return Value();
+    } else {
+      return Value(fn(checkedArg<A>(args, I)...));
+    }
+  };
+}
+
+} // namespace detail
+
+/**
+ * @brief The host functions available to Lox code.
+ * @details Every name gets a fixed slot, which compiled code refers to, so
+ * that calls do not have to look up the name. Slots are created on demand,
+ * also for names that do not have a definition (yet); calling such an empty
+ * slot is a runtime error.
+ */
+class NativeRegistry {
+public:
+  /**
+   * @brief Define a host function operating on raw values.
+   * @details A previous definition with the same name is replaced.
+   */
+  void define(std::string_view name, std::size_t arity, NativeFn fn) {
+    slots[slot(name)] = Native{arity, std::move(fn), trace::intern(name)};
+  }
+
+  /**
+   * @brief Define a typed host function.
+   * @details Arity and parameter types are taken from the signature of `fn`,
+   * and checked at compile time; see `NativeArg` for the supported types. The
+   * arguments are type checked on every call, before `fn` is invoked.
+   *
+   * ```cpp
+   * natives.bind("repeat", [](const std::string &s, double n) { ... });
+   * ```
+   */
+  template <typename F> void bind(std::string_view name, F fn) {
+    using Sig = detail::Signature<std::decay_t<F>>;
+    using Args = typename Sig::Args;
+    constexpr std::size_t arity = std::tuple_size_v<Args>;
+    define(name, arity,
+           detail::makeThunk<typename Sig::Result>(
+               std::move(fn), static_cast<Args *>(nullptr),
+               std::make_index_sequence<arity>()));
+  }
+
+  /**
+   * @brief The slot for a name, created if needed.
+   */
+  std::uint32_t slot(std::string_view name) {
+    auto entry = indices.find(name);
+    if (entry != indices.end()) {
+      return entry->second;
+    }
+    auto index = static_cast<std::uint32_t>(slots.size());
+    slots.push_back(Native{0, nullptr});
+    indices.emplace(name, index);
+    names.emplace_back(name);
+    return index;
+  }
+
+  /**
+   * @brief The name a slot was created for.
+   */
+  std::string_view name(std::uint32_t slot) const { return names[slot]; }
+
+  /**
+   * @brief The native in a slot. Its `fn` is empty if it was never defined.
+   * @details References stay valid when further slots are created.
+   */
+  const Native &at(std::uint32_t slot) const { return slots[slot]; }
+
+private:
+  std::deque<Native> slots;
+  std::deque<std::string> names;
+  std::unordered_map<std::string, std::uint32_t, util::StringHash,
+                     std::equal_to<>>
+      indices;
+};
+
+} // namespace loxlang::interpret
+
+#endif
@@ -1,16 +1,225 @@
 #include "lib/Objects.hpp"
+#include "lib/Array.hpp"
+#include "lib/Heap.hpp"
+#include "lib/Map.hpp"
+#include <array>
+#include <charconv>
+#include <format>
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 using namespace loxlang;
 
-std::ostream &loxlang::operator<<(std::ostream &out, const Value &v) {
+namespace {
+
+/**
+ * @brief Concatenations up to this length are copied instead of creating a
+ * rope node.
+ */
+constexpr std::size_t minRopeLength = 64;
+
+struct Flattener {
+  void visit(const Value &v) {
+    switch (v.type()) {
+    case Value::Type::String: v.getString(); break;
+    case Value::Type::Array:
+      if (seen.insert(v.getArray().get()).second) {
+        const Array &array = *v.getArray();
+        for (std::size_t i = 0; !array.isNumeric() && i < array.size(); ++i) {
+          visit(array.get(i));
+        }
+      }
+      break;
+    case Value::Type::Map:
+      if (seen.insert(v.getMap().get()).second) {
+        v.getMap()->forEach([this](const Value &key, const Value &value) {
+          visit(key);
+          visit(value);
+        });
+      }
+      break;
+    default: break;
+    }
+  }
+
+  std::unordered_set<const void *> seen;
+};
+
+struct Copier {
+  Value copy(const Value &v) {
+    switch (v.type()) {
+    case Value::Type::String: return Value(std::string(v.getString()));
+    case Value::Type::Array: return copyArray(*v.getArray());
+    case Value::Type::Map: return copyMap(*v.getMap());
+    default: return v;
+    }
+  }
+
+  Value copyArray(const Array &array) {
+    if (auto found = copies.find(&array); found != copies.end()) {
+      return found->second;
+    }
+    if (array.isNumeric()) {
+      std::span<const double> numbers = array.numbers();
+      Value result = std::make_shared<Array>(
+          std::vector<double>(numbers.begin(), numbers.end()));
+      copies.emplace(&array, result);
+      return result;
+    }
+    auto result = std::make_shared<Array>(std::vector<Value>());
+    copies.emplace(&array, result);
+    for (std::size_t i = 0; i < array.size(); ++i) {
+      result->push(copy(array.get(i)));
+    }
+    return result;
+  }
+
+  Value copyMap(const Map &map) {
+    if (auto found = copies.find(&map); found != copies.end()) {
+      return found->second;
+    }
+    auto result = std::make_shared<Map>();
+    copies.emplace(&map, result);
+    map.forEach([this, &result](const Value &key, const Value &value) {
+      result->set(copy(key), copy(value));
+    });
+    return result;
+  }
+
+  std::unordered_map<const void *, Value> copies;
+};
+
+} // namespace
+
+/**
+ * @brief Either a flat string (no children) or the concatenation of `left`
+ * and `right`.
+ */
+struct LoxString::Node {
+  explicit Node(std::string flat)
+      : length{flat.size()}, flat{std::move(flat)},
+        charge{HeapKind::String, sizeof(Node) + this->flat.capacity()} {}
+  Node(std::shared_ptr<Node> left, std::shared_ptr<Node> right)
+      : length{left->length + right->length}, left{std::move(left)},
+        right{std::move(right)}, charge{HeapKind::String, sizeof(Node)} {}
+  Node(const Node &) = delete;
+  Node &operator=(const Node &) = delete;
+
+  // Releases long chains of nodes without recursion
+  ~Node() {
+    std::vector<std::shared_ptr<Node>> pending;
+    auto release = [&pending](std::shared_ptr<Node> &child) {
+      if (child != nullptr && child.use_count() == 1) {
+        pending.push_back(std::move(child));
+      }
+    };
+    release(left);
+    release(right);
+    while (!pending.empty()) {
+      std::shared_ptr<Node> node = std::move(pending.back());
+      pending.pop_back();
+      release(node->left);
+      release(node->right);
+    }
+  }
+
+  bool isFlat() const { return left == nullptr; }
+
+  void flatten() {
+    // The children are dropped afterwards; until then both are alive
+    Heap::reserve(length);
+    std::string result;
+    result.reserve(length);
+    std::vector<const Node *> pending = {this};
+    while (!pending.empty()) {
+      const Node *node = pending.back();
+      pending.pop_back();
+      if (node->isFlat()) {
+        result += node->flat;
+      } else {
+        pending.push_back(node->right.get());
+        pending.push_back(node->left.get());
+      }
+    }
+    charge.resize(sizeof(Node) + result.capacity());
+    flat = std::move(result);
+    left = nullptr;
+    right = nullptr;
+  }
+
+  std::size_t length;
+  std::string flat;
+  std::size_t hashCode = 0;
+  bool hashed = false;
+  std::shared_ptr<Node> left;
+  std::shared_ptr<Node> right;
+  HeapCharge charge;
+};
+
+LoxString::LoxString(std::string s)
+    : node{std::make_shared<Node>(std::move(s))} {}
+
+LoxString LoxString::concat(const LoxString &a, const LoxString &b) {
+  if (a.size() + b.size() <= minRopeLength) {
+    Heap::reserve(sizeof(Node) + a.size() + b.size());
+    return LoxString(a.str() + b.str());
+  }
+  Heap::reserve(sizeof(Node));
+  return LoxString(std::make_shared<Node>(a.node, b.node));
+}
+
+const std::string &LoxString::str() const {
+  if (!node->isFlat()) {
+    node->flatten();
+  }
+  return node->flat;
+}
+
+std::size_t LoxString::size() const { return node->length; }
+
+std::size_t LoxString::hash() const {
+  if (!node->hashed) {
+    node->hashCode = std::hash<std::string>{}(str());
+    node->hashed = true;
+  }
+  return node->hashCode;
+}
+
+void loxlang::format(std::string &out, const Value &v) {
   switch (v.type()) {
-  case Value::Type::Nil: out << "nil"; break;
-  case Value::Type::Pointer: out << v.getObject(); break;
-  case Value::Type::Number: out << v.getNumber(); break;
-  case Value::Type::String: out << '\"' << v.getString() << '\"'; break;
-  case Value::Type::Boolean: out << (v.getBool() ? "true" : "false"); break;
+  case Value::Type::Nil: out += "nil"; break;
+  case Value::Type::Pointer:
+    out += std::format("{}", static_cast<const void *>(v.getObject()));
+    break;
+  case Value::Type::Number: {
+    // like the default of a stream: `%g`
+    std::array<char, 32> text;
+    auto end = std::to_chars(text.begin(), text.end(), v.getNumber(),
+                             std::chars_format::general, 6)
+                   .ptr;
+    out.append(text.begin(), end);
+  } break;
+  case Value::Type::String:
+    out += '\"';
+    out += v.getString();
+    out += '\"';
+    break;
+  case Value::Type::Boolean: out += v.getBool() ? "true" : "false"; break;
+  case Value::Type::Array: format(out, *v.getArray()); break;
+  case Value::Type::Map: format(out, *v.getMap()); break;
   default: lox_fail("Bad Value Type");
   }
-  return out;
-}
\ No newline at end of file
+}
+
+std::ostream &loxlang::operator<<(std::ostream &out, const Value &v) {
+  std::string text;
+  format(text, v);
+  return out << text;
+}
+
+void loxlang::flattenAll(const Value &v) { Flattener().visit(v); }
+
+Value loxlang::deepCopy(const Value &v) { return Copier().copy(v); }
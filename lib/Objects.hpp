@@ -2,6 +2,7 @@
 #define LOXLANG_LIB_OBJECTS_HPP
 
 #include "lib/Error.hpp"
+#include <cstddef>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -11,29 +12,96 @@ namespace loxlang {
 
 class Object {};
 
+class Array;
+class Map;
+
+/**
+ * @brief An immutable Lox string.
+ * @details Concatenation does not copy its operands but creates a rope node
+ * pointing to both, so building a string piece by piece takes linear instead
+ * of quadratic time. The rope is flattened into a single buffer on first
+ * access to its characters (`str`, comparison, printing) and keeps that
+ * buffer, dropping its children. Short results are copied right away, as a
+ * node would not be cheaper.
+ *
+ * Copies share their representation. Flattening mutates it, so the same
+ * string must not be read by two threads unless it is already flat.
+ */
+class LoxString {
+public:
+  LoxString() : LoxString(std::string()) {}
+  LoxString(std::string s);
+
+  /**
+   * @brief `a` followed by `b`, in constant time for long strings.
+   */
+  static LoxString concat(const LoxString &a, const LoxString &b);
+
+  /**
+   * @brief The characters of the string; flattens it if necessary.
+   */
+  const std::string &str() const;
+
+  std::size_t size() const;
+
+  /**
+   * @brief Hash of the characters; computed once and then cached.
+   */
+  std::size_t hash() const;
+
+  friend bool operator==(const LoxString &a, const LoxString &b) {
+    return a.node == b.node || (a.size() == b.size() && a.str() == b.str());
+  }
+
+private:
+  struct Node;
+  explicit LoxString(std::shared_ptr<Node> node) : node{std::move(node)} {}
+
+  std::shared_ptr<Node> node;
+};
+
 class Value {
 public:
-  enum class Type : std::uint8_t { Nil, Pointer, Number, String, Boolean };
+  enum class Type : std::uint8_t {
+    Nil,
+    Pointer,
+    Number,
+    String,
+    Boolean,
+    Array,
+    Map
+  };
 
   Value() : v(std::monostate()) {}
   Value(Object *ptr) : v{ptr} {}
   Value(double d) : v{d} {}
-  Value(std::string &s) : v{s} {}
-  Value(std::string &&s) : v{s} {}
+  Value(std::string &s) : v{LoxString(s)} {}
+  Value(std::string &&s) : v{LoxString(std::move(s))} {}
+  Value(LoxString s) : v{std::move(s)} {}
   Value(bool b) : v{b} {}
+  Value(std::shared_ptr<Array> array) : v{std::move(array)} {}
+  Value(std::shared_ptr<Map> map) : v{std::move(map)} {}
   Value(std::nullptr_t) : v(std::monostate()) {}
 
   void operator=(Object *ptr) { v = ptr; }
   void operator=(double n) { v = n; }
-  void operator=(std::string &str) { v = str; }
-  void operator=(std::string &&str) { v = str; }
+  void operator=(std::string &str) { v = LoxString(str); }
+  void operator=(std::string &&str) { v = LoxString(std::move(str)); }
+  void operator=(LoxString str) { v = std::move(str); }
   void operator=(bool b) { v = b; }
   void operator=(std::nullptr_t) { v = std::monostate(); }
 
   Object *getObject() const { return std::get<Object *>(v); }
   double getNumber() const { return std::get<double>(v); }
-  const std::string &getString() const { return std::get<std::string>(v); }
+  const std::string &getString() const { return getLoxString().str(); }
+  const LoxString &getLoxString() const { return std::get<LoxString>(v); }
   bool getBool() const { return std::get<bool>(v); }
+  const std::shared_ptr<Array> &getArray() const {
+    return std::get<std::shared_ptr<Array>>(v);
+  }
+  const std::shared_ptr<Map> &getMap() const {
+    return std::get<std::shared_ptr<Map>>(v);
+  }
 
   Type type() const {
     if (std::holds_alternative<std::monostate>(v)) {
@@ -45,23 +113,57 @@ public:
     if (std::holds_alternative<double>(v)) {
       return Type::Number;
     }
-    if (std::holds_alternative<std::string>(v)) {
+    if (std::holds_alternative<LoxString>(v)) {
       return Type::String;
     }
     if (std::holds_alternative<bool>(v)) {
       return Type::Boolean;
     }
+    if (std::holds_alternative<std::shared_ptr<Array>>(v)) {
+      return Type::Array;
+    }
+    if (std::holds_alternative<std::shared_ptr<Map>>(v)) {
+      return Type::Map;
+    }
     lox_fail("Bad variant type");
   }
 
+  /**
+   * @brief Lox equality: values of different types are never equal, arrays
+   * and maps are equal only to themselves.
+   */
+  friend bool operator==(const Value &a, const Value &b) { return a.v == b.v; }
+
 private:
   using BackingVariant =
-      std::variant<std::monostate, Object *, double, std::string, bool>;
+      std::variant<std::monostate, Object *, double, LoxString, bool,
+                   std::shared_ptr<Array>, std::shared_ptr<Map>>;
   BackingVariant v;
 };
 
+/**
+ * @brief Append the text of a value to a string.
+ * @details The same text as `operator<<`, without going through a stream.
+ */
+void format(std::string &out, const Value &v);
+
 std::ostream &operator<<(std::ostream &out, const Value &v);
 
+/**
+ * @brief Flatten every string reachable from a value.
+ * @details Afterwards the value may be read (e.g. by `deepCopy`) from several
+ * threads at once, as long as nobody changes it.
+ */
+void flattenAll(const Value &v);
+
+/**
+ * @brief A copy of a value that shares no string, array or map with the
+ * original.
+ * @details An array or map reached twice is copied once, so shared and cyclic
+ * structures keep their shape. The copies are charged to the current heap.
+ */
+Value deepCopy(const Value &v);
+
 } // namespace loxlang
 
 #endif
\ No newline at end of file
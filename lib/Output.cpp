@@ -0,0 +1,107 @@
+#include "lib/Output.hpp"
+#include "lib/Objects.hpp"
+#include <cerrno>
+#include <poll.h>
+
+using namespace loxlang;
+
+Output &Output::standard() {
+  static Output output;
+  return output;
+}
+
+void Output::setPolicy(FlushPolicy policy) {
+  std::scoped_lock guard(lock);
+  flushPolicy = policy;
+}
+
+void Output::write(std::string_view text) {
+  std::scoped_lock guard(lock);
+  std::size_t before = buffer.size();
+  buffer += text;
+  written(before);
+}
+
+void Output::printValue(const Value &value) {
+  std::scoped_lock guard(lock);
+  std::size_t before = buffer.size();
+  if (value.type() == Value::Type::String) {
+    buffer += value.getString();
+  } else {
+    format(buffer, value);
+  }
+  written(before);
+}
+
+void Output::setBlocking(bool blocking) {
+  std::scoped_lock guard(lock);
+  this->blocking = blocking;
+}
+
+bool Output::ready() {
+  std::scoped_lock guard(lock);
+  if (backlog > 0) {
+    drain(backlog);
+  }
+  return backlog == 0;
+}
+
+void Output::flush() {
+  std::scoped_lock guard(lock);
+  drain(buffer.size());
+}
+
+void Output::flushAfterRun() {
+  std::scoped_lock guard(lock);
+  if (flushPolicy != FlushPolicy::Exit) {
+    drain(buffer.size());
+  }
+}
+
+void Output::written(std::size_t before) {
+  if (flushPolicy == FlushPolicy::Line) {
+    std::size_t newline = buffer.rfind('\n');
+    if (newline != std::string::npos && newline >= before) {
+      drain(newline + 1);
+      return;
+    }
+  }
+  // also a line without end must not grow the buffer without bound
+  if (buffer.size() >= capacity) {
+    std::size_t newline = buffer.rfind('\n');
+    drain(newline != std::string::npos ? newline + 1 : buffer.size());
+  }
+}
+
+void Output::drain(std::size_t count) {
+  std::size_t done = 0;
+  while (done < count) {
+    ssize_t n = ::write(fd, buffer.data() + done, count - done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!blocking) {
+        // keep the rest for `ready` or a later drain
+        buffer.erase(0, done);
+        backlog = count - done;
+        return;
+      }
+      // a non-blocking descriptor that is full: wait until it takes more
+      pollfd ready{.fd = fd, .events = POLLOUT, .revents = 0};
+      while (::poll(&ready, 1, -1) < 0 && errno == EINTR) {
+      }
+      continue;
+    }
+    if (n <= 0) {
+      // the descriptor is broken (closed pipe, bad fd); retrying cannot
+      // help, so the rest of the output is lost
+      buffer.erase(0, count);
+      backlog = 0;
+      return;
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  buffer.erase(0, done);
+  backlog = 0;
+}
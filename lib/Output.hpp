@@ -0,0 +1,153 @@
+#ifndef LOXLANG_LIB_OUTPUT_HPP
+#define LOXLANG_LIB_OUTPUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+namespace loxlang {
+
+class Value;
+
+/**
+ * @brief When buffered output is written.
+ */
+enum class FlushPolicy : std::uint8_t {
+  /**
+   * @brief After every complete line, and when the buffer is full
+   */
+  Line,
+  /**
+   * @brief When the buffer is full, and after every run of a script
+   */
+  Full,
+  /**
+   * @brief Only when the buffer is full, or when flushed explicitly
+   */
+  Exit,
+};
+
+/**
+ * @brief Buffered text output to a file descriptor.
+ * @details Text is collected in a large buffer and written with few system
+ * calls. When the buffer is full, only complete lines are written, so that
+ * the lines of several outputs to the same file do not get torn apart. The
+ * output is flushed when it is destroyed. A non-blocking descriptor that is
+ * full is waited for (see `setBlocking`), so no output is lost.
+ *
+ * Every `Session` has an output of its own, which the scripts' output and
+ * error reports go to. Output is thread safe.
+ */
+class Output {
+public:
+  static constexpr std::size_t defaultCapacity = std::size_t{256} * 1024;
+
+  /**
+   * @param fd The file descriptor to write to. It is not closed.
+   * @param policy When to flush
+   * @param capacity The buffer size
+   */
+  explicit Output(int fd = STDOUT_FILENO,
+                  FlushPolicy policy = defaultPolicy(STDOUT_FILENO),
+                  std::size_t capacity = defaultCapacity)
+      : fd{fd}, flushPolicy{policy}, capacity{capacity} {
+    buffer.reserve(capacity);
+  }
+  Output(const Output &) = delete;
+  Output &operator=(const Output &) = delete;
+  ~Output() { flush(); }
+
+  /**
+   * @brief The output for the standard output of the process, for messages
+   * that do not belong to a session.
+   */
+  static Output &standard();
+
+  /**
+   * @brief Line buffering for terminals, full buffering otherwise.
+   */
+  static FlushPolicy defaultPolicy(int fd) {
+    return isatty(fd) != 0 ? FlushPolicy::Line : FlushPolicy::Full;
+  }
+
+  FlushPolicy policy() const { return flushPolicy; }
+  void setPolicy(FlushPolicy policy);
+
+  void write(std::string_view text);
+
+  template <typename... Args>
+  void print(std::format_string<Args...> fmt, Args &&...args) {
+    std::scoped_lock guard(lock);
+    std::size_t before = buffer.size();
+    std::format_to(std::back_inserter(buffer), fmt,
+                   std::forward<Args>(args)...);
+    written(before);
+  }
+
+  template <typename... Args>
+  void println(std::format_string<Args...> fmt, Args &&...args) {
+    std::scoped_lock guard(lock);
+    std::size_t before = buffer.size();
+    std::format_to(std::back_inserter(buffer), fmt,
+                   std::forward<Args>(args)...);
+    buffer += '\n';
+    written(before);
+  }
+
+  /**
+   * @brief Write a value the way Lox prints it: strings without quotes.
+   */
+  void printValue(const Value &value);
+
+  /**
+   * @brief Whether a full non-blocking descriptor is waited for.
+   * @details On by default. A `Session` turns it off while its fibers run:
+   * output that does not fit stays buffered, and `println` suspends the
+   * printing fiber through the scheduler instead of blocking the thread
+   * (see `ready`).
+   */
+  void setBlocking(bool blocking);
+
+  /**
+   * @brief Whether more output may be added without growing a backlog.
+   * @details If the descriptor was full, writes as much of the backlog as it
+   * takes now, without waiting.
+   * @return `false` if a backlog remains
+   */
+  bool ready();
+
+  int descriptor() const { return fd; }
+
+  /**
+   * @brief Write everything buffered.
+   */
+  void flush();
+
+  /**
+   * @brief Called after a script has run: flushes unless the policy is
+   * `Exit`.
+   */
+  void flushAfterRun();
+
+private:
+  void written(std::size_t before);
+  void drain(std::size_t count);
+
+  int fd;
+  FlushPolicy flushPolicy;
+  std::size_t capacity;
+  bool blocking = true;
+  // bytes a drain could not write as the descriptor was full
+  std::size_t backlog = 0;
+  std::string buffer;
+  std::mutex lock;
+};
+
+} // namespace loxlang
+
+#endif
@@ -2,9 +2,11 @@
 #include "Parser.hpp"
 #include "lib/Ast.hpp"
 #include "lib/Error.hpp"
+#include "lib/PipelinedScanner.hpp"
+#include "lib/Trace.hpp"
+#include <array>
 #include <memory>
 #include <optional>
-#include <print>
 #include <span>
 #include <stdexcept>
 #include <string_view>
@@ -24,8 +26,10 @@ struct ParserPanic : public std::logic_error {
 
 class Parser {
 public:
-  Parser(Program &program, scan::Scanner &scanner)
-      : program{program}, scanner{scanner} {}
+  Parser(Program &program, scan::Scanner &scanner, std::size_t maxNesting,
+         scan::PipelinedScanner *pipeline = nullptr)
+      : program{program}, scanner{scanner}, pipeline{pipeline},
+        maxNesting{maxNesting} {}
 
   std::unique_ptr<Ast> parse();
 
@@ -40,27 +44,37 @@ public:
   void expectPanic(scan::Token::Type type, std::string_view errorMsg);
   void error(scan::Token source, std::string_view errorMsg);
   void errorPanic(scan::Token source, std::string_view errorMsg);
+  std::size_t nestingDepth() const { return nesting; }
+  void deepen();
+  void restoreNesting(std::size_t depth) { nesting = depth; }
 
 private:
+  scan::Token nextToken() {
+    return pipeline != nullptr ? pipeline->next() : scanner.next();
+  }
+
   Program &program;
   scan::Scanner &scanner;
+  scan::PipelinedScanner *pipeline;
+  std::size_t maxNesting;
+  std::size_t nesting = 0;
   std::optional<scan::Token> prev = std::nullopt;
   std::optional<scan::Token> current = std::nullopt;
   std::optional<scan::Token> next = std::nullopt;
 };
 
-bool Parser::isAtEnd() { return peek().type != Token::Type::Eof; }
+bool Parser::isAtEnd() { return peek().type == Token::Type::Eof; }
 
 Token Parser::peek() {
   if (!current.has_value()) {
-    current = scanner.next();
+    current = nextToken();
   }
   return current.value();
 }
 
 [[maybe_unused]] Token Parser::peekNext() {
   if (!next.has_value()) {
-    next = scanner.next();
+    next = nextToken();
   }
   return next.value();
 }
@@ -87,7 +101,7 @@ Token Parser::advance() {
   return t;
 }
 
-[[maybe_unused]] bool Parser::advanceIf(std::span<Token::Type> types) {
+bool Parser::advanceIf(std::span<Token::Type> types) {
   for (Token::Type type : types) {
     if (checkNext(type)) {
       advance();
@@ -123,6 +137,36 @@ void Parser::errorPanic(Token source, std::string_view errorMsg) {
   throw ParserPanic();
 }
 
+void Parser::deepen() {
+  nesting++;
+  if (nesting > maxNesting) {
+    errorPanic(peek(), "Expression is nested too deeply");
+  }
+}
+
+/**
+ * Tracks how deeply the passes over the tree that is currently being built
+ * recurse: every recursive call into the expression parser (groupings, unary
+ * operands, right operands) and every call or index that wraps the expression
+ * parsed so far adds one level. Chains of binary operators are not counted,
+ * the passes walk their left operands in a loop (see `ast::leftChain`).
+ */
+class NestingGuard {
+public:
+  explicit NestingGuard(Parser &p) : parser{p}, saved{p.nestingDepth()} {
+    parser.deepen();
+  }
+  NestingGuard(const NestingGuard &) = delete;
+  NestingGuard &operator=(const NestingGuard &) = delete;
+  ~NestingGuard() { parser.restoreNesting(saved); }
+
+  void deepen() { parser.deepen(); }
+
+private:
+  Parser &parser;
+  std::size_t saved;
+};
+
 enum class BindingPower : std::uint8_t {
   None,
   AssignRight,
@@ -156,19 +200,20 @@ struct ParseRule {
 
 std::vector<ParseRule> constructEmptyTable() {
   std::vector<Token::Type> tokens = {
-      Token::Type::LPar,    Token::Type::RPar,  Token::Type::LBrace,
-      Token::Type::RBrace,  Token::Type::Comma, Token::Type::Dot,
-      Token::Type::Minus,   Token::Type::Plus,  Token::Type::SemiColon,
-      Token::Type::Slash,   Token::Type::Star,  Token::Type::Bang,
-      Token::Type::BangEq,  Token::Type::Eq,    Token::Type::EqEq,
-      Token::Type::Greater, Token::Type::Less,  Token::Type::GreaterEq,
-      Token::Type::LessEq,  Token::Type::Ident, Token::Type::String,
-      Token::Type::Number,  Token::Type::And,   Token::Type::Class,
-      Token::Type::Else,    Token::Type::False, Token::Type::Fun,
-      Token::Type::For,     Token::Type::If,    Token::Type::Nil,
-      Token::Type::Or,      Token::Type::Print, Token::Type::Return,
-      Token::Type::Super,   Token::Type::This,  Token::Type::True,
-      Token::Type::Var,     Token::Type::While, Token::Type::Eof,
+      Token::Type::LPar,    Token::Type::RPar,     Token::Type::LBrace,
+      Token::Type::RBrace,  Token::Type::LBracket, Token::Type::RBracket,
+      Token::Type::Colon,   Token::Type::Comma,    Token::Type::Dot,
+      Token::Type::Minus,   Token::Type::Plus,     Token::Type::SemiColon,
+      Token::Type::Slash,   Token::Type::Star,     Token::Type::Bang,
+      Token::Type::BangEq,  Token::Type::Eq,       Token::Type::EqEq,
+      Token::Type::Greater, Token::Type::Less,     Token::Type::GreaterEq,
+      Token::Type::LessEq,  Token::Type::Ident,    Token::Type::String,
+      Token::Type::Number,  Token::Type::And,      Token::Type::Class,
+      Token::Type::Else,    Token::Type::False,    Token::Type::Fun,
+      Token::Type::For,     Token::Type::If,       Token::Type::Nil,
+      Token::Type::Or,      Token::Type::Print,    Token::Type::Return,
+      Token::Type::Super,   Token::Type::This,     Token::Type::True,
+      Token::Type::Var,     Token::Type::While,    Token::Type::Eof,
       Token::Type::Err};
   std::vector<ParseRule> table;
   table.resize(tokens.size());
@@ -204,6 +249,7 @@ ParseRule findRule(Token::Type type) {
 }
 
 std::unique_ptr<Ast> expressionUntil(Parser &p, BindingPower minPower) {
+  NestingGuard nesting = NestingGuard(p);
   PrefixParseFn *prefixRule = findRule(p.peek().type).prefix;
   if (prefixRule == nullptr) {
     p.errorPanic(p.peek(), "Expected expression start");
@@ -222,6 +268,9 @@ std::unique_ptr<Ast> expressionUntil(Parser &p, BindingPower minPower) {
       break;
     }
 
+    if (rule.left >= BindingPower::Call) {
+      nesting.deepen();
+    }
     expr = rule.infix(p, std::move(expr));
   }
 
@@ -235,19 +284,19 @@ std::unique_ptr<Ast> expression(Parser &p) {
 std::unique_ptr<Ast> nilLiteral(Parser &p) {
   Token literal = p.advance();
   lox_assert_eq(literal.type, Token::Type::Nil, "Should be Nil keyword");
-  return std::make_unique<Literal>(Value(nullptr));
+  return std::make_unique<Literal>(literal, Value(nullptr));
 }
 
 std::unique_ptr<Ast> trueLiteral(Parser &p) {
   Token literal = p.advance();
   lox_assert_eq(literal.type, Token::Type::True, "Should be True keyword");
-  return std::make_unique<Literal>(Value(true));
+  return std::make_unique<Literal>(literal, Value(true));
 }
 
 std::unique_ptr<Ast> falseLiteral(Parser &p) {
   Token literal = p.advance();
   lox_assert_eq(literal.type, Token::Type::False, "Should be False keyword");
-  return std::make_unique<Literal>(Value(false));
+  return std::make_unique<Literal>(literal, Value(false));
 }
 
 std::unique_ptr<Ast> numberLiteral(Parser &p) {
@@ -263,14 +312,15 @@ std::unique_ptr<Ast> numberLiteral(Parser &p) {
     p.error(literal, "Number literal is out of range for Lox number (IEEE 754 "
                      "double precision floating point)");
   }
-  return std::make_unique<Literal>(loxValue);
+  return std::make_unique<Literal>(literal, loxValue);
 }
 
 std::unique_ptr<Ast> stringLiteral(Parser &p) {
   Token literal = p.advance();
   lox_assert_eq(literal.type, Token::Type::String, "Should be String Literal");
-  Value loxValue = std::string(literal.text);
-  return std::make_unique<Literal>(loxValue);
+  // drop the surrounding quotes
+  Value loxValue = std::string(literal.text.substr(1, literal.text.size() - 2));
+  return std::make_unique<Literal>(literal, loxValue);
 }
 
 std::unique_ptr<Ast> variableUse(Parser &p) {
@@ -301,6 +351,43 @@ std::unique_ptr<Ast> grouping(Parser &p) {
   return std::make_unique<Grouping>(std::move(expr));
 }
 
+std::unique_ptr<Ast> call(Parser &p, std::unique_ptr<Ast> callee) {
+  Token paren = p.expect(Token::Type::LPar, "expecting opening '('");
+  std::vector<std::unique_ptr<Ast>> arguments;
+  std::array<Token::Type, 1> comma = {Token::Type::Comma};
+  if (!p.checkNext(Token::Type::RPar)) {
+    do {
+      arguments.push_back(expression(p));
+    } while (p.advanceIf(comma));
+  }
+  p.expect(Token::Type::RPar, "expected ')' after arguments");
+  return std::make_unique<Call>(std::move(callee), paren, std::move(arguments));
+}
+
+std::unique_ptr<Ast> index(Parser &p, std::unique_ptr<Ast> object) {
+  Token bracket = p.expect(Token::Type::LBracket, "expecting opening '['");
+  std::unique_ptr<Ast> idx = expression(p);
+  p.expect(Token::Type::RBracket, "expected ']' after index");
+  return std::make_unique<Index>(std::move(object), bracket, std::move(idx));
+}
+
+std::unique_ptr<Ast> mapLiteral(Parser &p) {
+  Token brace = p.expect(Token::Type::LBrace, "expecting opening '{'");
+  std::vector<std::unique_ptr<Ast>> keys;
+  std::vector<std::unique_ptr<Ast>> values;
+  std::array<Token::Type, 1> comma = {Token::Type::Comma};
+  if (!p.checkNext(Token::Type::RBrace)) {
+    do {
+      keys.push_back(expression(p));
+      p.expect(Token::Type::Colon, "expected ':' after map key");
+      values.push_back(expression(p));
+    } while (p.advanceIf(comma));
+  }
+  p.expect(Token::Type::RBrace, "expected '}' after map entries");
+  return std::make_unique<MapLiteral>(brace, std::move(keys),
+                                      std::move(values));
+}
+
 std::vector<ParseRule> computeParseTable() {
   std::vector<ParseRule> t = constructEmptyTable();
 
@@ -313,6 +400,7 @@ std::vector<ParseRule> computeParseTable() {
   wordStart(t, Token::Type::Minus, unary);
   wordStart(t, Token::Type::Bang, unary);
   wordStart(t, Token::Type::LPar, grouping);
+  wordStart(t, Token::Type::LBrace, mapLiteral);
 
   wordContinue(t, Token::Type::Plus, binary, BindingPower::AddLeft,
                BindingPower::AddRight);
@@ -339,6 +427,11 @@ std::vector<ParseRule> computeParseTable() {
   wordContinue(t, Token::Type::Eq, binary, BindingPower::AssignLeft,
                BindingPower::AssignRight);
 
+  wordContinue(t, Token::Type::LPar, call, BindingPower::Call,
+               BindingPower::Call);
+  wordContinue(t, Token::Type::LBracket, index, BindingPower::Call,
+               BindingPower::Call);
+
   return t;
 }
 
@@ -346,13 +439,23 @@ std::unique_ptr<Ast> Parser::parse() {
   try {
     return expression(*this);
   } catch (ParserPanic &) {
-    std::println("Parser panicked, cannot produce Abstract Syntax Tree.");
+    program.output().println(
+        "Parser panicked, cannot produce Abstract Syntax Tree.");
     return nullptr;
   }
 }
 
 } // namespace
 
-std::unique_ptr<Ast> parse::parse(Program &p, Scanner &s) {
-  return Parser(p, s).parse();
-}
\ No newline at end of file
+std::unique_ptr<Ast> parse::parse(Program &p, Scanner &s,
+                                  std::size_t maxNesting) {
+  lox_trace_scope("parse");
+  return Parser(p, s, maxNesting).parse();
+}
+
+std::unique_ptr<Ast> parse::parsePipelined(Program &p, Scanner &s,
+                                           std::size_t maxNesting) {
+  lox_trace_scope("parse");
+  PipelinedScanner pipeline(s);
+  return Parser(p, s, maxNesting, &pipeline).parse();
+}
@@ -3,6 +3,7 @@
 
 #include "lib/Program.hpp"
 #include "lib/Scanner.hpp"
+#include <cstddef>
 #include <memory>
 
 namespace loxlang::ast {
@@ -11,14 +12,39 @@ struct Ast;
 
 namespace loxlang::parse {
 
+/**
+ * @brief The default for the maximum nesting depth of an expression.
+ * @details This keeps the native stack use of the parser (and of any recursive
+ * pass over the resulting tree) well within the default thread stack size.
+ */
+constexpr std::size_t defaultMaxNesting = 1000;
+
 /**
  * @brief Lox parser
  * @details
  * @param p The program to parse
  * @param s A Scanner for the program
+ * @param maxNesting The maximum nesting depth of the produced syntax tree, not
+ * counting the left operands of chains of binary operators. Deeper nested
+ * programs are reported as an error instead of overflowing the stack.
+ * @return A Abstract Syntax Tree, or nullptr if an error occurred.
+ */
+std::unique_ptr<loxlang::ast::Ast>
+parse(Program &p, scan::Scanner &s, std::size_t maxNesting = defaultMaxNesting);
+
+/**
+ * @brief Lox parser, scanning on a separate thread.
+ * @details Same as `parse`, but `s` runs on a thread of its own (see
+ * `scan::PipelinedScanner`), so scanning overlaps with parsing. This only pays
+ * off for large programs; the thread is started and joined for every call.
+ * @param p The program to parse
+ * @param s A Scanner for the whole program (not a streaming one)
+ * @param maxNesting The maximum nesting depth, see `parse`
  * @return A Abstract Syntax Tree, or nullptr if an error occurred.
  */
-std::unique_ptr<loxlang::ast::Ast> parse(Program &p, scan::Scanner &s);
+std::unique_ptr<loxlang::ast::Ast>
+parsePipelined(Program &p, scan::Scanner &s,
+               std::size_t maxNesting = defaultMaxNesting);
 
 } // namespace loxlang::parse
 
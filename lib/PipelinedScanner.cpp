@@ -0,0 +1,50 @@
+#include "lib/PipelinedScanner.hpp"
+#include "lib/Error.hpp"
+
+using namespace loxlang::scan;
+
+PipelinedScanner::PipelinedScanner(Scanner &scanner) {
+  thread = std::thread([this, &scanner] { produce(scanner); });
+}
+
+PipelinedScanner::~PipelinedScanner() {
+  stopping = true;
+  // Make room, in case the producer sleeps on a full queue
+  Batch discarded;
+  while (queue.tryPop(discarded)) {
+  }
+  thread.join();
+}
+
+void PipelinedScanner::produce(Scanner &scanner) {
+  bool atEnd = false;
+  Batch next;
+  while (!atEnd && !stopping) {
+    next.count = 0;
+    while (next.count < batchSize && !atEnd) {
+      Token t = scanner.next();
+      next.tokens[next.count++] = t;
+      atEnd = t.type == Token::Type::Eof;
+    }
+    while (!queue.tryPush(next)) {
+      if (stopping) {
+        return;
+      }
+      queue.waitForSpace();
+    }
+  }
+}
+
+void PipelinedScanner::nextBatch() {
+  lox_assert_eq(index, batch.count, "current batch is not used up");
+  if (batch.count > 0 &&
+      batch.tokens[batch.count - 1].type == Token::Type::Eof) {
+    // Nothing comes after the end, keep handing out the Eof token
+    index = batch.count - 1;
+    return;
+  }
+  while (!queue.tryPop(batch)) {
+    queue.waitForData();
+  }
+  index = 0;
+}
@@ -0,0 +1,71 @@
+#ifndef LOXLANG_LIB_PIPELINEDSCANNER_HPP
+#define LOXLANG_LIB_PIPELINEDSCANNER_HPP
+
+#include "lib/Scanner.hpp"
+#include "lib/SpscQueue.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+namespace loxlang::scan {
+
+/**
+ * @brief Runs a `Scanner` on a thread of its own.
+ * @details The scanner thread hands tokens over in batches through a bounded
+ * single-producer/single-consumer queue, so scanning overlaps with whatever
+ * consumes the tokens (usually the parser). When the consumer falls behind,
+ * the scanner thread sleeps until there is room again.
+ *
+ * The scanner must scan a whole `Program` (not a stream), so that the token
+ * texts stay valid.
+ */
+class PipelinedScanner {
+public:
+  static constexpr std::size_t batchSize = 256;
+  static constexpr std::size_t queueCapacity = 16;
+
+  /**
+   * @brief Start scanning on a new thread.
+   * @param scanner The scanner; it must not be used by anyone else until this
+   * object is destroyed.
+   */
+  explicit PipelinedScanner(Scanner &scanner);
+  PipelinedScanner(const PipelinedScanner &) = delete;
+  PipelinedScanner &operator=(const PipelinedScanner &) = delete;
+
+  /**
+   * @brief Stops the scanner thread, even if not all tokens were consumed.
+   */
+  ~PipelinedScanner();
+
+  /**
+   * @brief The next token. After the end of the input, this keeps returning
+   * the `Eof` token.
+   */
+  Token next() {
+    if (index == batch.count) {
+      nextBatch();
+    }
+    return batch.tokens[index++];
+  }
+
+private:
+  struct Batch {
+    std::array<Token, batchSize> tokens;
+    std::size_t count = 0;
+  };
+
+  void produce(Scanner &scanner);
+  void nextBatch();
+
+  util::SpscQueue<Batch> queue = util::SpscQueue<Batch>(queueCapacity);
+  std::atomic<bool> stopping = false;
+  Batch batch;
+  std::size_t index = 0;
+  std::thread thread;
+};
+
+} // namespace loxlang::scan
+
+#endif
@@ -3,7 +3,8 @@
 #include "lib/Error.hpp"
 #include <algorithm>
 #include <format>
-#include <print>
+#include <mutex>
+#include <string>
 #include <span>
 
 namespace {
@@ -52,10 +53,8 @@ std::string_view extractLine(std::string_view text,
   return std::string_view(start, end);
 }
 
-void repeatPrint(char c, std::size_t n) {
-  for (size_t i = 0; i < n; ++i) {
-    std::print("{}", c);
-  }
+void repeatPrint(loxlang::Output &out, char c, std::size_t n) {
+  out.write(std::string(n, c));
 }
 
 } // namespace
@@ -64,15 +63,45 @@ void loxlang::Program::error(std::string_view msg, std::size_t charOffset) {
   error(msg, part(charOffset, 1));
 }
 
+std::optional<std::size_t>
+loxlang::Program::lineOf(std::string_view tokenText) {
+  if (tokenText.data() < text.data() ||
+      tokenText.data() >= text.data() + text.size()) {
+    return std::nullopt;
+  }
+  std::scoped_lock lock(reportLock);
+  if (lines.empty()) {
+    lines = findLines(text);
+  }
+  return findLine(lines, tokenText.begin()).lineNumber;
+}
+
+void loxlang::Program::errorInLine(std::string_view msg, std::size_t line,
+                                   std::string_view tokenText) {
+  std::scoped_lock lock(reportLock);
+  hadErr = true;
+  Output &out = *errorOutput;
+  out.println("\033[1m{}:{}:\033[0m {}", filename, line, msg);
+  out.println("   at ‘{}’", tokenText);
+}
+
 void loxlang::Program::error(std::string_view msg, std::string_view tokenText) {
+  std::scoped_lock lock(reportLock);
   hadErr = true;
+  Output &out = *errorOutput;
+  if (tokenText.data() < text.data() ||
+      tokenText.data() + tokenText.size() > text.data() + text.size()) {
+    // not a view into the program text, so there is no line to show
+    out.println("\033[1m{}:\033[0m {}", filename, msg);
+    return;
+  }
   if (lines.empty()) {
     lines = findLines(text);
   }
   Line startLine = findLine(lines, tokenText.begin());
   Line endLine = findLine(lines, tokenText.end());
 
-  std::println("\033[1m{}:{}:\033[0m {}", filename, startLine.lineNumber, msg);
+  out.println("\033[1m{}:{}:\033[0m {}", filename, startLine.lineNumber, msg);
   std::ptrdiff_t startCol = tokenText.begin() - startLine.charOffset;
   std::ptrdiff_t endCol = tokenText.end() - endLine.charOffset;
 
@@ -80,39 +109,39 @@ void loxlang::Program::error(std::string_view msg, std::string_view tokenText) {
 
   if (startLine.lineNumber == endLine.lineNumber) {
     std::string_view startText = extractLine(text, lines, startLine.lineNumber);
-    std::println("l. {} | {}", startLine.lineNumber, startText);
+    out.println("l. {} | {}", startLine.lineNumber, startText);
     if (startCol > maxColumnCount || endCol > maxColumnCount ||
         (endCol - startCol) > maxColumnCount) {
-      std::println("   at columns {}–{}", startCol, endCol);
+      out.println("   at columns {}–{}", startCol, endCol);
     } else {
       std::size_t startAlign =
           std::format("l. {} | ", startLine.lineNumber).size();
-      repeatPrint(' ', startAlign + startCol);
-      repeatPrint('^', endCol - startCol);
-      std::println();
+      repeatPrint(out, ' ', startAlign + startCol);
+      repeatPrint(out, '^', endCol - startCol);
+      out.write("\n");
     }
   } else {
     std::string_view startText = extractLine(text, lines, startLine.lineNumber);
     std::string_view endText = extractLine(text, lines, endLine.lineNumber);
 
-    std::println("l. {} | {}", startLine.lineNumber, startText);
+    out.println("l. {} | {}", startLine.lineNumber, startText);
     if (startCol > maxColumnCount) {
-      std::println("   starting at column {}", startCol);
+      out.println("   starting at column {}", startCol);
     } else {
       std::size_t startAlign =
           std::format("l. {} | ", startLine.lineNumber).size();
-      repeatPrint(' ', startAlign + startCol);
-      std::println("^-- starts here");
+      repeatPrint(out, ' ', startAlign + startCol);
+      out.println("^-- starts here");
     }
 
-    std::println("l. {} | {}", endLine.lineNumber, endText);
+    out.println("l. {} | {}", endLine.lineNumber, endText);
     if (endCol > maxColumnCount) {
-      std::println("   ending at column {}", endCol);
+      out.println("   ending at column {}", endCol);
     } else {
       std::size_t startAlign =
           std::format("l. {} | ", endLine.lineNumber).size();
-      repeatPrint(' ', startAlign + endCol);
-      std::println("^-- ends here");
+      repeatPrint(out, ' ', startAlign + endCol);
+      out.println("^-- ends here");
     }
   }
 }
@@ -1,7 +1,11 @@
 #ifndef LOXLANG_LIB_PROGRAM_HPP
 #define LOXLANG_LIB_PROGRAM_HPP
 
+#include "lib/Output.hpp"
+#include "lib/Symbols.hpp"
 #include <cstdint>
+#include <mutex>
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -9,7 +13,9 @@ namespace loxlang {
 
 /**
  * @brief A class representing the program text
- * @details This class mostly contains routines for error reporting
+ * @details This class mostly contains routines for error reporting. Errors
+ * may be reported from several threads at once (see
+ * `scan::PipelinedScanner`); the reports are serialized.
  */
 struct Program {
   Program(std::string_view filename, std::string_view text)
@@ -31,6 +37,17 @@ struct Program {
    */
   void error(std::string_view msg, std::string_view tokenText);
 
+  /**
+   * @brief Report an error in a given line.
+   * @details For program text that is not kept in memory, such as the input of
+   * a streaming `Scanner`.
+   * @param msg the error message to display to the user
+   * @param line the line number at which the error occurred
+   * @param tokenText the text at which the error occurred
+   */
+  void errorInLine(std::string_view msg, std::size_t line,
+                   std::string_view tokenText);
+
   /**
    * @brief Getter for the program text
    * @return the verbitem program text
@@ -44,17 +61,40 @@ struct Program {
     return text.substr(start, length);
   }
 
+  /**
+   * @brief The line (counted from 0, as in error reports) a part of the
+   * program text starts in.
+   * @return The line, or `std::nullopt` if `tokenText` is not a view into the
+   * program text.
+   */
+  std::optional<std::size_t> lineOf(std::string_view tokenText);
+
   /**
    * @brief Queries wether an error has already been reported on this program.
    * @return `true`, if the program had an error reported.
    */
   bool hadError() const { return hadErr; }
 
+  /**
+   * @brief Where errors are reported, by default `Output::standard()`.
+   */
+  Output &output() { return *errorOutput; }
+  void setOutput(Output &out) { errorOutput = &out; }
+
+  /**
+   * @brief The identifiers of the program, interned by the scanner.
+   */
+  SymbolTable &symbols() { return symbolTable; }
+  const SymbolTable &symbols() const { return symbolTable; }
+
 private:
   std::string_view filename;
   std::string_view text;
   std::vector<const char *> lines;
   bool hadErr = false;
+  std::mutex reportLock;
+  Output *errorOutput = &Output::standard();
+  SymbolTable symbolTable;
 };
 
 } // namespace loxlang
@@ -0,0 +1,148 @@
+#include "lib/Runtime.hpp"
+#include "lib/Array.hpp"
+#include "lib/ArrayNatives.hpp"
+#include "lib/Heap.hpp"
+#include "lib/Map.hpp"
+#include "lib/MapNatives.hpp"
+#include <cmath>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace loxlang;
+using namespace loxlang::aot;
+
+Runtime::Runtime(std::string_view filename, std::string_view source,
+                 Value args)
+    : program{filename, source}, scriptArgs{std::move(args)} {
+  program.setOutput(output());
+  defineNatives(natives, output());
+}
+
+void Runtime::error(std::string_view msg, Location at) {
+  program.error(msg, program.part(at.offset, at.length));
+  throw RuntimeError();
+}
+
+Value Runtime::add(const Value &left, const Value &right, Location at) {
+  if (left.type() == Value::Type::String &&
+      right.type() == Value::Type::String) {
+    return LoxString::concat(left.getLoxString(), right.getLoxString());
+  }
+  if (left.type() == Value::Type::Number &&
+      right.type() == Value::Type::Number) {
+    return left.getNumber() + right.getNumber();
+  }
+  error("Operands must be two numbers or two strings", at);
+}
+
+namespace {
+
+std::size_t arrayIndex(Runtime &rt, const Array &array, const Value &v,
+                       Location at) {
+  double index = rt.number(v, at);
+  if (index != std::floor(index)) {
+    rt.error("Array index must be an integer", at);
+  }
+  if (index < 0 || index >= static_cast<double>(array.size())) {
+    rt.error("Array index out of range", at);
+  }
+  return static_cast<std::size_t>(index);
+}
+
+const Value &mapKey(Runtime &rt, const Value &key, Location at) {
+  if (!Map::isKey(key)) {
+    rt.error("Map keys must be strings or numbers", at);
+  }
+  return key;
+}
+
+} // namespace
+
+Value Runtime::getIndex(const Value &container, const Value &index,
+                        Location at) {
+  if (container.type() == Value::Type::Array) {
+    const Array &a = *container.getArray();
+    return a.get(arrayIndex(*this, a, index, at));
+  }
+  if (container.type() == Value::Type::Map) {
+    const Value *value = container.getMap()->get(mapKey(*this, index, at));
+    return value != nullptr ? *value : Value();
+  }
+  error("Only arrays and maps can be indexed", at);
+}
+
+void Runtime::setIndex(const Value &container, const Value &index,
+                       Value value, Location at) {
+  if (container.type() == Value::Type::Array) {
+    Array &a = *container.getArray();
+    a.set(arrayIndex(*this, a, index, at), std::move(value));
+  } else if (container.type() == Value::Type::Map) {
+    container.getMap()->set(mapKey(*this, index, at), std::move(value));
+  } else {
+    error("Only arrays and maps can be indexed", at);
+  }
+}
+
+Value Runtime::buildMap(std::span<const Value> entries, Location at) {
+  auto map = std::make_shared<Map>();
+  for (std::size_t i = 0; i < entries.size(); i += 2) {
+    map->set(mapKey(*this, entries[i], at), entries[i + 1]);
+  }
+  return map;
+}
+
+Value Runtime::call(std::uint32_t native, std::span<const Value> args,
+                    Location at) {
+  const interpret::Native &callee = natives.at(native);
+  if (!callee.fn) {
+    error("Can only call functions", at);
+  }
+  if (callee.arity != args.size()) {
+    error("Wrong number of arguments", at);
+  }
+  try {
+    const trace::Scope traced(callee.traceName);
+    return callee.fn(args);
+  } catch (interpret::NativeError &e) {
+    error(e.what(), at);
+  } catch (HeapLimitError &e) {
+    error(e.what(), at);
+  } catch (std::bad_alloc &) {
+    error("Out of memory", at);
+  } catch (std::length_error &) {
+    error("Out of memory", at);
+  }
+}
+
+void aot::defineNatives(interpret::NativeRegistry &natives, Output &out) {
+  natives.bind("println", [&out](const Value &value) {
+    out.printValue(value);
+    out.write("\n");
+  });
+  interpret::defineArrayNatives(natives);
+  interpret::defineMapNatives(natives);
+}
+
+int aot::main(int argc, char const *argv[], std::string_view filename,
+              std::string_view source, Script script) {
+  std::vector<Value> args;
+  for (int i = 1; i < argc; ++i) {
+    args.emplace_back(std::string(argv[i]));
+  }
+  Runtime rt(filename, source, std::make_shared<Array>(std::move(args)));
+  int status = 0;
+  try {
+    Value result = script(rt);
+    std::string text;
+    format(text, result);
+    rt.output().println("{}", text);
+  } catch (RuntimeError &) {
+    status = 1;
+  }
+  rt.output().flush();
+  return status;
+}
@@ -0,0 +1,126 @@
+#ifndef LOXLANG_LIB_RUNTIME_HPP
+#define LOXLANG_LIB_RUNTIME_HPP
+
+#include "lib/Natives.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Output.hpp"
+#include "lib/Program.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+/**
+ * @namespace loxlang::aot
+ * The runtime of scripts compiled ahead of time to C++ (see
+ * `transpile::transpile`).
+ */
+namespace loxlang::aot {
+
+/**
+ * @brief A part of the program text, where a runtime error is reported.
+ */
+struct Location {
+  std::uint32_t offset;
+  std::uint32_t length;
+};
+
+/**
+ * @brief Thrown after a runtime error has been reported; ends the script.
+ */
+struct RuntimeError : public std::logic_error {
+  RuntimeError() : std::logic_error("compiled script unwinding") {}
+};
+
+/**
+ * @brief The operations of compiled code that are not plain C++.
+ * @details Every operation checks its operands like the interpreter does, and
+ * reports errors with the same messages at the same locations, so a compiled
+ * script behaves like the interpreted one.
+ *
+ * Global variables are locals of the compiled script; those that are not
+ * defined yet are empty.
+ */
+class Runtime {
+public:
+  /**
+   * @param filename The name of the script, for error reports
+   * @param source The text of the script, for error reports
+   * @param args The value of the global variable `args`
+   */
+  Runtime(std::string_view filename, std::string_view source, Value args);
+  Runtime(const Runtime &) = delete;
+  Runtime &operator=(const Runtime &) = delete;
+
+  [[noreturn]] void error(std::string_view msg, Location at);
+
+  Output &output() { return Output::standard(); }
+  const Value &args() const { return scriptArgs; }
+
+  template <typename T>
+  const T &get(const std::optional<T> &global, Location at) {
+    if (!global.has_value()) {
+      error("Undefined variable", at);
+    }
+    return *global;
+  }
+
+  static bool truthy(const Value &v) {
+    switch (v.type()) {
+    case Value::Type::Nil: return false;
+    case Value::Type::Boolean: return v.getBool();
+    default: return true;
+    }
+  }
+
+  double number(const Value &v, Location at) {
+    if (v.type() != Value::Type::Number) {
+      error("Operand must be a number", at);
+    }
+    return v.getNumber();
+  }
+
+  Value add(const Value &left, const Value &right, Location at);
+  Value getIndex(const Value &container, const Value &index, Location at);
+  void setIndex(const Value &container, const Value &index, Value value,
+                Location at);
+  Value buildMap(std::span<const Value> entries, Location at);
+
+  /**
+   * @brief The slot of a native, for `call`.
+   */
+  std::uint32_t native(std::string_view name) { return natives.slot(name); }
+  Value call(std::uint32_t native, std::span<const Value> args, Location at);
+
+private:
+  Program program;
+  interpret::NativeRegistry natives;
+  Value scriptArgs;
+};
+
+/**
+ * @brief Define the natives available to compiled scripts.
+ * @details These are the natives of a `Session` that do not need the fiber
+ * scheduler: `println` and the natives for arrays and maps.
+ */
+void defineNatives(interpret::NativeRegistry &natives, Output &out);
+
+/**
+ * @brief The code generated for a script.
+ * @return The value of the script
+ */
+using Script = Value (*)(Runtime &rt);
+
+/**
+ * @brief The `main` of a compiled script.
+ * @details Runs the script with the command line arguments in `args` and
+ * prints its value, like `loxlang <script>` does.
+ * @return The exit status: 0 if the script ran without errors
+ */
+int main(int argc, char const *argv[], std::string_view filename,
+         std::string_view source, Script script);
+
+} // namespace loxlang::aot
+
+#endif
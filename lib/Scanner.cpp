@@ -1,15 +1,18 @@
 #include "lib/Scanner.hpp"
 #include "lib/Error.hpp"
 #include "lib/Util.hpp"
+#include <algorithm>
 #include <array>
 #include <cctype>
+#include <cstring>
+#include <istream>
 
 namespace {
 
 using namespace loxlang::scan;
 
 bool isDigit(char c) { return '0' <= c && c <= '9'; }
-bool isBlank(char c) { return std::isblank(static_cast<unsigned char>(c)); }
+bool isBlank(char c) { return std::isspace(static_cast<unsigned char>(c)); }
 bool isIdentStart(char c) {
   return c == '_' || std::isalpha(static_cast<unsigned char>(c));
 }
@@ -17,55 +20,63 @@ bool isIdentPart(char c) {
   return c == '_' || std::isalnum(static_cast<unsigned char>(c));
 }
 
-Token::Type cmp(Token::Type type, std::string_view id,
-                std::string_view actual) {
-  if (id == actual) {
-    return type;
-  } else {
-    return Token::Type::Ident;
-  }
+struct Keyword {
+  std::string_view text;
+  Token::Type type;
+};
+
+constexpr std::array keywords = {
+    Keyword{"and", Token::Type::And},
+    Keyword{"class", Token::Type::Class},
+    Keyword{"else", Token::Type::Else},
+    Keyword{"false", Token::Type::False},
+    Keyword{"fun", Token::Type::Fun},
+    Keyword{"for", Token::Type::For},
+    Keyword{"if", Token::Type::If},
+    Keyword{"nil", Token::Type::Nil},
+    Keyword{"or", Token::Type::Or},
+    Keyword{"print", Token::Type::Print},
+    Keyword{"return", Token::Type::Return},
+    Keyword{"super", Token::Type::Super},
+    Keyword{"this", Token::Type::This},
+    Keyword{"true", Token::Type::True},
+    Keyword{"var", Token::Type::Var},
+    Keyword{"while", Token::Type::While},
+};
+
+constexpr std::size_t keywordTableSize = 32;
+
+/**
+ * @brief Perfect hash of the keywords.
+ * @details The first and last character and the length are enough to tell
+ * the keywords apart; `keywordTable` checks at compile time that no two
+ * keywords collide.
+ */
+constexpr std::size_t keywordHash(std::string_view identifier) {
+  auto first = static_cast<unsigned char>(identifier.front());
+  auto last = static_cast<unsigned char>(identifier.back());
+  return (first + 5 * last + identifier.size()) % keywordTableSize;
 }
 
-Token::Type potentialKeyword(std::string_view identifier) {
-  switch (identifier.size()) {
-  case 2:
-    switch (identifier[0]) {
-    case 'i': return cmp(Token::Type::If, "if", identifier);
-    case 'o': return cmp(Token::Type::Or, "or", identifier);
-    default: return Token::Type::Ident;
+constexpr std::array<Keyword, keywordTableSize> keywordTable = [] {
+  std::array<Keyword, keywordTableSize> table{};
+  for (const Keyword &keyword : keywords) {
+    Keyword &slot = table[keywordHash(keyword.text)];
+    if (!slot.text.empty()) {
+      throw "keywordHash is not perfect";
     }
-    break;
-  case 3:
-    switch (identifier[1]) {
-    case 'n': return cmp(Token::Type::And, "and", identifier);
-    case 'o': return cmp(Token::Type::For, "for", identifier);
-    case 'u': return cmp(Token::Type::Fun, "fun", identifier);
-    case 'i': return cmp(Token::Type::Nil, "nil", identifier);
-    case 'a': return cmp(Token::Type::Var, "var", identifier);
-    default: return Token::Type::Ident;
-    }
-    break;
-  case 4:
-    switch (identifier[1]) {
-    case 'l': return cmp(Token::Type::Else, "else", identifier);
-    case 'h': return cmp(Token::Type::This, "this", identifier);
-    case 'r': return cmp(Token::Type::True, "true", identifier);
-    default: return Token::Type::Ident;
-    }
-    break;
-  case 5:
-    switch (identifier[0]) {
-    case 'c': return cmp(Token::Type::Class, "class", identifier);
-    case 'f': return cmp(Token::Type::False, "false", identifier);
-    case 'p': return cmp(Token::Type::Print, "print", identifier);
-    case 's': return cmp(Token::Type::Super, "super", identifier);
-    case 'w': return cmp(Token::Type::While, "while", identifier);
-    default: return Token::Type::Ident;
-    }
-    break;
-  case 6: return cmp(Token::Type::Return, "return", identifier);
-  default: return Token::Type::Ident;
+    slot = keyword;
   }
+  return table;
+}();
+
+Token::Type potentialKeyword(std::string_view identifier) {
+  constexpr std::size_t maxLength = 6;
+  if (identifier.size() < 2 || identifier.size() > maxLength) {
+    return Token::Type::Ident;
+  }
+  const Keyword &candidate = keywordTable[keywordHash(identifier)];
+  return candidate.text == identifier ? candidate.type : Token::Type::Ident;
 }
 
 bool isLoxChar(char c) {
@@ -74,6 +85,9 @@ bool isLoxChar(char c) {
   case ')':
   case '{':
   case '}':
+  case '[':
+  case ']':
+  case ':':
   case ',':
   case '.':
   case '-':
@@ -94,6 +108,20 @@ bool isLoxChar(char c) {
 
 } // namespace
 
+loxlang::scan::Scanner::Scanner(Program &p, ChunkSource source,
+                                std::size_t bufferSize)
+    : program{p}, source{std::move(source)}, buffer(bufferSize) {
+  lox_assert(bufferSize >= 2, "scanner needs room for two characters");
+  text = std::string_view(buffer.data(), 0);
+}
+
+loxlang::scan::ChunkSource loxlang::scan::streamSource(std::istream &in) {
+  return [&in](std::span<char> buffer) -> std::size_t {
+    in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return static_cast<std::size_t>(in.gcount());
+  };
+}
+
 loxlang::scan::Token loxlang::scan::Scanner::next() {
   while (true) {
     char c = advance();
@@ -102,6 +130,9 @@ loxlang::scan::Token loxlang::scan::Scanner::next() {
     case ')': return token(Token::Type::RPar);
     case '{': return token(Token::Type::LBrace);
     case '}': return token(Token::Type::RBrace);
+    case '[': return token(Token::Type::LBracket);
+    case ']': return token(Token::Type::RBracket);
+    case ':': return token(Token::Type::Colon);
     case ',': return token(Token::Type::Comma);
     case '.': return token(Token::Type::Dot);
     case '-': return token(Token::Type::Minus);
@@ -151,6 +182,8 @@ loxlang::scan::Token loxlang::scan::Scanner::next() {
 void loxlang::scan::Scanner::lineComment() {
   while (peek() != '\n' && !isAtEnd()) {
     advance();
+    // The comment is dropped anyway, so a streaming buffer need not hold it
+    start = current;
   }
   discard();
 }
@@ -169,6 +202,7 @@ void loxlang::scan::Scanner::blockComment() {
       nesting--;
     }
     advance();
+    start = current;
   }
   lox_assert_eq(advance(), '/', "ending slash");
 
@@ -209,6 +243,9 @@ loxlang::scan::Token loxlang::scan::Scanner::identifierOrKeyword() {
 
   Token t = token(Token::Type::Ident);
   t.type = potentialKeyword(t.text);
+  if (t.type == Token::Type::Ident) {
+    t.symbol = program.symbols().intern(t.text);
+  }
   return t;
 }
 
@@ -219,8 +256,8 @@ loxlang::scan::Token loxlang::scan::Scanner::unknownChars() {
   return error("unknown character");
 }
 
-bool loxlang::scan::Scanner::isAtEnd() const {
-  return current >= program.programText().size();
+bool loxlang::scan::Scanner::isAtEnd() {
+  return current >= text.size() && !fill(0);
 }
 
 char loxlang::scan::Scanner::peek() {
@@ -228,14 +265,53 @@ char loxlang::scan::Scanner::peek() {
     return '\0';
   }
 
-  return program.programText()[current];
+  return text[current];
 }
 
 char loxlang::scan::Scanner::peekNext() {
-  if (current + 1 >= program.programText().size()) {
+  if (current + 1 >= text.size() && !fill(1)) {
     return '\0';
   }
-  return program.programText()[current + 1];
+  return text[current + 1];
+}
+
+bool loxlang::scan::Scanner::fill(std::size_t lookahead) {
+  if (!source || sourceDone) {
+    return false;
+  }
+
+  // Drop everything before the current token to make room
+  if (start > 0) {
+    linesBeforeBase += std::count(text.begin(), text.begin() + start, '\n');
+    std::memmove(buffer.data(), text.data() + start, text.size() - start);
+    text = std::string_view(buffer.data(), text.size() - start);
+    base += start;
+    current -= start;
+    start = 0;
+  }
+
+  while (current + lookahead >= text.size()) {
+    if (text.size() == buffer.size()) {
+      sourceDone = true;
+      program.errorInLine("token does not fit into the scanner buffer",
+                          linesBeforeBase, text.substr(0, 1));
+      return false;
+    }
+    std::span<char> room = std::span(buffer).subspan(text.size());
+    std::size_t count = source(room);
+    if (count == 0) {
+      sourceDone = true;
+      return false;
+    }
+    text = std::string_view(buffer.data(), text.size() + count);
+  }
+  return true;
+}
+
+std::size_t loxlang::scan::Scanner::lineOf(const Token &t) const {
+  std::size_t inBuffer = t.offset - base;
+  return linesBeforeBase +
+         std::count(text.begin(), text.begin() + inBuffer, '\n');
 }
 
 char loxlang::scan::Scanner::advance() {
@@ -253,8 +329,8 @@ bool loxlang::scan::Scanner::advanceIf(char expected) {
 }
 
 loxlang::scan::Token loxlang::scan::Scanner::token(Token::Type type) {
-  std::string_view text = program.part(start, current - start);
-  Token t = Token(type, text);
+  std::size_t end = std::min(current, text.size());
+  Token t = Token(type, text.substr(start, end - start), base + start);
   start = current;
   return t;
 }
@@ -263,14 +339,18 @@ void loxlang::scan::Scanner::discard() { token(Token::Type::Err); }
 
 loxlang::scan::Token loxlang::scan::Scanner::error(std::string_view msg) {
   Token t = token(Token::Type::Err);
-  program.error(msg, t.text);
+  if (source) {
+    program.errorInLine(msg, lineOf(t), t.text);
+  } else {
+    program.error(msg, t.text);
+  }
   return t;
 }
 
 std::string loxlang::scan::Token::typeName(Type type) {
   std::string_view asText = R"ENUMS(
-    LPar, RPar, LBrace, RBrace,
-    Comma, Dot, Minus, Plus, SemiColon, Slash, Star,
+    LPar, RPar, LBrace, RBrace, LBracket, RBracket,
+    Colon, Comma, Dot, Minus, Plus, SemiColon, Slash, Star,
     Bang, BangEq, Eq, EqEq, Greater, Less, GreaterEq, LessEq,
     Ident, String, Number,
     And, Class, Else, False, Fun, For, If, Nil, Or, Print, 
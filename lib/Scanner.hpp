@@ -2,6 +2,12 @@
 #define LOXLANG_LIB_SCANNER_HPP
 
 #include "lib/Program.hpp"
+#include "lib/Symbols.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -17,8 +23,8 @@ struct Token {
    */
   enum class Type : std::uint8_t {
     // clang-format off
-    LPar, RPar, LBrace, RBrace,
-    Comma, Dot, Minus, Plus, SemiColon, Slash, Star,
+    LPar, RPar, LBrace, RBrace, LBracket, RBracket,
+    Colon, Comma, Dot, Minus, Plus, SemiColon, Slash, Star,
     Bang, BangEq, Eq, EqEq, Greater, Less, GreaterEq, LessEq,
     Ident, String, Number,
     And, Class, Else, False, Fun, For, If, Nil, Or, Print, 
@@ -35,9 +41,21 @@ struct Token {
 
   /**
    * @brief A view into the program text that is represented by this token.
+   * @details For a streaming `Scanner`, this is only valid until the next
+   * call to `Scanner::next`.
    */
   std::string_view text;
 
+  /**
+   * @brief The offset of the token from the start of the input
+   */
+  std::uint64_t offset = 0;
+
+  /**
+   * @brief The interned text of an `Ident` token, see `Program::symbols`.
+   */
+  Symbol symbol = noSymbol;
+
   /**
    * @brief Retrieves the name of a program type
    */
@@ -45,11 +63,45 @@ struct Token {
 };
 
 
+/**
+ * @brief A source of program text for a streaming `Scanner`.
+ * @details Fills (a prefix of) the given buffer and returns the number of
+ * characters written; 0 signals the end of the input.
+ */
+using ChunkSource = std::function<std::size_t(std::span<char> buffer)>;
+
+/**
+ * @brief A chunk source reading from an input stream
+ */
+ChunkSource streamSource(std::istream &in);
+
 /**
  * @brief The Scanner or Tokenizer for Lox
  */
 struct Scanner {
-  explicit Scanner(Program &p) : program{p} {}
+  /**
+   * @brief Default buffer size of a streaming scanner
+   */
+  static constexpr std::size_t defaultBufferSize = 64 * 1024;
+
+  /**
+   * @brief Scan the text of a program.
+   */
+  explicit Scanner(Program &p) : program{p}, text{p.programText()} {}
+
+  /**
+   * @brief Scan text that is pulled from `source` as needed.
+   * @details The scanner only keeps a fixed size buffer, so the memory used
+   * does not depend on the size of the input. Token texts point into that
+   * buffer and are only valid until the next call to `next`. A single token
+   * must fit into the buffer, longer ones are reported as an error. As the
+   * parser holds on to tokens, it needs a scanner over a whole `Program`.
+   * @param p Used for error reporting only, its text is ignored.
+   * @param source Provides the program text
+   * @param bufferSize The size of the buffer
+   */
+  Scanner(Program &p, ChunkSource source,
+          std::size_t bufferSize = defaultBufferSize);
 
   Token next();
 
@@ -60,7 +112,9 @@ private:
   Token number();
   Token identifierOrKeyword();
   Token unknownChars();
-  bool isAtEnd() const;
+  bool isAtEnd();
+  bool fill(std::size_t lookahead);
+  std::size_t lineOf(const Token &t) const;
   char peek();
   char peekNext();
   char advance();
@@ -71,8 +125,16 @@ private:
 
 
   Program &program;
+  std::string_view text;
   std::size_t start = 0;
   std::size_t current = 0;
+
+  // streaming mode only
+  ChunkSource source;
+  std::vector<char> buffer;
+  std::uint64_t base = 0;
+  std::size_t linesBeforeBase = 0;
+  bool sourceDone = false;
 };
 
 } // namespace loxlang::scan
@@ -0,0 +1,153 @@
+#include "lib/ScriptPool.hpp"
+#include "lib/Error.hpp"
+#include <algorithm>
+
+using namespace loxlang;
+
+namespace {
+
+std::chrono::nanoseconds
+percentile(std::span<const std::chrono::nanoseconds> sorted, std::size_t pct) {
+  std::size_t index = std::min(sorted.size() - 1, pct * sorted.size() / 100);
+  return sorted[index];
+}
+
+} // namespace
+
+double BatchReport::throughput() const {
+  if (elapsed.count() == 0) {
+    return 0.0;
+  }
+  std::chrono::duration<double> seconds = elapsed;
+  return static_cast<double>(results.size()) / seconds.count();
+}
+
+ScriptPool::ScriptPool(std::size_t threads, const Setup &setup) {
+  threads = std::max<std::size_t>(threads, 1);
+  for (std::size_t i = 0; i < threads; ++i) {
+    auto &worker = workers.emplace_back(std::make_unique<Worker>());
+    if (setup) {
+      setup(worker->session);
+    }
+  }
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers[i]->thread = std::thread([this, i] { work(i); });
+  }
+}
+
+ScriptPool::~ScriptPool() {
+  {
+    std::lock_guard<std::mutex> guard{lock};
+    stopping = true;
+  }
+  batchStarted.notify_all();
+  for (auto &worker : workers) {
+    worker->thread.join();
+  }
+}
+
+BatchReport ScriptPool::run(std::span<const Job> jobs) {
+  BatchReport report{};
+  if (jobs.empty()) {
+    return report;
+  }
+
+  for (const Job &job : jobs) {
+    flattenAll(job.input);
+  }
+  batch = jobs;
+  results.assign(jobs.size(), JobResult{});
+  remaining = jobs.size();
+  start = std::chrono::steady_clock::now();
+  for (std::size_t job = 0; job < jobs.size(); ++job) {
+    Worker &worker = *workers[job % workers.size()];
+    std::lock_guard<std::mutex> guard{worker.queueLock};
+    worker.queue.push_back(job);
+  }
+
+  {
+    std::unique_lock<std::mutex> guard{lock};
+    generation++;
+    batchStarted.notify_all();
+    batchDone.wait(guard, [this] { return remaining == 0; });
+  }
+  report.elapsed = std::chrono::steady_clock::now() - start;
+
+  std::vector<std::chrono::nanoseconds> latencies;
+  latencies.reserve(results.size());
+  for (const JobResult &r : results) {
+    latencies.push_back(r.latency);
+    report.maxWait = std::max(report.maxWait, r.wait);
+  }
+  std::ranges::sort(latencies);
+  report.p50 = percentile(latencies, 50);
+  report.p90 = percentile(latencies, 90);
+  report.p99 = percentile(latencies, 99);
+  report.max = latencies.back();
+  report.results = std::move(results);
+  return report;
+}
+
+void ScriptPool::work(std::size_t self) {
+  std::size_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> guard{lock};
+      batchStarted.wait(
+          guard, [this, seen] { return stopping || generation != seen; });
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+    }
+
+    while (std::optional<std::size_t> job = take(self)) {
+      runJob(*workers[self], *job);
+      if (remaining.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> guard{lock};
+        batchDone.notify_all();
+      }
+    }
+  }
+}
+
+std::optional<std::size_t> ScriptPool::take(std::size_t self) {
+  {
+    Worker &own = *workers[self];
+    std::lock_guard<std::mutex> guard{own.queueLock};
+    if (!own.queue.empty()) {
+      std::size_t job = own.queue.front();
+      own.queue.pop_front();
+      return job;
+    }
+  }
+
+  // Our own queue is empty, steal from the back of someone else’s
+  for (std::size_t i = 1; i < workers.size(); ++i) {
+    Worker &victim = *workers[(self + i) % workers.size()];
+    std::lock_guard<std::mutex> guard{victim.queueLock};
+    if (!victim.queue.empty()) {
+      std::size_t job = victim.queue.back();
+      victim.queue.pop_back();
+      return job;
+    }
+  }
+  return std::nullopt;
+}
+
+void ScriptPool::runJob(Worker &worker, std::size_t job) {
+  lox_assert(job < batch.size(), "job index out of range");
+  auto taken = std::chrono::steady_clock::now();
+  Session &session = worker.session;
+  session.clearGlobals();
+  session.setGlobal("input", deepCopy(batch[job].input));
+
+  JobResult &result = results[job];
+  Session::Script *script =
+      session.compile(batch[job].script, batch[job].name);
+  if (script != nullptr) {
+    result.value = session.run(*script);
+  }
+  result.wait = taken - start;
+  result.latency = std::chrono::steady_clock::now() - taken;
+}
@@ -0,0 +1,154 @@
+#ifndef LOXLANG_LIB_SCRIPTPOOL_HPP
+#define LOXLANG_LIB_SCRIPTPOOL_HPP
+
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace loxlang {
+
+/**
+ * @brief A script to run on a `ScriptPool`.
+ */
+struct Job {
+  /**
+   * @brief The program text
+   */
+  std::string script;
+
+  /**
+   * @brief Passed to the script as the global variable `input`
+   * @details Every job gets its own deep copy (see `deepCopy`), so workers
+   * never share strings, arrays or maps.
+   */
+  Value input;
+
+  /**
+   * @brief The name of the script in error messages, e.g. its file name
+   */
+  std::string name = "job";
+};
+
+/**
+ * @brief The outcome of a single `Job`.
+ */
+struct JobResult {
+  /**
+   * @brief The value of the script, or `std::nullopt` if it had an error
+   */
+  std::optional<Value> value;
+
+  /**
+   * @brief The time from the start of the batch until a worker took the job
+   */
+  std::chrono::nanoseconds wait;
+
+  /**
+   * @brief The time the worker spent on the job, from taking it until it
+   * finished
+   */
+  std::chrono::nanoseconds latency;
+};
+
+/**
+ * @brief Results and timings of a batch of jobs.
+ */
+struct BatchReport {
+  /**
+   * @brief The results, in the same order as the jobs
+   */
+  std::vector<JobResult> results;
+
+  /**
+   * @brief Wall clock time for the whole batch
+   */
+  std::chrono::nanoseconds elapsed;
+
+  /**
+   * @brief Latency percentiles over all jobs of the batch
+   */
+  std::chrono::nanoseconds p50, p90, p99, max;
+
+  /**
+   * @brief The longest time a job waited in a queue
+   */
+  std::chrono::nanoseconds maxWait;
+
+  /**
+   * @brief Finished jobs per second
+   */
+  double throughput() const;
+};
+
+/**
+ * @brief Runs many short scripts on a fixed set of worker threads.
+ * @details Every worker owns a `Session`, which caches the parsed scripts, so
+ * running the same script again does not parse it again. Global variables are
+ * cleared between jobs. The jobs of a batch are distributed evenly over the
+ * workers, and workers that run out of work steal from the others.
+ */
+class ScriptPool {
+public:
+  /**
+   * @brief Called once on every worker’s session, e.g. to define natives.
+   */
+  using Setup = std::function<void(Session &)>;
+
+  /**
+   * @param threads The number of worker threads, at least one
+   * @param setup Initialization for the sessions of the workers
+   */
+  explicit ScriptPool(std::size_t threads, const Setup &setup = {});
+  ScriptPool(const ScriptPool &) = delete;
+  ScriptPool &operator=(const ScriptPool &) = delete;
+  ~ScriptPool();
+
+  /**
+   * @brief Run a batch of jobs and wait for all of them to finish.
+   * @details Only one batch may run at a time. The strings in the inputs are
+   * flattened before the workers start, so they can copy the inputs at the
+   * same time.
+   */
+  BatchReport run(std::span<const Job> jobs);
+
+private:
+  struct Worker {
+    Session session;
+    std::mutex queueLock;
+    std::deque<std::size_t> queue;
+    std::thread thread;
+  };
+
+  void work(std::size_t self);
+  std::optional<std::size_t> take(std::size_t self);
+  void runJob(Worker &worker, std::size_t job);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  std::mutex lock;
+  std::condition_variable batchStarted;
+  std::condition_variable batchDone;
+  std::size_t generation = 0;
+  std::atomic<std::size_t> remaining = 0;
+  bool stopping = false;
+
+  std::span<const Job> batch;
+  std::vector<JobResult> results;
+  std::chrono::steady_clock::time_point start;
+};
+
+} // namespace loxlang
+
+#endif
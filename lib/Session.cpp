@@ -0,0 +1,264 @@
+#include "lib/Session.hpp"
+#include "lib/Ast.hpp"
+#include "lib/Compiler.hpp"
+#include "lib/Debugger.hpp"
+#include "lib/Error.hpp"
+#include "lib/IoNatives.hpp"
+#include "lib/Parser.hpp"
+#include "lib/Runtime.hpp"
+#include "lib/Scanner.hpp"
+#include "lib/Snapshot.hpp"
+#include "lib/Trace.hpp"
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+using namespace loxlang;
+
+namespace {
+
+/**
+ * @brief Sources at least this long are scanned on a separate thread.
+ */
+constexpr std::size_t pipelineThreshold = std::size_t{1} << 20;
+
+std::size_t fiberId(const Value &v) {
+  if (v.type() != Value::Type::Number || v.getNumber() < 0) {
+    throw interpret::NativeError("Expected a fiber id");
+  }
+  return static_cast<std::size_t>(v.getNumber());
+}
+
+} // namespace
+
+Session::Session(interpret::StdStreams stdio)
+    : stdio{stdio}, out{stdio[1], Output::defaultPolicy(stdio[1])} {
+  bindNative("spawn", [this](const std::string &source) {
+    Script *script = compile(source, "spawn");
+    if (script == nullptr) {
+      throw interpret::NativeError("Could not compile the fiber’s code");
+    }
+    return static_cast<double>(scheduler.spawn(script->program, script->chunk));
+  });
+  bindNative("yield", [this]() { scheduler.yield(); });
+  bindNative("join", [this](const Value &id) {
+    return scheduler.join(fiberId(id)).value_or(Value());
+  });
+  aot::defineNatives(globals.natives, out);
+  bindNative("println", [this](const Value &value) {
+    // A full output suspends only this fiber; the call is repeated once the
+    // output takes more.
+    if (!out.ready() &&
+        scheduler.waitFor(out.descriptor(),
+                          interpret::EventLoop::Interest::Write)) {
+      return;
+    }
+    out.printValue(value);
+    out.write("\n");
+  });
+}
+
+Session::~Session() { attachDebugger(nullptr); }
+
+std::optional<Value> Session::eval(std::string_view source,
+                                   std::string_view name) {
+  Script *script = compile(source, name);
+  if (script == nullptr) {
+    return std::nullopt;
+  }
+  return run(*script);
+}
+
+std::size_t Session::KeyHash::operator()(const Key &key) const {
+  std::size_t name = std::hash<std::string_view>{}(key.first);
+  std::size_t source = std::hash<std::string_view>{}(key.second);
+  return name ^ (source + 0x9e3779b97f4a7c15 + (name << 6) + (name >> 2));
+}
+
+Session::Script *Session::compile(std::string_view source,
+                                        std::string_view name) {
+  auto cached = byKey.find(Key{name, source});
+  if (cached != byKey.end()) {
+    scripts.splice(scripts.begin(), scripts, cached->second);
+    return cached->second->get();
+  }
+
+  auto script = std::make_unique<Script>(name, source);
+  script->program.setOutput(out);
+  scan::Scanner scanner = scan::Scanner(script->program);
+  std::unique_ptr<ast::Ast> ast =
+      source.size() >= pipelineThreshold
+          ? parse::parsePipelined(script->program, scanner)
+          : parse::parse(script->program, scanner);
+  if (ast == nullptr || script->program.hadError()) {
+    return nullptr;
+  }
+  std::optional<compile::Chunk> chunk =
+      compile::compile(script->program, ast.get(), globals.natives);
+  if (!chunk.has_value()) {
+    return nullptr;
+  }
+  script->chunk = std::move(chunk.value());
+  return insert(std::move(script));
+}
+
+Session::Script *Session::adopt(const Session &from, const Script &script) {
+  auto cached = byKey.find(Key{script.name, script.source});
+  if (cached != byKey.end()) {
+    scripts.splice(scripts.begin(), scripts, cached->second);
+    return cached->second->get();
+  }
+
+  auto copy = std::make_unique<Script>(script.name, script.source);
+  copy->program.setOutput(out);
+  compile::Chunk &chunk = copy->chunk;
+  chunk.code = script.chunk.code;
+  for (compile::Instruction &in : chunk.code) {
+    if (in.op == compile::OpCode::Call) {
+      in.index = globals.natives.slot(from.globals.natives.name(in.index));
+    }
+  }
+  // the locations point into the source text, now into our copy
+  std::string_view original = script.source;
+  chunk.locations.reserve(script.chunk.locations.size());
+  for (std::string_view location : script.chunk.locations) {
+    if (location.data() >= original.data() &&
+        location.data() <= original.data() + original.size()) {
+      auto offset = static_cast<std::size_t>(location.data() - original.data());
+      location = std::string_view(copy->source).substr(offset, location.size());
+    }
+    chunk.locations.push_back(location);
+  }
+  {
+    Heap::Scope scope(heap);
+    chunk.constants.reserve(script.chunk.constants.size());
+    for (const Value &constant : script.chunk.constants) {
+      chunk.constants.push_back(deepCopy(constant));
+    }
+  }
+  chunk.names = script.chunk.names;
+  return insert(std::move(copy));
+}
+
+Session::Script *Session::insert(std::unique_ptr<Script> script) {
+  if (debugger != nullptr) {
+    debugger->load(script->program, script->chunk, globals);
+  }
+  Script *inserted = script.get();
+  scripts.push_front(std::move(script));
+  byKey.emplace(Key{inserted->name, inserted->source}, scripts.begin());
+  evict(inserted);
+  return inserted;
+}
+
+void Session::forget(Script &script) {
+  if (debugger != nullptr) {
+    debugger->unload(script.chunk);
+  }
+  auto entry = byKey.find(Key{script.name, script.source});
+  lox_assert(entry != byKey.end(), "forgetting a script of this session");
+  auto position = entry->second;
+  byKey.erase(entry);
+  scripts.erase(position);
+}
+
+void Session::setCacheCapacity(std::size_t capacity) {
+  cacheCapacity = capacity;
+  evict();
+}
+
+void Session::evict(const Script *keep) {
+  if (running) {
+    return;
+  }
+  std::size_t unpinned = static_cast<std::size_t>(std::ranges::count_if(
+      scripts, [](const auto &script) { return !script->pinned; }));
+  // `keep` is unpinned, as it has just been compiled
+  std::size_t capacity =
+      keep != nullptr ? std::max<std::size_t>(cacheCapacity, 1) : cacheCapacity;
+  auto it = scripts.end();
+  while (unpinned > capacity) {
+    Script &script = **--it;
+    if (!script.pinned && &script != keep) {
+      ++it; // stays valid when the script is erased
+      forget(script);
+      unpinned--;
+    }
+  }
+}
+
+std::optional<Value> Session::run(Script &script) {
+  lox_trace_scope("run");
+  std::size_t id = scheduler.spawn(script.program, script.chunk);
+  {
+    Heap::Scope scope(heap);
+    running = true;
+    out.setBlocking(false);
+    scheduler.run();
+    out.setBlocking(true);
+    running = false;
+  }
+
+  const interpret::Fiber &fiber = *scheduler.fiber(id);
+  std::optional<Value> result = std::nullopt;
+  if (fiber.state == interpret::Fiber::State::Done) {
+    result = fiber.result;
+  } else if (fiber.state == interpret::Fiber::State::Blocked) {
+    script.program.error("Waiting for a fiber that never finishes",
+                         fiber.chunk->locations[fiber.pc]);
+  }
+  scheduler.clear();
+  out.flushAfterRun();
+  return result;
+}
+
+void Session::defineNative(std::string_view name, std::size_t arity,
+                           interpret::NativeFn fn) {
+  globals.natives.define(name, arity, std::move(fn));
+}
+
+void Session::defineIoNatives() {
+  interpret::defineIoNatives(globals, scheduler, stdio);
+}
+
+void Session::setGlobal(std::string_view name, Value value) {
+  globals.variables.insertOrAssign(std::string(name), std::move(value));
+}
+
+const Value *Session::global(std::string_view name) const {
+  return globals.variables.find(name);
+}
+
+void Session::saveSnapshot(const std::filesystem::path &file) const {
+  snapshot::save(globals, file);
+}
+
+void Session::loadSnapshot(const std::filesystem::path &file) {
+  Heap::Scope scope(heap);
+  snapshot::load(globals, file);
+}
+
+void Session::attachDebugger(interpret::Debugger *debugger) {
+  if (this->debugger != nullptr) {
+    this->debugger->unloadAll();
+  }
+  this->debugger = debugger;
+  scheduler.setDebugger(debugger);
+  if (debugger != nullptr) {
+    for (auto &script : scripts) {
+      debugger->load(script->program, script->chunk, globals);
+    }
+  }
+}
+
+void Session::clearGlobals() { globals.variables.clear(); }
+
+void Session::reset() {
+  if (debugger != nullptr) {
+    debugger->unloadAll();
+  }
+  scheduler.clear();
+  byKey.clear();
+  scripts.clear();
+  globals.variables.clear();
+}
@@ -0,0 +1,280 @@
+#ifndef LOXLANG_LIB_SESSION_HPP
+#define LOXLANG_LIB_SESSION_HPP
+
+#include "lib/Chunk.hpp"
+#include "lib/Heap.hpp"
+#include "lib/Interpreter.hpp"
+#include "lib/IoNatives.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Output.hpp"
+#include "lib/Program.hpp"
+#include "lib/Util.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace loxlang {
+
+/**
+ * @brief A persistent Lox interpreter instance.
+ * @details A session owns everything a running Lox program needs: the source
+ * texts and compiled code of all evaluated snippets, the global variables, the
+ * host functions and the fiber scheduler. Subsequent calls to `eval` see the
+ * definitions of the earlier ones, which is what the REPL needs and what makes
+ * it cheap to reuse one session for many requests.
+ *
+ * The strings, arrays and maps created by the scripts of a session are
+ * accounted on its own heap. Once a script exceeds the heap's hard limit, it
+ * fails with a runtime error, and the session stays usable.
+ *
+ * Sessions do not share any mutable state, so different sessions may be used
+ * from different threads at the same time. A single session is not thread
+ * safe.
+ *
+ * Every session provides the natives `spawn(source)`, which starts a new fiber
+ * running `source` and returns its id, `yield()`, which lets the other fibers
+ * run, `join(id)`, which waits for a fiber and returns its result, and
+ * `println(value)`, which writes a line to the session's `output` (`print`
+ * is a keyword, reserved for the statement), as well as
+ * the natives of `interpret::defineArrayNatives` and
+ * `interpret::defineMapNatives`.
+ */
+class Session {
+public:
+  static constexpr std::size_t defaultCacheCapacity = 256;
+
+  /**
+   * @brief A compiled snippet of Lox code.
+   * @details The program and code point into the owned strings, so scripts
+   * never move in memory; the session hands out stable pointers.
+   */
+  struct Script {
+    Script(std::string_view name, std::string_view source)
+        : name{name}, source{source}, program{this->name, this->source} {}
+    std::string name;
+    std::string source;
+    Program program;
+    compile::Chunk chunk;
+    bool pinned = false;
+  };
+
+  /**
+   * @param stdio The standard input, output and error of the scripts: the
+   * output goes to `stdio[1]`, and the I/O natives use these descriptors
+   * for 0, 1 and 2. They are not closed.
+   */
+  explicit Session(
+      interpret::StdStreams stdio = interpret::standardStreams);
+  ~Session();
+  Session(const Session &) = delete;
+  Session &operator=(const Session &) = delete;
+
+  /**
+   * @brief Parse and evaluate a snippet of Lox code.
+   * @param source The program text, the session keeps its own copy.
+   * @param name The name used when reporting errors.
+   * @return The value of the snippet, or `std::nullopt` if there was an error.
+   * The error has already been reported to the user.
+   */
+  std::optional<Value> eval(std::string_view source,
+                            std::string_view name = "eval");
+
+  /**
+   * @brief Compile a snippet of Lox code for later evaluation.
+   * @details Compiled scripts are cached by their name and source text, so
+   * compiling the same text under the same name again is just a lookup. Once
+   * the cache holds more unpinned scripts than its capacity, the least
+   * recently used ones are dropped, but never while a script is running, and
+   * never the script being returned. A returned pointer is valid until the
+   * next call to `compile`, unless the script is pinned.
+   * @param source The program text, the session keeps its own copy.
+   * @param name The name used when reporting errors.
+   * @return The compiled script, or nullptr if it had errors. The errors
+   * have already been reported to the user.
+   */
+  Script *compile(std::string_view source, std::string_view name = "eval");
+
+  /**
+   * @brief Copy a script compiled by another session into this one.
+   * @details Much cheaper than compiling it again. The calls are bound to the
+   * natives of this session by name, and the constants are copied deeply, so
+   * the sessions share nothing. Several sessions may copy from the same
+   * session at once, as long as nobody changes it meanwhile. The copy is
+   * cached and evicted like a compiled script.
+   * @param from The session that compiled `script`, without a debugger
+   * @return The copy, valid like a script returned by `compile`
+   */
+  Script *adopt(const Session &from, const Script &script);
+
+  /**
+   * @brief Keep a compiled script until it is forgotten.
+   * @details For callers that hold on to scripts, such as a `ModuleCache`.
+   */
+  void pin(Script &script) { script.pinned = true; }
+
+  /**
+   * @brief Drop a compiled script from the cache.
+   * @details The script must not be running; pointers to it become invalid.
+   */
+  void forget(Script &script);
+
+  /**
+   * @brief Limit the number of unpinned scripts the cache keeps.
+   * @details With a capacity of 0, only the script compiled last is kept,
+   * until the next call to `compile`.
+   */
+  void setCacheCapacity(std::size_t capacity);
+
+  /**
+   * @brief The number of compiled scripts the session keeps.
+   */
+  std::size_t cachedScripts() const { return scripts.size(); }
+
+  /**
+   * @brief Evaluate a script of this session.
+   * @details The script runs as a new fiber. This returns once no fiber is
+   * runnable any more, so any fibers the script spawned have run, too.
+   * @return The value of the script, or `std::nullopt` if there was an error.
+   */
+  std::optional<Value> run(Script &script);
+
+  /**
+   * @brief Make a host function callable from Lox.
+   * @details A previous definition with the same name is replaced. Host
+   * functions survive `reset`.
+   * @param name The name under which the function can be called
+   * @param arity The number of arguments the function expects
+   * @param fn The implementation
+   */
+  void defineNative(std::string_view name, std::size_t arity,
+                    interpret::NativeFn fn);
+
+  /**
+   * @brief Make a typed host function callable from Lox.
+   * @details See `interpret::NativeRegistry::bind`.
+   */
+  template <typename F> void bindNative(std::string_view name, F fn) {
+    globals.natives.bind(name, std::move(fn));
+  }
+
+  /**
+   * @brief Give scripts access to files and sockets.
+   * @details Defines the natives of `interpret::defineIoNatives`. These are
+   * not available by default, as the embedding program might not want to
+   * give every script access to the file system.
+   */
+  void defineIoNatives();
+
+  /**
+   * @brief Set a global variable, e.g. to pass input to a script.
+   */
+  void setGlobal(std::string_view name, Value value);
+
+  /**
+   * @brief Look up a global variable.
+   * @return The variable, or nullptr if it is not defined.
+   */
+  const Value *global(std::string_view name) const;
+
+  /**
+   * @brief Save the global variables to a file.
+   * @details Typically done after evaluating a prelude, so that later sessions
+   * can start from its state with `loadSnapshot` instead of evaluating it
+   * again. See `snapshot::save`.
+   * @throw snapshot::SnapshotError If the snapshot cannot be written
+   */
+  void saveSnapshot(const std::filesystem::path &file) const;
+
+  /**
+   * @brief Define the global variables saved in a snapshot file.
+   * @details The objects are charged to the heap of this session. See
+   * `snapshot::load`.
+   * @throw snapshot::SnapshotError If the snapshot cannot be read
+   * @throw HeapLimitError If the objects exceed the heap limit
+   */
+  void loadSnapshot(const std::filesystem::path &file);
+
+  /**
+   * @brief The buffered standard output of this session.
+   * @details `println` and the error reports of the session's scripts go
+   * here. It is flushed according to its `FlushPolicy` (see
+   * `Output::flushAfterRun`), and when the session is destroyed.
+   */
+  Output &output() { return out; }
+
+  /**
+   * @brief Limit the memory the scripts of this session may use.
+   * @details Exceeding the hard limit is a runtime error of the fiber that
+   * allocates: it is reported and fails only that fiber. A script can thus
+   * run risky work in a spawned fiber, whose `join` returns nil if it failed.
+   */
+  void setHeapLimits(HeapLimits limits) { heap->setLimits(limits); }
+
+  /**
+   * @brief The current memory use of the scripts of this session.
+   */
+  HeapStats heapStats() const { return heap->stats(); }
+
+  /**
+   * @brief Limit the instructions and time of each run, and preempt fibers
+   * at the end of their time slice.
+   * @details A run that exceeds its limits is aborted: the running fiber
+   * reports a runtime error, and all fibers of the run fail.
+   */
+  void setRunLimits(interpret::RunLimits limits) {
+    scheduler.setLimits(limits);
+  }
+
+  /**
+   * @brief Let a debugger stop the scripts of this session.
+   * @details The debugger applies to all scripts compiled so far and later.
+   * Pass nullptr to detach it again, which restores the original code.
+   */
+  void attachDebugger(interpret::Debugger *debugger);
+
+  /**
+   * @brief Forget all global variables, but keep the compiled scripts.
+   */
+  void clearGlobals();
+
+  /**
+   * @brief Forget all compiled code and global variables.
+   * @details Registered host functions are kept.
+   */
+  void reset();
+
+private:
+  // name and source of a script
+  using Key = std::pair<std::string_view, std::string_view>;
+  struct KeyHash {
+    std::size_t operator()(const Key &key) const;
+  };
+
+  // drops unpinned scripts other than `keep` beyond the capacity
+  void evict(const Script *keep = nullptr);
+  // caches a new script and returns it
+  Script *insert(std::unique_ptr<Script> script);
+
+  interpret::StdStreams stdio;
+  Output out;
+  // most recently used first
+  std::list<std::unique_ptr<Script>> scripts;
+  std::unordered_map<Key, std::list<std::unique_ptr<Script>>::iterator, KeyHash>
+      byKey;
+  std::size_t cacheCapacity = defaultCacheCapacity;
+  bool running = false;
+  std::shared_ptr<Heap> heap = std::make_shared<Heap>();
+  interpret::Globals globals;
+  interpret::Scheduler scheduler = interpret::Scheduler(globals);
+  interpret::Debugger *debugger = nullptr;
+};
+
+} // namespace loxlang
+
+#endif
@@ -0,0 +1,390 @@
+#include "lib/Snapshot.hpp"
+#include "lib/Array.hpp"
+#include "lib/Map.hpp"
+#include "lib/Trace.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <span>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace loxlang;
+using namespace loxlang::snapshot;
+
+// A snapshot file consists of
+//
+//   header:  magic, version, #strings, #arrays, #maps, #globals (u32 each)
+//   strings: length (u64), characters
+//   arrays:  numeric flag (u8), length (u64), then numbers (f64) or values
+//   maps:    size (u64), then key and value for every entry
+//   globals: name (string index, u32), value
+//
+// where a value is a tag (u8) and an 8 byte payload: the number, or the index
+// of the string, array or map. All integers are in host byte order.
+
+namespace {
+
+constexpr std::array<char, 8> magic = {'L', 'O', 'X', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t version = 1;
+constexpr std::size_t valueSize = 1 + sizeof(std::uint64_t);
+
+enum class Tag : std::uint8_t { Nil, False, True, Number, String, Array, Map };
+
+class Writer {
+public:
+  explicit Writer(const interpret::Globals &globals) {
+    globals.variables.forEach([this](const std::string &name, const Value &v) {
+      globalNames.push_back(string(name));
+      globalValues.push_back(v);
+      discover(v);
+    });
+  }
+
+  std::string write() {
+    put(magic);
+    put(version);
+    put(static_cast<std::uint32_t>(strings.size()));
+    put(static_cast<std::uint32_t>(arrays.size()));
+    put(static_cast<std::uint32_t>(maps.size()));
+    put(static_cast<std::uint32_t>(globalValues.size()));
+    for (std::string_view s : strings) {
+      put(static_cast<std::uint64_t>(s.size()));
+      out.append(s);
+    }
+    for (const Array *a : arrays) {
+      put(static_cast<std::uint8_t>(a->isNumeric()));
+      put(static_cast<std::uint64_t>(a->size()));
+      if (a->isNumeric()) {
+        std::span<const double> numbers = a->numbers();
+        out.append(reinterpret_cast<const char *>(numbers.data()),
+                   numbers.size_bytes());
+      } else {
+        for (std::size_t i = 0; i < a->size(); ++i) {
+          value(a->get(i));
+        }
+      }
+    }
+    for (const Map *m : maps) {
+      put(static_cast<std::uint64_t>(m->size()));
+      m->forEach([this](const Value &key, const Value &v) {
+        value(key);
+        value(v);
+      });
+    }
+    for (std::size_t i = 0; i < globalValues.size(); ++i) {
+      put(globalNames[i]);
+      value(globalValues[i]);
+    }
+    return std::move(out);
+  }
+
+private:
+  /**
+   * @brief Number all strings, arrays and maps reachable from `root`.
+   * @details Iterative, so deeply nested data does not overflow the stack.
+   */
+  void discover(const Value &root) {
+    std::vector<Value> pending = {root};
+    while (!pending.empty()) {
+      Value v = std::move(pending.back());
+      pending.pop_back();
+      switch (v.type()) {
+      case Value::Type::Nil:
+      case Value::Type::Boolean:
+      case Value::Type::Number: break;
+      case Value::Type::String: string(v.getString()); break;
+      case Value::Type::Array: {
+        const Array *a = v.getArray().get();
+        if (!arrayIds.emplace(a, arrays.size()).second) {
+          break;
+        }
+        arrays.push_back(a);
+        if (!a->isNumeric()) {
+          for (std::size_t i = 0; i < a->size(); ++i) {
+            pending.push_back(a->get(i));
+          }
+        }
+      } break;
+      case Value::Type::Map: {
+        const Map *m = v.getMap().get();
+        if (!mapIds.emplace(m, maps.size()).second) {
+          break;
+        }
+        maps.push_back(m);
+        m->forEach([&pending](const Value &key, const Value &value) {
+          pending.push_back(key);
+          pending.push_back(value);
+        });
+      } break;
+      default: throw SnapshotError("Cannot store object pointers");
+      }
+    }
+  }
+
+  std::uint32_t string(std::string_view s) {
+    auto [entry, isNew] =
+        stringIds.emplace(s, static_cast<std::uint32_t>(strings.size()));
+    if (isNew) {
+      strings.push_back(s);
+    }
+    return entry->second;
+  }
+
+  template <typename T> void put(const T &t) {
+    out.append(reinterpret_cast<const char *>(&t), sizeof(T));
+  }
+
+  void value(const Value &v) {
+    Tag tag = Tag::Nil;
+    std::uint64_t payload = 0;
+    switch (v.type()) {
+    case Value::Type::Nil: break;
+    case Value::Type::Boolean: tag = v.getBool() ? Tag::True : Tag::False; break;
+    case Value::Type::Number: {
+      tag = Tag::Number;
+      double n = v.getNumber();
+      std::memcpy(&payload, &n, sizeof(n));
+    } break;
+    case Value::Type::String:
+      tag = Tag::String;
+      payload = stringIds.at(v.getString());
+      break;
+    case Value::Type::Array:
+      tag = Tag::Array;
+      payload = arrayIds.at(v.getArray().get());
+      break;
+    case Value::Type::Map:
+      tag = Tag::Map;
+      payload = mapIds.at(v.getMap().get());
+      break;
+    default: lox_fail("undiscovered value");
+    }
+    put(tag);
+    put(payload);
+  }
+
+  std::string out;
+  // views into the strings of the globals, which outlive the writer
+  std::vector<std::string_view> strings;
+  std::unordered_map<std::string_view, std::uint32_t> stringIds;
+  std::vector<const Array *> arrays;
+  std::unordered_map<const Array *, std::uint64_t> arrayIds;
+  std::vector<const Map *> maps;
+  std::unordered_map<const Map *, std::uint64_t> mapIds;
+  std::vector<std::uint32_t> globalNames;
+  std::vector<Value> globalValues;
+};
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ */
+class Mapping {
+public:
+  explicit Mapping(const std::filesystem::path &file) {
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      throw SnapshotError("Cannot open " + file.string());
+    }
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+      size = static_cast<std::size_t>(info.st_size);
+      data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED || data == nullptr) {
+      throw SnapshotError("Cannot map " + file.string());
+    }
+  }
+  Mapping(const Mapping &) = delete;
+  Mapping &operator=(const Mapping &) = delete;
+  ~Mapping() { munmap(data, size); }
+
+  std::span<const std::byte> bytes() const {
+    return {static_cast<const std::byte *>(data), size};
+  }
+
+private:
+  void *data = nullptr;
+  std::size_t size = 0;
+};
+
+class Reader {
+public:
+  explicit Reader(std::span<const std::byte> bytes) : bytes{bytes} {}
+
+  void read(interpret::Globals &globals) {
+    if (take<std::array<char, 8>>() != magic) {
+      malformed("not a Lox snapshot");
+    }
+    if (take<std::uint32_t>() != version) {
+      malformed("unsupported version");
+    }
+    strings.resize(count(sizeof(std::uint64_t)));
+    arrays.resize(count(1 + sizeof(std::uint64_t)));
+    maps.resize(count(sizeof(std::uint64_t)));
+    std::uint32_t globalCount = count(sizeof(std::uint32_t) + valueSize);
+
+    for (LoxString &s : strings) {
+      std::span<const std::byte> text = skip(take<std::uint64_t>(), 1);
+      s = LoxString(
+          std::string(reinterpret_cast<const char *>(text.data()), text.size()));
+    }
+
+    // Create all containers first, so that the values can refer to them.
+    // Numeric arrays contain no references and are copied right away.
+    std::vector<std::pair<std::size_t, std::span<const std::byte>>> boxed;
+    for (std::size_t i = 0; i < arrays.size(); ++i) {
+      bool numeric = take<std::uint8_t>() != 0;
+      std::uint64_t size = take<std::uint64_t>();
+      if (numeric) {
+        std::span<const std::byte> data = skip(size, sizeof(double));
+        std::vector<double> numbers(size);
+        std::memcpy(numbers.data(), data.data(), data.size());
+        arrays[i] = std::make_shared<Array>(std::move(numbers));
+      } else {
+        boxed.emplace_back(i, skip(size, valueSize));
+        arrays[i] = std::make_shared<Array>(std::vector<Value>());
+      }
+    }
+    std::vector<std::span<const std::byte>> entries(maps.size());
+    for (std::size_t i = 0; i < maps.size(); ++i) {
+      entries[i] = skip(take<std::uint64_t>(), 2 * valueSize);
+      maps[i] = std::make_shared<Map>();
+    }
+
+    for (auto [i, data] : boxed) {
+      Reader elements(data);
+      while (!elements.atEnd()) {
+        arrays[i]->push(resolve(elements.rawValue()));
+      }
+    }
+    for (std::size_t i = 0; i < maps.size(); ++i) {
+      Reader pairs(entries[i]);
+      while (!pairs.atEnd()) {
+        Value key = resolve(pairs.rawValue());
+        if (!Map::isKey(key)) {
+          malformed("invalid map key");
+        }
+        maps[i]->set(std::move(key), resolve(pairs.rawValue()));
+      }
+    }
+
+    std::vector<std::pair<std::uint32_t, Value>> variables;
+    variables.reserve(globalCount);
+    for (std::uint32_t i = 0; i < globalCount; ++i) {
+      std::uint32_t name = take<std::uint32_t>();
+      if (name >= strings.size()) {
+        malformed("bad string index");
+      }
+      variables.emplace_back(name, resolve(rawValue()));
+    }
+    if (!atEnd()) {
+      malformed("trailing data");
+    }
+    for (auto &[name, v] : variables) {
+      globals.variables.insertOrAssign(strings[name].str(), std::move(v));
+    }
+  }
+
+private:
+  using RawValue = std::pair<Tag, std::uint64_t>;
+
+  [[noreturn]] static void malformed(const std::string &why) {
+    throw SnapshotError("Malformed snapshot: " + why);
+  }
+
+  bool atEnd() const { return pos == bytes.size(); }
+
+  std::span<const std::byte> skip(std::uint64_t count, std::size_t size) {
+    if (count > (bytes.size() - pos) / size) {
+      malformed("truncated");
+    }
+    std::span<const std::byte> result = bytes.subspan(pos, count * size);
+    pos += result.size();
+    return result;
+  }
+
+  /**
+   * @brief Read the number of items of a section, each at least `minBytes`
+   * long.
+   */
+  std::uint32_t count(std::size_t minBytes) {
+    auto n = take<std::uint32_t>();
+    if (n > (bytes.size() - pos) / minBytes) {
+      malformed("truncated");
+    }
+    return n;
+  }
+
+  template <typename T> T take() {
+    T t;
+    std::memcpy(&t, skip(1, sizeof(T)).data(), sizeof(T));
+    return t;
+  }
+
+  RawValue rawValue() {
+    auto tag = take<Tag>();
+    return {tag, take<std::uint64_t>()};
+  }
+
+  /**
+   * @brief Turn a value read by this or a nested reader into a `Value`.
+   */
+  Value resolve(RawValue raw) const {
+    auto [tag, payload] = raw;
+    auto at = [payload](const auto &objects) -> const auto & {
+      if (payload >= objects.size()) {
+        malformed("bad object index");
+      }
+      return objects[payload];
+    };
+    switch (tag) {
+    case Tag::Nil: return Value();
+    case Tag::False: return Value(false);
+    case Tag::True: return Value(true);
+    case Tag::Number: {
+      double n = 0;
+      std::memcpy(&n, &payload, sizeof(n));
+      return Value(n);
+    }
+    case Tag::String: return Value(at(strings));
+    case Tag::Array: return Value(at(arrays));
+    case Tag::Map: return Value(at(maps));
+    default: malformed("bad value tag");
+    }
+  }
+
+  std::span<const std::byte> bytes;
+  std::size_t pos = 0;
+  std::vector<LoxString> strings;
+  std::vector<std::shared_ptr<Array>> arrays;
+  std::vector<std::shared_ptr<Map>> maps;
+};
+
+} // namespace
+
+void snapshot::save(const interpret::Globals &globals,
+                    const std::filesystem::path &file) {
+  lox_trace_scope("save snapshot");
+  std::string data = Writer(globals).write();
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  out.write(data.data(), static_cast<std::streamsize>(data.size()));
+  if (!out) {
+    throw SnapshotError("Cannot write " + file.string());
+  }
+}
+
+void snapshot::load(interpret::Globals &globals,
+                    const std::filesystem::path &file) {
+  lox_trace_scope("load snapshot");
+  Mapping mapping(file);
+  Reader(mapping.bytes()).read(globals);
+}
@@ -0,0 +1,43 @@
+#ifndef LOXLANG_LIB_SNAPSHOT_HPP
+#define LOXLANG_LIB_SNAPSHOT_HPP
+
+#include "lib/Interpreter.hpp"
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+namespace loxlang::snapshot {
+
+/**
+ * @brief A snapshot could not be written or read.
+ */
+struct SnapshotError : public std::runtime_error {
+  explicit SnapshotError(const std::string &msg) : std::runtime_error(msg) {}
+};
+
+/**
+ * @brief Write the global variables, and everything reachable from them, to a
+ * file.
+ * @details The file is position independent: objects refer to each other by
+ * their index in the file, so shared and cyclic arrays and maps keep their
+ * shape. Strings are stored once per distinct text. Natives and compiled code
+ * are not part of the snapshot; the host defines natives again and scripts
+ * are compiled on demand.
+ * @throw SnapshotError If the file cannot be written, or a variable holds a
+ * value that cannot be stored
+ */
+void save(const interpret::Globals &globals, const std::filesystem::path &file);
+
+/**
+ * @brief Add the global variables stored in a snapshot file.
+ * @details The file is mapped into memory and its objects are rebuilt
+ * directly from the mapping, without parsing or running any Lox code. The
+ * variables are only defined if the whole file could be read; existing
+ * variables with the same names are replaced.
+ * @throw SnapshotError If the file cannot be read or is malformed
+ */
+void load(interpret::Globals &globals, const std::filesystem::path &file);
+
+} // namespace loxlang::snapshot
+
+#endif
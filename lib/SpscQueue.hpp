@@ -0,0 +1,97 @@
+#ifndef LOXLANG_LIB_SPSCQUEUE_HPP
+#define LOXLANG_LIB_SPSCQUEUE_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+namespace loxlang::util {
+
+/**
+ * @brief Assumed size of a cache line, to keep independently written data
+ * apart.
+ */
+constexpr std::size_t cacheLineSize = 64;
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer and one consumer
+ * thread.
+ * @details The producer only writes `tail` and the consumer only writes
+ * `head`; both live on cache lines of their own, so the two threads do not
+ * contend for them. The blocking `wait…` functions sleep on the index of the
+ * other side (`std::atomic::wait`), so a full queue throttles the producer
+ * and an empty queue parks the consumer without spinning.
+ */
+template <typename T> class SpscQueue {
+public:
+  /**
+   * @param capacity The capacity, rounded up to the next power of two
+   */
+  explicit SpscQueue(std::size_t capacity)
+      : slots(std::bit_ceil(capacity)), mask{slots.size() - 1} {}
+
+  /**
+   * @brief Producer only: append `value`, unless the queue is full.
+   */
+  bool tryPush(T &value) {
+    std::size_t t = tail.value.load(std::memory_order_relaxed);
+    if (t - head.value.load(std::memory_order_acquire) == slots.size()) {
+      return false;
+    }
+    slots[t & mask] = std::move(value);
+    tail.value.store(t + 1, std::memory_order_release);
+    tail.value.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Consumer only: take the oldest element, unless the queue is empty.
+   */
+  bool tryPop(T &value) {
+    std::size_t h = head.value.load(std::memory_order_relaxed);
+    if (h == tail.value.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = std::move(slots[h & mask]);
+    head.value.store(h + 1, std::memory_order_release);
+    head.value.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Producer only: sleep while the queue is full.
+   * @details May return spuriously.
+   */
+  void waitForSpace() const {
+    std::size_t h = head.value.load(std::memory_order_acquire);
+    if (tail.value.load(std::memory_order_relaxed) - h == slots.size()) {
+      head.value.wait(h, std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * @brief Consumer only: sleep while the queue is empty.
+   * @details May return spuriously.
+   */
+  void waitForData() const {
+    std::size_t t = tail.value.load(std::memory_order_acquire);
+    if (head.value.load(std::memory_order_relaxed) == t) {
+      tail.value.wait(t, std::memory_order_acquire);
+    }
+  }
+
+private:
+  struct alignas(cacheLineSize) Index {
+    std::atomic<std::size_t> value = 0;
+  };
+
+  Index head;
+  Index tail;
+  std::vector<T> slots;
+  std::size_t mask;
+};
+
+} // namespace loxlang::util
+
+#endif
@@ -0,0 +1,16 @@
+#include "lib/Symbols.hpp"
+#include "lib/Error.hpp"
+
+using namespace loxlang;
+
+Symbol SymbolTable::intern(std::string_view name) {
+  auto found = ids.find(name);
+  if (found != ids.end()) {
+    return found->second;
+  }
+  lox_assert(names.size() < noSymbol, "too many symbols");
+  auto symbol = static_cast<Symbol>(names.size());
+  // the key views the copy, which the deque never moves
+  ids.emplace(names.emplace_back(name), symbol);
+  return symbol;
+}
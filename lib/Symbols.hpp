@@ -0,0 +1,58 @@
+#ifndef LOXLANG_LIB_SYMBOLS_HPP
+#define LOXLANG_LIB_SYMBOLS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace loxlang {
+
+/**
+ * @brief Dense id of an interned identifier.
+ */
+using Symbol = std::uint32_t;
+
+/**
+ * @brief Marks tokens that are not identifiers.
+ */
+constexpr Symbol noSymbol = std::numeric_limits<Symbol>::max();
+
+/**
+ * @brief Interns identifiers.
+ * @details Each distinct identifier text gets the next free id, so later
+ * phases can compare identifiers as integers and keep per-identifier data in
+ * arrays indexed by the symbol. The table owns copies of the texts, so they
+ * outlive the buffer of a streaming scanner.
+ *
+ * Not thread-safe: only the scanner interns, and nobody may read the table
+ * while a `scan::PipelinedScanner` runs.
+ */
+class SymbolTable {
+public:
+  /**
+   * @brief The symbol of `name`, which is added if it is new.
+   */
+  Symbol intern(std::string_view name);
+
+  /**
+   * @brief The text of a symbol.
+   */
+  std::string_view name(Symbol symbol) const { return names[symbol]; }
+
+  /**
+   * @brief The number of symbols, all of which are smaller than this.
+   */
+  std::size_t size() const { return names.size(); }
+
+private:
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, Symbol> ids;
+};
+
+} // namespace loxlang
+
+#endif
@@ -0,0 +1,360 @@
+#include "lib/Trace.hpp"
+#include "lib/SpscQueue.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+using namespace loxlang;
+using namespace loxlang::trace;
+
+std::atomic<bool> trace::detail::active = false;
+
+// A trace file starts with the magic bytes and a version (u32), followed by
+// records of a type byte and their data:
+//
+//   'C' clock:   time stamp (u64), steady clock in ns (u64)
+//   'N' name:    id (u32), length (u32), characters
+//   'E' events:  thread (u32), count (u32), that many `Event`s
+//   'D' dropped: thread (u32), number of dropped events (u64)
+//
+// Clock records are written at the start and the end of the trace and relate
+// the time stamps of the events to real time.
+
+namespace {
+
+constexpr std::string_view magic = "LOXTRACE";
+constexpr std::uint32_t version = 1;
+
+/**
+ * @brief Events per thread that can wait for the writer thread.
+ */
+constexpr std::size_t bufferCapacity = std::size_t{1} << 16;
+
+constexpr auto flushInterval = std::chrono::milliseconds(10);
+
+std::uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+std::uint64_t steadyNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+struct Buffer {
+  explicit Buffer(std::uint32_t thread) : thread{thread} {}
+  util::SpscQueue<Event> queue{bufferCapacity};
+  std::uint32_t thread;
+  std::atomic<std::uint64_t> dropped = 0;
+};
+
+class Tracer {
+public:
+  ~Tracer() { stop(); }
+
+  std::uint32_t intern(std::string_view name) {
+    std::lock_guard guard(lock);
+    auto [entry, isNew] =
+        ids.emplace(std::string(name), static_cast<std::uint32_t>(names.size()));
+    if (isNew) {
+      names.push_back(&entry->first);
+    }
+    return entry->second;
+  }
+
+  /**
+   * @brief The buffer of the calling thread, created on first use.
+   * @details Buffers are never freed, so events of threads that have exited
+   * can still be written.
+   */
+  Buffer &buffer() {
+    thread_local Buffer *own = nullptr;
+    if (own == nullptr) {
+      std::lock_guard guard(lock);
+      own = buffers
+                .emplace_back(std::make_unique<Buffer>(
+                    static_cast<std::uint32_t>(buffers.size())))
+                .get();
+    }
+    return *own;
+  }
+
+  bool start(const std::filesystem::path &file) {
+    std::lock_guard guard(lock);
+    if (writer.joinable()) {
+      return false;
+    }
+    out.open(file, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    out.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+    put(version);
+    clock();
+    writtenNames = 0;
+    stopping = false;
+    writer = std::thread([this] { writeLoop(); });
+    detail::active.store(true, std::memory_order_relaxed);
+    return true;
+  }
+
+  void stop() {
+    {
+      std::lock_guard guard(lock);
+      if (!writer.joinable()) {
+        return;
+      }
+      detail::active.store(false, std::memory_order_relaxed);
+      stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    std::lock_guard guard(lock);
+    flush();
+    for (const auto &buffer : buffers) {
+      std::uint64_t dropped = buffer->dropped.exchange(0);
+      if (dropped != 0) {
+        put('D');
+        put(buffer->thread);
+        put(dropped);
+      }
+    }
+    clock();
+    out.close();
+  }
+
+private:
+  void writeLoop() {
+    std::unique_lock guard(lock);
+    while (!stopping) {
+      wake.wait_for(guard, flushInterval);
+      flush();
+    }
+  }
+
+  /**
+   * @brief Write the new names and all buffered events; holds `lock`.
+   */
+  void flush() {
+    for (; writtenNames < names.size(); ++writtenNames) {
+      const std::string &name = *names[writtenNames];
+      put('N');
+      put(static_cast<std::uint32_t>(writtenNames));
+      put(static_cast<std::uint32_t>(name.size()));
+      out.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+    for (const auto &buffer : buffers) {
+      events.clear();
+      Event event{};
+      while (buffer->queue.tryPop(event)) {
+        events.push_back(event);
+      }
+      if (events.empty()) {
+        continue;
+      }
+      put('E');
+      put(buffer->thread);
+      put(static_cast<std::uint32_t>(events.size()));
+      out.write(reinterpret_cast<const char *>(events.data()),
+                static_cast<std::streamsize>(events.size() * sizeof(Event)));
+    }
+    out.flush();
+  }
+
+  void clock() {
+    put('C');
+    put(now());
+    put(steadyNanos());
+  }
+
+  template <typename T> void put(const T &t) {
+    out.write(reinterpret_cast<const char *>(&t), sizeof(T));
+  }
+
+  std::mutex lock;
+  std::unordered_map<std::string, std::uint32_t> ids;
+  // the keys of `ids`, by id
+  std::vector<const std::string *> names;
+  std::deque<std::unique_ptr<Buffer>> buffers;
+
+  std::ofstream out;
+  std::thread writer;
+  std::condition_variable wake;
+  bool stopping = false;
+  std::size_t writtenNames = 0;
+  std::vector<Event> events;
+};
+
+Tracer &tracer() {
+  static Tracer instance;
+  return instance;
+}
+
+void writeJsonString(std::ostream &out, std::string_view s) {
+  out << '"';
+  for (char c : s) {
+    switch (c) {
+    case '"': out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xf]
+            << "0123456789abcdef"[c & 0xf];
+      } else {
+        out << c;
+      }
+    }
+  }
+  out << '"';
+}
+
+} // namespace
+
+std::uint32_t trace::intern(std::string_view name) {
+  return tracer().intern(name);
+}
+
+bool trace::start(const std::filesystem::path &file) {
+  return tracer().start(file);
+}
+
+void trace::stop() { tracer().stop(); }
+
+void trace::record(EventKind kind, std::uint32_t name) {
+  Buffer &buffer = tracer().buffer();
+  Event event{now(), name, kind};
+  if (!buffer.queue.tryPush(event)) {
+    buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool trace::toChromeJson(const std::filesystem::path &file,
+                         std::ostream &out) {
+  std::ifstream in(file, std::ios::binary);
+  std::string header(magic.size(), '\0');
+  std::uint32_t fileVersion = 0;
+  in.read(header.data(), static_cast<std::streamsize>(header.size()));
+  in.read(reinterpret_cast<char *>(&fileVersion), sizeof(fileVersion));
+  if (!in || header != magic || fileVersion != version) {
+    return false;
+  }
+
+  auto get = [&in](auto &t) {
+    in.read(reinterpret_cast<char *>(&t), sizeof(t));
+    return static_cast<bool>(in);
+  };
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> clocks;
+  std::map<std::uint32_t, std::string> names;
+  std::vector<std::pair<std::uint32_t, Event>> events;
+  std::map<std::uint32_t, std::uint64_t> dropped;
+  char type = 0;
+  while (get(type)) {
+    switch (type) {
+    case 'C': {
+      std::uint64_t time = 0;
+      std::uint64_t nanos = 0;
+      if (!get(time) || !get(nanos)) {
+        return false;
+      }
+      clocks.emplace_back(time, nanos);
+    } break;
+    case 'N': {
+      std::uint32_t id = 0;
+      std::uint32_t length = 0;
+      if (!get(id) || !get(length)) {
+        return false;
+      }
+      std::string name(length, '\0');
+      if (!in.read(name.data(), length)) {
+        return false;
+      }
+      names[id] = std::move(name);
+    } break;
+    case 'E': {
+      std::uint32_t thread = 0;
+      std::uint32_t count = 0;
+      if (!get(thread) || !get(count)) {
+        return false;
+      }
+      for (std::uint32_t i = 0; i < count; ++i) {
+        Event event{};
+        if (!get(event)) {
+          return false;
+        }
+        events.emplace_back(thread, event);
+      }
+    } break;
+    case 'D': {
+      std::uint32_t thread = 0;
+      std::uint64_t count = 0;
+      if (!get(thread) || !get(count)) {
+        return false;
+      }
+      dropped[thread] += count;
+    } break;
+    default: return false;
+    }
+  }
+  if (clocks.empty()) {
+    return false;
+  }
+
+  // time stamps to microseconds since the start of the trace
+  auto [firstTime, firstNanos] = clocks.front();
+  auto [lastTime, lastNanos] = clocks.back();
+  double nanosPerTick =
+      lastTime > firstTime ? static_cast<double>(lastNanos - firstNanos) /
+                                 static_cast<double>(lastTime - firstTime)
+                           : 1.0;
+  auto micros = [&](std::uint64_t time) {
+    return (static_cast<double>(time) - static_cast<double>(firstTime)) *
+           nanosPerTick / 1000.0;
+  };
+
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto &[thread, event] : events) {
+    out << (first ? "\n" : ",\n") << "{\"name\":";
+    first = false;
+    auto name = names.find(event.name);
+    writeJsonString(out, name != names.end() ? name->second : "?");
+    switch (event.kind) {
+    case EventKind::Begin: out << ",\"ph\":\"B\""; break;
+    case EventKind::End: out << ",\"ph\":\"E\""; break;
+    default: out << ",\"ph\":\"i\",\"s\":\"t\""; break;
+    }
+    out << ",\"ts\":" << micros(event.time) << ",\"pid\":1,\"tid\":" << thread
+        << '}';
+  }
+  for (const auto &[thread, count] : dropped) {
+    out << (first ? "\n" : ",\n")
+        << "{\"name\":\"dropped events\",\"ph\":\"i\",\"s\":\"t\",\"ts\":"
+        << micros(lastTime) << ",\"pid\":1,\"tid\":" << thread
+        << ",\"args\":{\"count\":" << count << "}}";
+    first = false;
+  }
+  out << "\n]}\n";
+  return true;
+}
@@ -0,0 +1,135 @@
+#ifndef LOXLANG_LIB_TRACE_HPP
+#define LOXLANG_LIB_TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string_view>
+
+/**
+ * @brief Set to 0 (CMake option `LOXLANG_TRACE`) to compile out all trace
+ * points.
+ */
+#ifndef LOXLANG_TRACE
+#define LOXLANG_TRACE 1
+#endif
+
+namespace loxlang::trace {
+
+constexpr bool traceCompiledIn = LOXLANG_TRACE != 0;
+
+enum class EventKind : std::uint8_t { Begin, End, Instant };
+
+/**
+ * @brief A single trace record, as stored in the trace file.
+ */
+struct Event {
+  /**
+   * @brief Time stamp counter, or nanoseconds where there is none
+   */
+  std::uint64_t time;
+  std::uint32_t name;
+  EventKind kind;
+};
+
+static_assert(sizeof(Event) == 16);
+
+namespace detail {
+extern std::atomic<bool> active;
+} // namespace detail
+
+/**
+ * @brief Whether a trace is being recorded.
+ */
+inline bool enabled() {
+  return traceCompiledIn && detail::active.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief The id of an event name; the same name always gets the same id.
+ * @details Takes a lock, so call sites keep the id (see `lox_trace_scope`).
+ */
+std::uint32_t intern(std::string_view name);
+
+/**
+ * @brief Start recording a trace into a file.
+ * @details Every thread records into a ring buffer of its own, without
+ * locks; a background thread moves the events into the file. Events are
+ * dropped (and counted) if a buffer runs full.
+ * @return false if the file cannot be opened or a trace is already running
+ */
+bool start(const std::filesystem::path &file);
+
+/**
+ * @brief Stop recording and write all buffered events.
+ */
+void stop();
+
+/**
+ * @brief Record an event of the current thread; only call if `enabled()`.
+ */
+void record(EventKind kind, std::uint32_t name);
+
+/**
+ * @brief Records the begin and end of its lifetime.
+ */
+class Scope {
+public:
+  explicit Scope(std::uint32_t name) : traced{enabled()}, name{name} {
+    if (traced) {
+      record(EventKind::Begin, name);
+    }
+  }
+  Scope(const Scope &) = delete;
+  Scope &operator=(const Scope &) = delete;
+  ~Scope() {
+    if (traced) {
+      record(EventKind::End, name);
+    }
+  }
+
+private:
+  bool traced;
+  std::uint32_t name;
+};
+
+/**
+ * @brief Convert a trace file to the Chrome trace event format (JSON), as
+ * read by `chrome://tracing` and Perfetto.
+ * @return false if the file is not a valid trace
+ */
+bool toChromeJson(const std::filesystem::path &file, std::ostream &out);
+
+/**
+ * @def lox_trace_scope(name)
+ * @brief Trace the rest of the enclosing block as `name`.
+ */
+
+/**
+ * @def lox_trace_instant(name)
+ * @brief Trace a point in time as `name`.
+ */
+
+#define LOX_TRACE_CONCAT_(a, b) a##b
+#define LOX_TRACE_CONCAT(a, b) LOX_TRACE_CONCAT_(a, b)
+
+#if LOXLANG_TRACE
+#define lox_trace_scope(name)                                                  \
+  static const std::uint32_t LOX_TRACE_CONCAT(loxTraceName, __LINE__) =        \
+      loxlang::trace::intern(name);                                            \
+  const loxlang::trace::Scope LOX_TRACE_CONCAT(loxTraceScope, __LINE__)(       \
+      LOX_TRACE_CONCAT(loxTraceName, __LINE__))
+#define lox_trace_instant(name)                                                \
+  if (loxlang::trace::enabled()) {                                             \
+    static const std::uint32_t loxTraceName = loxlang::trace::intern(name);    \
+    loxlang::trace::record(loxlang::trace::EventKind::Instant, loxTraceName);  \
+  }
+#else
+#define lox_trace_scope(name)
+#define lox_trace_instant(name)
+#endif
+
+} // namespace loxlang::trace
+
+#endif
@@ -0,0 +1,614 @@
+#include "lib/Transpiler.hpp"
+#include "lib/Ast.hpp"
+#include "lib/Error.hpp"
+#include "lib/Natives.hpp"
+#include "lib/Runtime.hpp"
+#include "lib/Trace.hpp"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace loxlang;
+using namespace loxlang::ast;
+using namespace loxlang::scan;
+using namespace loxlang::transpile;
+
+namespace {
+
+/**
+ * @brief The static type of an expression. `Unknown` only occurs while the
+ * types of global variables are inferred.
+ */
+enum class Type : std::uint8_t { Unknown, Number, Boolean, Value };
+
+Type join(Type a, Type b) {
+  if (a == Type::Unknown || a == b) {
+    return b;
+  }
+  return b == Type::Unknown ? a : Type::Value;
+}
+
+std::string_view cppType(Type type) {
+  switch (type) {
+  case Type::Number: return "double";
+  case Type::Boolean: return "bool";
+  default: return "Value";
+  }
+}
+
+bool isArithmetic(Token::Type op) {
+  return op == Token::Type::Minus || op == Token::Type::Star ||
+         op == Token::Type::Slash;
+}
+
+bool isComparison(Token::Type op) {
+  return op == Token::Type::Greater || op == Token::Type::GreaterEq ||
+         op == Token::Type::Less || op == Token::Type::LessEq;
+}
+
+/**
+ * @brief Infers the types of the global variables.
+ * @details A variable has the join of the types of all values assigned to it.
+ * These depend on the types of the variables, so the inference starts with
+ * `Unknown` for all of them and repeats until nothing changes. Variables
+ * that are still `Unknown` then (only assigned each other) become `Value`s,
+ * and the inference is repeated once more for the variables depending on
+ * them.
+ */
+struct Inference : public StaticVisitor<Inference, Type> {
+  std::map<std::string_view, Type> globals;
+  bool changed = false;
+
+  static std::map<std::string_view, Type> infer(Ast *ast) {
+    Inference inference;
+    // defined by the runtime
+    inference.globals["args"] = Type::Value;
+    inference.fixpoint(ast);
+    for (auto &[name, type] : inference.globals) {
+      if (type == Type::Unknown) {
+        type = Type::Value;
+      }
+    }
+    inference.fixpoint(ast);
+    return std::move(inference.globals);
+  }
+
+  void fixpoint(Ast *ast) {
+    do {
+      changed = false;
+      accept(ast);
+    } while (changed);
+  }
+
+  void assign(std::string_view name, Type type) {
+    Type &global = globals[name];
+    Type joined = join(global, type);
+    changed = changed || joined != global;
+    global = joined;
+  }
+
+  Type visitAssignExpr(Assign *expr) {
+    Type type = accept(expr->value.get());
+    assign(expr->name.text, type);
+    return type;
+  }
+
+  Type visitBinaryExpr(Binary *expr) {
+    if (expr->op.type == Token::Type::Eq) {
+      if (expr->left->type() == AstType::IndexExpr) {
+        auto *target = static_cast<Index *>(expr->left.get());
+        accept(target->object.get());
+        accept(target->index.get());
+        return accept(expr->right.get());
+      }
+      if (expr->left->type() == AstType::VariableExpr) {
+        Type type = accept(expr->right.get());
+        assign(static_cast<Variable *>(expr->left.get())->name.text, type);
+        return type;
+      }
+      return Type::Value;
+    }
+
+    std::vector<Binary *> chain = leftChain(expr);
+    Type type = accept(chain.front()->left.get());
+    for (Binary *op : chain) {
+      type = binaryOp(op->op, type, accept(op->right.get()));
+    }
+    return type;
+  }
+
+  static Type binaryOp(Token op, Type left, Type right) {
+    if (op.type == Token::Type::Plus) {
+      if ((left == Type::Number || left == Type::Unknown) &&
+          (right == Type::Number || right == Type::Unknown)) {
+        return join(left, right);
+      }
+      return Type::Value;
+    }
+    return isArithmetic(op.type) ? Type::Number : Type::Boolean;
+  }
+
+  Type visitCallExpr(Call *expr) {
+    for (auto &arg : expr->arguments) {
+      accept(arg.get());
+    }
+    return Type::Value;
+  }
+
+  Type visitGroupingExpr(Grouping *expr) {
+    return accept(expr->expression.get());
+  }
+
+  Type visitIndexExpr(Index *expr) {
+    accept(expr->object.get());
+    accept(expr->index.get());
+    return Type::Value;
+  }
+
+  Type visitLiteralExpr(Literal *expr) {
+    switch (expr->value.type()) {
+    case loxlang::Value::Type::Number: return Type::Number;
+    case loxlang::Value::Type::Boolean: return Type::Boolean;
+    default: return Type::Value;
+    }
+  }
+
+  Type visitLogicalExpr(Logical *expr) {
+    return join(accept(expr->left.get()), accept(expr->right.get()));
+  }
+
+  Type visitMapLiteralExpr(MapLiteral *expr) {
+    for (std::size_t i = 0; i < expr->keys.size(); ++i) {
+      accept(expr->keys[i].get());
+      accept(expr->values[i].get());
+    }
+    return Type::Value;
+  }
+
+  Type visitUnaryExpr(Unary *expr) {
+    accept(expr->right.get());
+    return expr->op.type == Token::Type::Minus ? Type::Number : Type::Boolean;
+  }
+
+  Type visitVariableExpr(Variable *expr) {
+    auto global = globals.find(expr->name.text);
+    // never assigned: reading it is an error, or it is `args`
+    return global != globals.end() ? global->second : Type::Value;
+  }
+
+  // The parser does not produce these yet
+
+  Type visitGetExpr(Get *) { lox_fail("not supported yet"); }
+  Type visitSetExpr(Set *) { lox_fail("not supported yet"); }
+  Type visitSuperExpr(Super *) { lox_fail("not supported yet"); }
+  Type visitThisExpr(This *) { lox_fail("not supported yet"); }
+  Type visitBlockStmt(Block *) { lox_fail("not supported yet"); }
+  Type visitClassStmt(Class *) { lox_fail("not supported yet"); }
+  Type visitExpressionStmt(Expression *) { lox_fail("not supported yet"); }
+  Type visitFunctionStmt(Function *) { lox_fail("not supported yet"); }
+  Type visitIfStmt(If *) { lox_fail("not supported yet"); }
+  Type visitPrintStmt(Print *) { lox_fail("not supported yet"); }
+  Type visitReturnStmt(Return *) { lox_fail("not supported yet"); }
+  Type visitVarStmt(Var *) { lox_fail("not supported yet"); }
+  Type visitWhileStmt(While *) { lox_fail("not supported yet"); }
+};
+
+/**
+ * @brief An evaluated expression in the generated code: a C++ expression
+ * without side effects, usually the name of a temporary.
+ */
+struct Operand {
+  std::string code;
+  Type type;
+};
+
+/**
+ * @brief A C++ string literal with the given contents.
+ * @details Everything but printable ASCII is escaped in octal, which (unlike
+ * hexadecimal escapes) cannot run into the following characters.
+ */
+std::string quote(std::string_view text) {
+  std::string out = "\"";
+  for (char c : text) {
+    auto byte = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (byte >= 0x20 && byte < 0x7f) {
+      out += c;
+    } else {
+      out += '\\';
+      out += static_cast<char>('0' + ((byte >> 6) & 7));
+      out += static_cast<char>('0' + ((byte >> 3) & 7));
+      out += static_cast<char>('0' + (byte & 7));
+    }
+  }
+  return out += '"';
+}
+
+std::string numberLiteral(double d) {
+  std::string text;
+  if (std::isnan(d)) {
+    return "std::numeric_limits<double>::quiet_NaN()";
+  }
+  if (std::isinf(d)) {
+    text = "std::numeric_limits<double>::infinity()";
+  } else {
+    std::array<char, 32> buffer{};
+    auto [end, ec] = std::to_chars(buffer.begin(), buffer.end(), std::abs(d));
+    lox_assert(ec == std::errc(), "number fits the buffer");
+    text.assign(buffer.begin(), end);
+    if (text.find_first_of(".e") == std::string::npos) {
+      text += ".0";
+    }
+  }
+  // parenthesized, so that negating it does not give `--`
+  return std::signbit(d) ? std::format("(-{})", text) : text;
+}
+
+struct Transpiler : public StaticVisitor<Transpiler, Operand> {
+  Transpiler(Program &program, interpret::NativeRegistry &natives)
+      : program{program}, natives{natives} {}
+
+  Program &program;
+  interpret::NativeRegistry &natives;
+  std::map<std::string_view, Type> globals;
+  // declarations at the start of the script
+  std::string constants;
+  std::unordered_map<std::string_view, std::string> nativeSlots;
+  std::string body;
+  std::size_t indent = 1;
+  std::size_t temporaries = 0;
+  std::size_t constantCount = 0;
+  bool hadError = false;
+
+  void error(Token source, std::string_view msg) {
+    program.error(msg, source.text);
+    hadError = true;
+  }
+
+  void line(std::string_view code) {
+    body.append(2 * indent, ' ');
+    body += code;
+    body += '\n';
+  }
+
+  std::string location(Token source) {
+    std::string_view text = program.programText();
+    lox_assert(source.text.data() >= text.data() &&
+                   source.text.data() + source.text.size() <=
+                       text.data() + text.size(),
+               "token is a view into the program text");
+    return std::format("Location{{{}, {}}}", source.text.data() - text.data(),
+                       source.text.size());
+  }
+
+  /**
+   * @brief Bind the value of a C++ expression to a new temporary.
+   */
+  Operand temporary(Type type, std::string_view code) {
+    std::string name = std::format("t{}", temporaries++);
+    line(std::format("const {} {} = {};", cppType(type), name, code));
+    return Operand{std::move(name), type};
+  }
+
+  static std::string value(const Operand &op) {
+    return op.type == Type::Value ? op.code : std::format("Value({})", op.code);
+  }
+
+  static std::string truthy(const Operand &op) {
+    switch (op.type) {
+    case Type::Boolean: return op.code;
+    case Type::Number: return "true";
+    default: return std::format("Runtime::truthy({})", op.code);
+    }
+  }
+
+  std::string number(const Operand &op, Token source) {
+    if (op.type == Type::Number) {
+      return op.code;
+    }
+    return std::format("rt.number({}, {})", value(op), location(source));
+  }
+
+  std::string globalName(std::string_view name) {
+    return std::format("g_{}", name);
+  }
+
+  /**
+   * @brief Comma separated values, for the arguments of a runtime call.
+   */
+  static std::string values(const std::vector<Operand> &ops) {
+    std::string out;
+    for (const Operand &op : ops) {
+      out += out.empty() ? "" : ", ";
+      out += value(op);
+    }
+    return out;
+  }
+
+  static std::string array(const std::vector<Operand> &ops) {
+    if (ops.empty()) {
+      return "std::span<const Value>()";
+    }
+    return std::format("std::array<Value, {}>{{{}}}", ops.size(), values(ops));
+  }
+
+  Operand assignGlobal(Token name, Operand value) {
+    Type type = globals.at(name.text);
+    line(std::format("{} = {};", globalName(name.text),
+                     type == Type::Value ? Transpiler::value(value)
+                                         : value.code));
+    return value;
+  }
+
+  Operand visitAssignExpr(Assign *expr) {
+    return assignGlobal(expr->name, accept(expr->value.get()));
+  }
+
+  Operand visitBinaryExpr(Binary *expr) {
+    if (expr->op.type == Token::Type::Eq) {
+      switch (expr->left->type()) {
+      case AstType::VariableExpr:
+        return assignGlobal(static_cast<Variable *>(expr->left.get())->name,
+                            accept(expr->right.get()));
+      case AstType::IndexExpr: {
+        auto *target = static_cast<Index *>(expr->left.get());
+        Operand object = accept(target->object.get());
+        Operand index = accept(target->index.get());
+        Operand right = accept(expr->right.get());
+        line(std::format("rt.setIndex({}, {}, {}, {});", value(object),
+                         value(index), value(right),
+                         location(target->bracket)));
+        return right;
+      }
+      default:
+        error(expr->op, "Invalid assignment target");
+        return Operand{"Value()", Type::Value};
+      }
+    }
+
+    std::vector<Binary *> chain = leftChain(expr);
+    Operand result = accept(chain.front()->left.get());
+    for (Binary *op : chain) {
+      Operand right = accept(op->right.get());
+      result = binaryOp(op->op, result, right);
+    }
+    return result;
+  }
+
+  Operand binaryOp(Token token, const Operand &left, const Operand &right) {
+    Token::Type op = token.type;
+    if (op == Token::Type::Plus) {
+      if (left.type == Type::Number && right.type == Type::Number) {
+        return temporary(Type::Number,
+                         std::format("{} + {}", left.code, right.code));
+      }
+      return temporary(Type::Value,
+                       std::format("rt.add({}, {}, {})", value(left),
+                                   value(right), location(token)));
+    }
+    if (op == Token::Type::EqEq || op == Token::Type::BangEq) {
+      std::string_view cmp = op == Token::Type::EqEq ? "==" : "!=";
+      if (left.type == right.type) {
+        return temporary(Type::Boolean, std::format("{} {} {}", left.code, cmp,
+                                                    right.code));
+      }
+      if (left.type != Type::Value && right.type != Type::Value) {
+        // different types are never equal
+        return Operand{op == Token::Type::EqEq ? "false" : "true",
+                       Type::Boolean};
+      }
+      return temporary(Type::Boolean, std::format("{} {} {}", value(left), cmp,
+                                                  value(right)));
+    }
+
+    std::string_view symbol = token.text;
+    if (isArithmetic(op)) {
+      return temporary(Type::Number,
+                       std::format("{} {} {}", number(left, token), symbol,
+                                   number(right, token)));
+    }
+    lox_assert(isComparison(op), "bad binary operator");
+    return temporary(Type::Boolean,
+                     std::format("{} {} {}", number(left, token), symbol,
+                                 number(right, token)));
+  }
+
+  Operand visitCallExpr(Call *expr) {
+    if (expr->callee->type() != AstType::VariableExpr) {
+      error(expr->paren, "Can only call functions");
+      return Operand{"Value()", Type::Value};
+    }
+    Token name = static_cast<Variable *>(expr->callee.get())->name;
+    if (!natives.at(natives.slot(name.text)).fn) {
+      error(name, "Function is not available in compiled code");
+      return Operand{"Value()", Type::Value};
+    }
+    auto slot = nativeSlots.find(name.text);
+    if (slot == nativeSlots.end()) {
+      std::string var = std::format("n_{}", name.text);
+      constants += std::format("  const std::uint32_t {} = rt.native({});\n",
+                               var, quote(name.text));
+      slot = nativeSlots.emplace(name.text, std::move(var)).first;
+    }
+
+    std::vector<Operand> arguments;
+    arguments.reserve(expr->arguments.size());
+    for (auto &arg : expr->arguments) {
+      arguments.push_back(accept(arg.get()));
+    }
+    return temporary(Type::Value,
+                     std::format("rt.call({}, {}, {})", slot->second,
+                                 array(arguments), location(name)));
+  }
+
+  Operand visitGroupingExpr(Grouping *expr) {
+    return accept(expr->expression.get());
+  }
+
+  Operand visitIndexExpr(Index *expr) {
+    Operand object = accept(expr->object.get());
+    Operand index = accept(expr->index.get());
+    return temporary(Type::Value,
+                     std::format("rt.getIndex({}, {}, {})", value(object),
+                                 value(index), location(expr->bracket)));
+  }
+
+  Operand visitLiteralExpr(Literal *expr) {
+    const loxlang::Value &v = expr->value;
+    switch (v.type()) {
+    case loxlang::Value::Type::Number:
+      return Operand{numberLiteral(v.getNumber()), Type::Number};
+    case loxlang::Value::Type::Boolean:
+      return Operand{v.getBool() ? "true" : "false", Type::Boolean};
+    case loxlang::Value::Type::String: {
+      std::string name = std::format("c{}", constantCount++);
+      constants += std::format("  const Value {} = Value(std::string({}, {}));\n",
+                               name, quote(v.getString()),
+                               v.getString().size());
+      return Operand{std::move(name), Type::Value};
+    }
+    default: return Operand{"Value()", Type::Value};
+    }
+  }
+
+  Operand visitLogicalExpr(Logical *expr) {
+    Operand left = accept(expr->left.get());
+    bool isOr = expr->op.type == Token::Type::Or;
+
+    // the right operand is only evaluated if the left one does not decide
+    std::string outer = std::exchange(body, std::string());
+    ++indent;
+    Operand right = accept(expr->right.get());
+    --indent;
+    std::string inner = std::exchange(body, std::move(outer));
+
+    Type type = left.type == right.type ? left.type : Type::Value;
+    std::string name = std::format("t{}", temporaries++);
+    line(std::format("{} {} = {};", cppType(type), name,
+                     type == left.type ? left.code : value(left)));
+    Operand result = Operand{name, type};
+    std::string test = truthy(result);
+    line(std::format("if ({}) {{",
+                     isOr ? std::format("!({})", test) : test));
+    body += inner;
+    ++indent;
+    line(std::format("{} = {};", name,
+                     type == right.type ? right.code : value(right)));
+    --indent;
+    line("}");
+    return result;
+  }
+
+  Operand visitMapLiteralExpr(MapLiteral *expr) {
+    std::vector<Operand> entries;
+    entries.reserve(2 * expr->keys.size());
+    for (std::size_t i = 0; i < expr->keys.size(); ++i) {
+      entries.push_back(accept(expr->keys[i].get()));
+      entries.push_back(accept(expr->values[i].get()));
+    }
+    return temporary(Type::Value,
+                     std::format("rt.buildMap({}, {})", array(entries),
+                                 location(expr->brace)));
+  }
+
+  Operand visitUnaryExpr(Unary *expr) {
+    Operand right = accept(expr->right.get());
+    switch (expr->op.type) {
+    case Token::Type::Minus:
+      return temporary(Type::Number,
+                       std::format("-{}", number(right, expr->op)));
+    case Token::Type::Bang:
+      return temporary(Type::Boolean, std::format("!({})", truthy(right)));
+    default: lox_fail("bad unary operator");
+    }
+  }
+
+  Operand visitVariableExpr(Variable *expr) {
+    std::string_view name = expr->name.text;
+    auto global = globals.find(name);
+    if (global == globals.end()) {
+      // never assigned
+      line(std::format("rt.error(\"Undefined variable\", {});",
+                       location(expr->name)));
+      return Operand{"Value()", Type::Value};
+    }
+    return temporary(global->second,
+                     std::format("rt.get({}, {})", globalName(name),
+                                 location(expr->name)));
+  }
+
+  // The parser does not produce these yet
+
+  Operand visitGetExpr(Get *) { lox_fail("not supported yet"); }
+  Operand visitSetExpr(Set *) { lox_fail("not supported yet"); }
+  Operand visitSuperExpr(Super *) { lox_fail("not supported yet"); }
+  Operand visitThisExpr(This *) { lox_fail("not supported yet"); }
+  Operand visitBlockStmt(Block *) { lox_fail("not supported yet"); }
+  Operand visitClassStmt(Class *) { lox_fail("not supported yet"); }
+  Operand visitExpressionStmt(Expression *) { lox_fail("not supported yet"); }
+  Operand visitFunctionStmt(Function *) { lox_fail("not supported yet"); }
+  Operand visitIfStmt(If *) { lox_fail("not supported yet"); }
+  Operand visitPrintStmt(Print *) { lox_fail("not supported yet"); }
+  Operand visitReturnStmt(Return *) { lox_fail("not supported yet"); }
+  Operand visitVarStmt(Var *) { lox_fail("not supported yet"); }
+  Operand visitWhileStmt(While *) { lox_fail("not supported yet"); }
+};
+
+} // namespace
+
+std::optional<std::string> transpile::transpile(Program &p, Ast *ast,
+                                                std::string_view filename) {
+  lox_trace_scope("transpile");
+  interpret::NativeRegistry natives;
+  aot::defineNatives(natives, p.output());
+  Transpiler transpiler(p, natives);
+  transpiler.globals = Inference::infer(ast);
+  Operand result = transpiler.accept(ast);
+  if (transpiler.hadError) {
+    return std::nullopt;
+  }
+
+  std::string globals;
+  for (auto [name, type] : transpiler.globals) {
+    globals += std::format("  std::optional<{}> {};\n", cppType(type),
+                           transpiler.globalName(name));
+  }
+
+  std::string out;
+  out += std::format("// Generated by loxc from {}\n", filename);
+  out += "#include \"lib/Runtime.hpp\"\n";
+  out += "#include <array>\n#include <cstdint>\n#include <limits>\n";
+  out += "#include <optional>\n";
+  out += "#include <span>\n#include <string>\n#include <string_view>\n\n";
+  out += "namespace {\n\n";
+  out += "using loxlang::Value;\n";
+  out += "using loxlang::aot::Location;\n";
+  out += "using loxlang::aot::Runtime;\n\n";
+  out += std::format("constexpr std::string_view filename = {};\n",
+                     quote(filename));
+  out += std::format("constexpr std::string_view source = {};\n\n",
+                     quote(p.programText()));
+  out += "Value script(Runtime &rt) {\n";
+  out += transpiler.constants;
+  out += globals;
+  out += std::format("  {} = rt.args();\n", transpiler.globalName("args"));
+  out += transpiler.body;
+  out += std::format("  return {};\n", Transpiler::value(result));
+  out += "}\n\n";
+  out += "} // namespace\n\n";
+  out += "int main(int argc, char const *argv[]) {\n";
+  out += "  return loxlang::aot::main(argc, argv, filename, source, script);\n";
+  out += "}\n";
+  return out;
+}
@@ -0,0 +1,41 @@
+#ifndef LOXLANG_LIB_TRANSPILER_HPP
+#define LOXLANG_LIB_TRANSPILER_HPP
+
+#include "lib/Program.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace loxlang::ast {
+struct Ast;
+} // namespace loxlang::ast
+
+namespace loxlang::transpile {
+
+/**
+ * @brief Translate a syntax tree to a standalone C++ program.
+ * @details The program links against the `lox` library, whose `aot::Runtime`
+ * provides the operations on dynamically typed values, and behaves like
+ * `loxlang <script>`.
+ *
+ * Values whose type is known at compile time are plain `double`s and
+ * `bool`s: literals, the results of arithmetic and comparisons, and global
+ * variables that are only ever assigned numbers (or only booleans). All
+ * others are `Value`s.
+ *
+ * Only the natives of `aot::defineNatives` are available; calls to others,
+ * such as the fiber and I/O natives that need the interpreter's scheduler,
+ * are reported as errors.
+ *
+ * @param p The program the tree was parsed from, used for error reporting and
+ * embedded in the output for the runtime's error reports
+ * @param ast The tree to translate
+ * @param filename The name runtime errors are reported with
+ * @return The C++ source; or `std::nullopt` if an error was reported.
+ */
+std::optional<std::string> transpile(Program &p, ast::Ast *ast,
+                                     std::string_view filename);
+
+} // namespace loxlang::transpile
+
+#endif
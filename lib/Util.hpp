@@ -2,7 +2,9 @@
 #define LOXLANG_LIB_UTIL_HPP
 
 #include <cstddef>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace loxlang::util {
@@ -23,6 +25,18 @@ namespace loxlang::util {
  */
 std::string enumName(std::string_view names, std::size_t n);
 
+/**
+ * @brief Transparent string hash.
+ * @details Allows looking up `std::string` keys of unordered containers with a
+ * `std::string_view`, without constructing a temporary string.
+ */
+struct StringHash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view s) const {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
 } // namespace loxlang::util
 
 #endif
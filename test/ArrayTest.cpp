@@ -0,0 +1,76 @@
+#include "lib/Array.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace loxlang;
+
+TEST(Array, KernelsMatchScalarLoops) {
+  for (std::size_t n : {0, 1, 7, 8, 9, 1001}) {
+    std::vector<double> xs(n);
+    std::vector<double> ys(n);
+    double sum = 0;
+    double dot = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      xs[i] = static_cast<double>(i % 17) - 8;
+      ys[i] = 0.5 * static_cast<double>(i % 5);
+      sum += xs[i];
+      dot += xs[i] * ys[i];
+    }
+    EXPECT_DOUBLE_EQ(kernels::sum(xs), sum);
+    EXPECT_DOUBLE_EQ(kernels::dot(xs, ys), dot);
+
+    std::vector<double> out(n);
+    kernels::scale(xs, 3, out);
+    kernels::map(out, kernels::UnaryOp::Abs, out);
+    for (std::size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(out[i], std::fabs(3 * xs[i]));
+    }
+  }
+}
+
+TEST(Array, SortsNaNsLast) {
+  double nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<double> xs = {3, nan, -1, 2, nan, 0};
+  kernels::sort(xs);
+  EXPECT_EQ((std::vector<double>(xs.begin(), xs.begin() + 4)),
+            (std::vector<double>{-1, 0, 2, 3}));
+  EXPECT_TRUE(std::isnan(xs[4]) && std::isnan(xs[5]));
+}
+
+TEST(Array, BoxesOnlyWhenNeeded) {
+  Array array(std::vector<double>{1, 2});
+  array.push(Value(3.0));
+  ASSERT_TRUE(array.isNumeric());
+  array.set(0, Value(std::string("one")));
+  ASSERT_FALSE(array.isNumeric());
+  ASSERT_EQ(array.get(0), Value(std::string("one")));
+  ASSERT_EQ(array.get(2), Value(3.0));
+}
+
+TEST(Array, IndexingAndBuiltins) {
+  Session session;
+  ASSERT_EQ(session.eval("sum(range(1000001))"), Value(500000500000.0));
+  ASSERT_TRUE(session.eval("a = range(10)").has_value());
+  ASSERT_EQ(session.eval("a[3] = 42"), Value(42.0));
+  ASSERT_EQ(session.eval("a[3] + len(a)"), Value(52.0));
+  ASSERT_EQ(session.eval("dot(a, scale(range(10), 2))"), Value(804.0));
+  ASSERT_EQ(session.eval("sort(map(a, \"neg\"))[0]"), Value(-42.0));
+  ASSERT_EQ(session.eval("a[10]"), std::nullopt);
+  ASSERT_EQ(session.eval("a[0.5]"), std::nullopt);
+  ASSERT_EQ(session.eval("1[0]"), std::nullopt);
+}
+
+TEST(Array, RejectsLengthsOutOfRange) {
+  Session session;
+  ASSERT_EQ(session.eval("array(1/0)"), std::nullopt);
+  ASSERT_EQ(session.eval("array(0/0)"), std::nullopt);
+  ASSERT_TRUE(session.eval("big = 1000000000000000000").has_value());
+  ASSERT_EQ(session.eval("array(big * big * big)"), std::nullopt);
+  ASSERT_EQ(session.eval("range(big * big * big)"), std::nullopt);
+  ASSERT_EQ(session.eval("array(big)"), std::nullopt);
+  ASSERT_EQ(session.eval("len(array(3))"), Value(3.0));
+}
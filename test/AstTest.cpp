@@ -0,0 +1,110 @@
+#include "lib/Ast.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Program.hpp"
+#include "lib/Scanner.hpp"
+#include "gtest/gtest.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace loxlang;
+using namespace loxlang::ast;
+using namespace loxlang::scan;
+
+TEST(Ast, DeepTreesAreWalkedAndDestroyedIteratively) {
+  constexpr std::size_t depth = 1000000;
+  Token minus = Token(Token::Type::Minus, "-");
+  std::unique_ptr<Ast> ast =
+      std::make_unique<Literal>(Token(Token::Type::Number, "1"), Value(1.0));
+  for (std::size_t i = 0; i < depth; ++i) {
+    ast = std::make_unique<Unary>(minus, std::move(ast));
+  }
+
+  std::size_t count = 0;
+  walk(ast.get(), [&count](Ast *) { count++; });
+  ASSERT_EQ(count, depth + 1);
+  ASSERT_EQ(height(ast.get()), depth + 1);
+
+  ast.reset();
+}
+
+namespace {
+
+/**
+ * @brief Names every node after the visit function it was dispatched to.
+ */
+struct NodeNames : public StaticVisitor<NodeNames, std::string> {
+  std::string visitAssignExpr(Assign *) { return "AssignExpr"; }
+  std::string visitBinaryExpr(Binary *) { return "BinaryExpr"; }
+  std::string visitCallExpr(Call *) { return "CallExpr"; }
+  std::string visitGetExpr(Get *) { return "GetExpr"; }
+  std::string visitGroupingExpr(Grouping *) { return "GroupingExpr"; }
+  std::string visitIndexExpr(Index *) { return "IndexExpr"; }
+  std::string visitLiteralExpr(Literal *) { return "LiteralExpr"; }
+  std::string visitLogicalExpr(Logical *) { return "LogicalExpr"; }
+  std::string visitMapLiteralExpr(MapLiteral *) { return "MapLiteralExpr"; }
+  std::string visitSetExpr(Set *) { return "SetExpr"; }
+  std::string visitSuperExpr(Super *) { return "SuperExpr"; }
+  std::string visitThisExpr(This *) { return "ThisExpr"; }
+  std::string visitUnaryExpr(Unary *) { return "UnaryExpr"; }
+  std::string visitVariableExpr(Variable *) { return "VariableExpr"; }
+  std::string visitBlockStmt(Block *) { return "BlockStmt"; }
+  std::string visitClassStmt(Class *) { return "ClassStmt"; }
+  std::string visitExpressionStmt(Expression *) { return "ExpressionStmt"; }
+  std::string visitFunctionStmt(Function *) { return "FunctionStmt"; }
+  std::string visitIfStmt(If *) { return "IfStmt"; }
+  std::string visitPrintStmt(Print *) { return "PrintStmt"; }
+  std::string visitReturnStmt(Return *) { return "ReturnStmt"; }
+  std::string visitVarStmt(Var *) { return "VarStmt"; }
+  std::string visitWhileStmt(While *) { return "WhileStmt"; }
+};
+
+std::unique_ptr<Ast> number() {
+  return std::make_unique<Literal>(Token(Token::Type::Number, "1"),
+                                   Value(1.0));
+}
+
+} // namespace
+
+TEST(Ast, StaticVisitorDispatchesOnTheNodeType) {
+  Token name = Token(Token::Type::Ident, "x");
+  std::vector<std::unique_ptr<Ast>> nodes;
+  nodes.push_back(std::make_unique<Assign>(name, number()));
+  nodes.push_back(std::make_unique<Binary>(number(), name, number()));
+  nodes.push_back(std::make_unique<Call>(number(), name,
+                                         std::vector<std::unique_ptr<Ast>>{}));
+  nodes.push_back(std::make_unique<Get>(number(), name));
+  nodes.push_back(std::make_unique<Grouping>(number()));
+  nodes.push_back(std::make_unique<Index>(number(), name, number()));
+  nodes.push_back(number());
+  nodes.push_back(std::make_unique<Logical>(number(), name, number()));
+  nodes.push_back(std::make_unique<MapLiteral>(
+      name, std::vector<std::unique_ptr<Ast>>{},
+      std::vector<std::unique_ptr<Ast>>{}));
+  nodes.push_back(std::make_unique<Set>(number(), name, number()));
+  nodes.push_back(std::make_unique<Super>(name, name));
+  nodes.push_back(std::make_unique<This>(name));
+  nodes.push_back(std::make_unique<Unary>(name, number()));
+  nodes.push_back(std::make_unique<Variable>(name));
+  nodes.push_back(
+      std::make_unique<Block>(std::vector<std::unique_ptr<Ast>>{}));
+  nodes.push_back(std::make_unique<Class>(
+      name, nullptr, std::vector<std::unique_ptr<Function>>{}));
+  nodes.push_back(std::make_unique<Expression>(number()));
+  nodes.push_back(std::make_unique<Function>(
+      name, std::vector<Token>{}, std::vector<std::unique_ptr<Ast>>{}));
+  nodes.push_back(std::make_unique<If>(number(), number(), nullptr));
+  nodes.push_back(std::make_unique<Print>(number()));
+  nodes.push_back(std::make_unique<Return>(name, nullptr));
+  nodes.push_back(std::make_unique<Var>(name, number()));
+  nodes.push_back(std::make_unique<While>(number(), number()));
+
+  // one node of every type, in the order of `AstType`
+  ASSERT_EQ(nodes.size(), static_cast<std::size_t>(AstType::WhileStmt) + 1);
+  NodeNames names;
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    auto type = static_cast<AstType>(i);
+    ASSERT_EQ(nodes[i]->type(), type);
+    EXPECT_EQ(names.accept(nodes[i].get()), astTypeName(type));
+  }
+}
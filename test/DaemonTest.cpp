@@ -0,0 +1,126 @@
+#include "lib/Daemon.hpp"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace loxlang;
+
+namespace {
+
+/**
+ * @brief A socket path of this test process, so that tests running in
+ * parallel do not share sockets.
+ */
+std::filesystem::path socketPath(std::string_view name) {
+  return std::filesystem::temp_directory_path() /
+         ("loxlang-" + std::string(name) + "-" + std::to_string(getpid()) +
+          ".sock");
+}
+
+} // namespace
+
+TEST(Daemon, ForwardsArgumentsAndOutput) {
+  std::filesystem::path socket = socketPath("daemon");
+  std::vector<std::string> seen;
+  Daemon daemon(socket, [&](std::span<const std::string> args,
+                            const std::array<int, 3> &stdio) {
+    seen.assign(args.begin(), args.end());
+    std::string_view hello = "hello from the daemon";
+    EXPECT_EQ(write(stdio[1], hello.data(), hello.size()), hello.size());
+    return 3;
+  });
+  std::thread server([&] { daemon.serve(); });
+
+  std::array<int, 2> output{};
+  ASSERT_EQ(pipe(output.data()), 0);
+  std::array<std::string_view, 2> args = {"script.lox", "x"};
+  int status = sendRequest(socket, args, {0, output[1], 2});
+  close(output[1]);
+  std::string text(100, '\0');
+  text.resize(static_cast<std::size_t>(read(output[0], text.data(), 100)));
+  close(output[0]);
+
+  daemon.stop();
+  server.join();
+  ASSERT_EQ(status, 3);
+  ASSERT_EQ(seen, (std::vector<std::string>{"script.lox", "x"}));
+  ASSERT_EQ(text, "hello from the daemon");
+}
+
+TEST(Daemon, DropsClientsThatSendNothing) {
+  std::filesystem::path socket = socketPath("silent");
+  Daemon daemon(
+      socket,
+      [](std::span<const std::string>, const std::array<int, 3> &) {
+        return 0;
+      },
+      std::chrono::milliseconds(50));
+  std::thread server([&] { daemon.serve(); });
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::ranges::copy(socket.native(), addr.sun_path);
+  int silent = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_EQ(connect(silent, reinterpret_cast<const sockaddr *>(&addr),
+                    sizeof(addr)),
+            0);
+  std::array<std::string_view, 1> args = {"script.lox"};
+  int status = sendRequest(socket, args);
+  close(silent);
+
+  daemon.stop();
+  server.join();
+  ASSERT_EQ(status, 0);
+}
+
+TEST(Daemon, ServesClientsConcurrently) {
+  std::filesystem::path socket = socketPath("concurrent");
+  std::promise<void> arrived;
+  std::promise<void> released;
+  std::shared_future<void> release = released.get_future().share();
+  Daemon daemon(socket, [&](std::span<const std::string> args,
+                            const std::array<int, 3> &) {
+    if (args[0] == "release") {
+      released.set_value();
+      return 2;
+    }
+    arrived.set_value();
+    // only returns in time if the other client is served meanwhile
+    return release.wait_for(std::chrono::seconds(5)) ==
+                   std::future_status::ready
+               ? 1
+               : 0;
+  });
+  std::thread server([&] { daemon.serve(); });
+
+  int waiting = 0;
+  std::thread first([&] {
+    std::array<std::string_view, 1> args = {"wait"};
+    waiting = sendRequest(socket, args);
+  });
+  arrived.get_future().wait();
+  std::array<std::string_view, 1> args = {"release"};
+  int releasing = sendRequest(socket, args);
+  first.join();
+
+  daemon.stop();
+  server.join();
+  ASSERT_EQ(releasing, 2);
+  ASSERT_EQ(waiting, 1);
+}
+
+TEST(Daemon, ClientFailsWithoutDaemon) {
+  std::filesystem::path socket = socketPath("no-daemon");
+  std::array<std::string_view, 1> args = {"script.lox"};
+  ASSERT_THROW(sendRequest(socket, args), std::system_error);
+}
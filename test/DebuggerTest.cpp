@@ -0,0 +1,58 @@
+#include "lib/Debugger.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <sstream>
+
+using namespace loxlang;
+
+TEST(Debugger, StopsAtBreakpoint) {
+  std::istringstream in("where\nstack\nprint x\ncontinue\n");
+  std::ostringstream out;
+  interpret::Debugger debugger(in, out);
+  Session session;
+  session.attachDebugger(&debugger);
+  // a line holding only a literal
+  debugger.setBreakpoint(2);
+
+  ASSERT_TRUE(session.eval("x = 1"));
+  ASSERT_EQ(out.str(), "");
+  ASSERT_EQ(session.eval("y = 1 +\n2 *\n3"), Value(7.0));
+  ASSERT_EQ(out.str(), "stopped at line 2, Constant\n"
+                       "stopped at line 2, Constant\n"
+                       "stack: 1 2\n"
+                       "x = 1\n");
+}
+
+TEST(Debugger, Steps) {
+  std::istringstream in("step\nstep\nbreak 0\nfoo\ncontinue\n");
+  std::ostringstream out;
+  interpret::Debugger debugger(in, out);
+  Session session;
+  session.attachDebugger(&debugger);
+  debugger.pause();
+
+  ASSERT_EQ(session.eval("1 +\n2"), Value(3.0));
+  ASSERT_EQ(out.str(), "stopped at line 0, Constant\n"
+                       "stopped at line 1, Constant\n"
+                       "stopped at line 0, Add\n"
+                       "breakpoint at line 0\n"
+                       "unknown command foo\n");
+}
+
+TEST(Debugger, DetachRestoresCode) {
+  std::istringstream in;
+  std::ostringstream out;
+  interpret::Debugger debugger(in, out);
+  Session session;
+  session.attachDebugger(&debugger);
+  Session::Script *script = session.compile("1 + 2");
+  ASSERT_NE(script, nullptr);
+
+  debugger.setBreakpoint(0);
+  ASSERT_EQ(script->chunk.code[0].op, compile::OpCode::Breakpoint);
+  session.attachDebugger(nullptr);
+  ASSERT_EQ(script->chunk.code[0].op, compile::OpCode::Constant);
+  ASSERT_EQ(session.run(*script), Value(3.0));
+  ASSERT_EQ(out.str(), "");
+}
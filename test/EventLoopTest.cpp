@@ -0,0 +1,71 @@
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <fcntl.h>
+#include <span>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace loxlang;
+
+namespace {
+
+struct SocketPair {
+  SocketPair() { socketpair(AF_UNIX, SOCK_STREAM, 0, fds); }
+  SocketPair(const SocketPair &) = delete;
+  SocketPair &operator=(const SocketPair &) = delete;
+  ~SocketPair() {
+    close(fds[0]);
+    close(fds[1]);
+  }
+  int fds[2] = {-1, -1};
+};
+
+} // namespace
+
+TEST(EventLoop, ReadSuspendsOnlyTheReadingFiber) {
+  SocketPair pair;
+  Session session;
+  session.defineIoNatives();
+  session.defineNative("seq", 2,
+                       [](std::span<const Value> args) { return args[1]; });
+  session.setGlobal("a", Value(static_cast<double>(pair.fds[0])));
+  session.setGlobal("b", Value(static_cast<double>(pair.fds[1])));
+  session.setGlobal("message", Value(std::string("hi")));
+
+  auto result = session.eval(R"LOX(seq(
+      reader = spawn("received = read(a)"),
+      seq(join(spawn("write(b, message)")), join(reader))))LOX");
+  ASSERT_NE(result, std::nullopt);
+  ASSERT_EQ(*session.global("received"), Value(std::string("hi")));
+}
+
+TEST(EventLoop, WaitsForOtherThreads) {
+  SocketPair pair;
+  Session session;
+  session.defineIoNatives();
+  session.setGlobal("a", Value(static_cast<double>(pair.fds[0])));
+
+  std::thread writer = std::thread([&pair] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    write(pair.fds[1], "late", 4);
+  });
+  auto result = session.eval("read(a)");
+  writer.join();
+  ASSERT_EQ(result, Value(std::string("late")));
+}
+
+TEST(EventLoop, InheritedDescriptorsStayBlocking) {
+  SocketPair pair;
+  Session session;
+  session.defineIoNatives();
+  session.setGlobal("a", Value(static_cast<double>(pair.fds[0])));
+  session.setGlobal("b", Value(static_cast<double>(pair.fds[1])));
+
+  ASSERT_EQ(session.eval(R"LOX(write(b, "x"))LOX"), Value(1.0));
+  ASSERT_EQ(session.eval("read(a)"), Value(std::string("x")));
+  ASSERT_EQ(fcntl(pair.fds[0], F_GETFL) & O_NONBLOCK, 0);
+  ASSERT_EQ(fcntl(pair.fds[1], F_GETFL) & O_NONBLOCK, 0);
+}
@@ -0,0 +1,116 @@
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace loxlang;
+
+namespace {
+
+/**
+ * Lox has no statements yet, so tests sequence side effects through the
+ * (left-to-right evaluated) arguments of `seq`.
+ */
+void defineTestNatives(Session &session, std::vector<double> &log) {
+  session.defineNative("log", 1, [&log](std::span<const Value> args) {
+    log.push_back(args[0].getNumber());
+    return Value();
+  });
+  session.defineNative("seq", 3,
+                       [](std::span<const Value> args) { return args[2]; });
+}
+
+} // namespace
+
+TEST(Fiber, YieldInterleavesFibers) {
+  Session session;
+  std::vector<double> log;
+  defineTestNatives(session, log);
+  auto result = session.eval(R"LOX(seq(
+      spawn("seq(log(1), yield(), log(3))"),
+      spawn("seq(log(2), yield(), log(4))"),
+      0))LOX");
+  ASSERT_EQ(result, Value(0.0));
+  ASSERT_EQ(log, (std::vector<double>{1, 2, 3, 4}));
+}
+
+TEST(Fiber, JoinWaitsForResult) {
+  Session session;
+  ASSERT_EQ(session.eval(R"LOX(join(spawn("yield() == nil")))LOX"),
+            Value(true));
+  ASSERT_EQ(session.eval(R"LOX(join(spawn("40 + 2")) + 1)LOX"), Value(43.0));
+  ASSERT_EQ(session.eval("join(0)"), std::nullopt);
+}
+
+TEST(Fiber, ManyFibers) {
+  constexpr std::size_t count = 1000;
+  Session session;
+  std::vector<double> log;
+  defineTestNatives(session, log);
+  session.defineNative("all", count,
+                       [](std::span<const Value>) { return Value(); });
+
+  std::string spawns = "all(";
+  for (std::size_t i = 0; i < count; ++i) {
+    spawns += i == 0 ? "" : ", ";
+    spawns += R"LOX(spawn("seq(yield(), yield(), log(1))"))LOX";
+  }
+  spawns += ")";
+  ASSERT_EQ(session.eval(spawns), Value());
+  ASSERT_EQ(log.size(), count);
+}
+
+TEST(Fiber, InstructionBudgetAbortsRun) {
+  Session session;
+  // Constant, Constant, Add, Constant, Add, Return
+  session.setRunLimits({.instructions = 6});
+  ASSERT_EQ(session.eval("1 + 2 + 3"), Value(6.0));
+  ASSERT_EQ(session.eval("1 + 2 + 3 + 4"), std::nullopt);
+  // the budget is per run
+  ASSERT_EQ(session.eval("1 + 2"), Value(3.0));
+
+  // runs out on the constant 4, and on the implicit return
+  session.setRunLimits({.instructions = 5});
+  ASSERT_EQ(session.eval("1 + 2 + 3 + 4"), std::nullopt);
+  session.setRunLimits({.instructions = 3});
+  ASSERT_EQ(session.eval("1 + 2"), std::nullopt);
+}
+
+TEST(Fiber, BudgetFailsAllFibersOfRun) {
+  Session session;
+  session.setRunLimits({.instructions = 1000});
+  // Every fiber waits for the next one, without end.
+  session.eval(R"LOX(forever = "join(spawn(forever))")LOX");
+  ASSERT_EQ(session.eval("join(spawn(forever))"), std::nullopt);
+  ASSERT_EQ(session.eval("40 + 2"), Value(42.0));
+}
+
+TEST(Fiber, TimeLimitAbortsRun) {
+  Session session;
+  session.setRunLimits({.time = std::chrono::milliseconds(20)});
+  session.eval(R"LOX(forever = "join(spawn(forever))")LOX");
+  ASSERT_EQ(session.eval("join(spawn(forever))"), std::nullopt);
+}
+
+TEST(Fiber, TimeSlicePreemptsFibers) {
+  Session session;
+  std::vector<double> log;
+  defineTestNatives(session, log);
+  std::string_view code = R"LOX(seq(
+      spawn("seq(log(1), log(3), log(5))"),
+      spawn("seq(log(2), log(4), log(6))"),
+      0))LOX";
+  ASSERT_EQ(session.eval(code), Value(0.0));
+  ASSERT_EQ(log, (std::vector<double>{1, 3, 5, 2, 4, 6}));
+
+  // Constant, Call: the main fiber is preempted after each spawn, and the
+  // others after each log.
+  session.setRunLimits({.timeSlice = 2});
+  log.clear();
+  ASSERT_EQ(session.eval(code), Value(0.0));
+  ASSERT_EQ(log, (std::vector<double>{1, 3, 2, 5, 4, 6}));
+}
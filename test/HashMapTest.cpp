@@ -0,0 +1,63 @@
+#include "lib/HashMap.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace loxlang;
+
+TEST(HashMap, BehavesLikeUnorderedMap) {
+  util::OpenHashMap<int, int> map;
+  std::unordered_map<int, int> reference;
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> keys(0, 500);
+  for (int i = 0; i < 20000; ++i) {
+    int key = keys(random);
+    if (random() % 3 == 0) {
+      ASSERT_EQ(map.erase(key), reference.erase(key) == 1);
+    } else {
+      map.insertOrAssign(key, i);
+      reference.insert_or_assign(key, i);
+    }
+    ASSERT_EQ(map.size(), reference.size());
+  }
+  for (int key = 0; key <= 500; ++key) {
+    const int *value = map.find(key);
+    auto expected = reference.find(key);
+    ASSERT_EQ(value != nullptr, expected != reference.end());
+    if (value != nullptr) {
+      ASSERT_EQ(*value, expected->second);
+    }
+  }
+  std::size_t visited = 0;
+  map.forEach([&visited](int, int) { ++visited; });
+  ASSERT_EQ(visited, reference.size());
+}
+
+TEST(HashMap, TransparentLookup) {
+  util::OpenHashMap<std::string, int, util::StringHash, std::equal_to<>> map;
+  map.insertOrAssign(std::string_view("key"), 1);
+  ASSERT_NE(map.find(std::string_view("key")), nullptr);
+  ASSERT_EQ(map.find(std::string_view("other")), nullptr);
+}
+
+TEST(HashMap, LoxMaps) {
+  Session session;
+  ASSERT_TRUE(session.eval(R"LOX(m = {"a": 1, 2: "two", "a": 3})LOX"));
+  ASSERT_EQ(session.eval("len(m)"), Value(2.0));
+  ASSERT_EQ(session.eval(R"LOX(m["a"] + m[1 + 1 - 0 * 1] + "")LOX"),
+            std::nullopt);
+  ASSERT_EQ(session.eval(R"LOX(m["a"])LOX"), Value(3.0));
+  ASSERT_EQ(session.eval("m[2]"), Value(std::string("two")));
+  ASSERT_EQ(session.eval(R"LOX(m["missing"])LOX"), Value());
+  ASSERT_EQ(session.eval(R"LOX(m["b"] = 4)LOX"), Value(4.0));
+  ASSERT_EQ(session.eval(R"LOX(has(m, "b"))LOX"), Value(true));
+  ASSERT_EQ(session.eval(R"LOX(remove(m, "b"))LOX"), Value(true));
+  ASSERT_EQ(session.eval(R"LOX(has(m, "b"))LOX"), Value(false));
+  ASSERT_EQ(session.eval("len(keys(m))"), Value(2.0));
+  ASSERT_EQ(session.eval("m[nil]"), std::nullopt);
+  ASSERT_EQ(session.eval("len({})"), Value(0.0));
+}
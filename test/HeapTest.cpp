@@ -0,0 +1,93 @@
+#include "lib/Array.hpp"
+#include "lib/Heap.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+
+using namespace loxlang;
+
+TEST(Heap, CountsLiveBytesByKind) {
+  Session session;
+  ASSERT_EQ(session.heapStats().totalBytes, 0);
+
+  ASSERT_TRUE(session.eval(R"LOX(a = range(1000))LOX"));
+  ASSERT_TRUE(session.eval(R"LOX(m = {"x": 1, "y": 2})LOX"));
+  HeapStats stats = session.heapStats();
+  ASSERT_GE(stats.live(HeapKind::Array), 1000 * sizeof(double));
+  ASSERT_GT(stats.live(HeapKind::Map), 0);
+  ASSERT_EQ(stats.totalBytes, stats.live(HeapKind::String) +
+                                  stats.live(HeapKind::Array) +
+                                  stats.live(HeapKind::Map));
+
+  session.clearGlobals();
+  stats = session.heapStats();
+  ASSERT_EQ(stats.live(HeapKind::Array), 0);
+  ASSERT_EQ(stats.live(HeapKind::Map), 0);
+  ASSERT_GE(stats.peakBytes, 1000 * sizeof(double));
+}
+
+TEST(Heap, HardLimitFailsTheScriptOnly) {
+  Session session;
+  session.setHeapLimits(HeapLimits{.hard = 64 * 1024, .soft = 16 * 1024});
+  ASSERT_EQ(session.eval("a = array(100000)"), std::nullopt);
+  ASSERT_TRUE(session.eval(
+      R"LOX(s = "0123456789012345678901234567890123456789012345678901234567")LOX"));
+  int doublings = 0;
+  // using the string as a key flattens it into one buffer
+  while (session.eval("{s + s: 0}") && doublings < 20) {
+    ASSERT_TRUE(session.eval("s = s + s"));
+    ++doublings;
+  }
+  ASSERT_LT(doublings, 20);
+  session.clearGlobals();
+
+  HeapStats stats = session.heapStats();
+  ASSERT_EQ(stats.totalBytes, 0);
+  ASSERT_LE(stats.peakBytes, 64 * 1024);
+  ASSERT_EQ(stats.limitErrors, 2);
+  ASSERT_GE(stats.softLimitCrossings, 1);
+
+  ASSERT_EQ(session.eval("len(range(100))"), Value(100.0));
+}
+
+TEST(Heap, ArrayResultsAreChargedBeforeTheyAreAllocated) {
+  Session session;
+  session.setHeapLimits(HeapLimits{.hard = 64 * 1024, .soft = 64 * 1024});
+  ASSERT_TRUE(session.eval("a = range(5000)"));
+  ASSERT_EQ(session.eval("scale(a, 2)"), std::nullopt);
+  ASSERT_EQ(session.eval("map(a, \"sqrt\")"), std::nullopt);
+
+  HeapStats stats = session.heapStats();
+  ASSERT_EQ(stats.limitErrors, 2);
+  ASSERT_LE(stats.peakBytes, 64 * 1024);
+  ASSERT_EQ(session.eval("len(scale(range(100), 2))"), Value(100.0));
+}
+
+TEST(Heap, LimitErrorsFailOnlyTheAllocatingFiber) {
+  Session session;
+  session.defineIoNatives();
+  session.setHeapLimits(HeapLimits{.hard = 64 * 1024, .soft = 64 * 1024});
+  ASSERT_TRUE(session.eval(
+      R"LOX(s = "0123456789012345678901234567890123456789012345678901234567")LOX"));
+  for (int i = 0; i < 11; ++i) {
+    ASSERT_TRUE(session.eval("s = s + s"));
+  }
+  // flattening the rope needs more than the limit allows
+  ASSERT_EQ(session.eval(R"LOX(join(spawn("{s: 0}")) == nil)LOX"),
+            Value(true));
+  ASSERT_EQ(session.eval(R"LOX(join(spawn("len(range(100000))")))LOX"),
+            Value());
+  ASSERT_EQ(session.heapStats().limitErrors, 2);
+  ASSERT_EQ(session.eval(R"LOX(join(spawn("len(range(100))")))LOX"),
+            Value(100.0));
+}
+
+TEST(Heap, ValuesOutliveTheSession) {
+  std::optional<Value> result;
+  {
+    Session session;
+    result = session.eval("range(10)");
+  }
+  ASSERT_TRUE(result);
+  ASSERT_EQ(result->getArray()->size(), 10);
+}
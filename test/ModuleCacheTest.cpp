@@ -0,0 +1,105 @@
+#include "lib/ModuleCache.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+using namespace loxlang;
+
+namespace {
+
+std::filesystem::path writeScript(const char *name, std::string_view text) {
+  std::filesystem::path file = std::filesystem::temp_directory_path() / name;
+  std::ofstream(file) << text;
+  return file;
+}
+
+} // namespace
+
+TEST(ModuleCache, ReusesCompiledScripts) {
+  std::filesystem::path file = writeScript("loxlang-module-a.lox", "1 + 2");
+  Session session;
+  ModuleCache cache(4);
+
+  Session::Script *first = cache.get(session, file);
+  ASSERT_NE(first, nullptr);
+  ASSERT_EQ(cache.get(session, file), first);
+  ASSERT_EQ(cache.hits(), 1);
+  ASSERT_EQ(cache.misses(), 1);
+
+  // touched, but the same content
+  std::filesystem::last_write_time(
+      file, std::filesystem::last_write_time(file) + std::chrono::seconds(1));
+  ASSERT_EQ(cache.get(session, file), first);
+  ASSERT_EQ(cache.hits(), 2);
+
+  std::ofstream(file) << "3 + 4";
+  std::filesystem::last_write_time(
+      file, std::filesystem::last_write_time(file) + std::chrono::seconds(2));
+  Session::Script *changed = cache.get(session, file);
+  ASSERT_NE(changed, nullptr);
+  ASSERT_EQ(session.run(*changed), Value(7.0));
+  ASSERT_EQ(cache.misses(), 2);
+  ASSERT_EQ(cache.size(), 1);
+}
+
+TEST(ModuleCache, DropsLeastRecentlyUsed) {
+  std::filesystem::path a = writeScript("loxlang-module-a.lox", "1");
+  std::filesystem::path b = writeScript("loxlang-module-b.lox", "2");
+  std::filesystem::path c = writeScript("loxlang-module-c.lox", "3");
+  Session session;
+  ModuleCache cache(2);
+
+  ASSERT_NE(cache.get(session, a), nullptr);
+  ASSERT_NE(cache.get(session, b), nullptr);
+  ASSERT_NE(cache.get(session, a), nullptr);
+  ASSERT_NE(cache.get(session, c), nullptr);
+  ASSERT_EQ(cache.size(), 2);
+  ASSERT_EQ(cache.misses(), 3);
+
+  ASSERT_NE(cache.get(session, a), nullptr);
+  ASSERT_EQ(cache.misses(), 3);
+  Session::Script *again = cache.get(session, b);
+  ASSERT_NE(again, nullptr);
+  ASSERT_EQ(cache.misses(), 4);
+  ASSERT_EQ(session.run(*again), Value(2.0));
+}
+
+TEST(ModuleCache, ReportsMissingFiles) {
+  Session session;
+  ModuleCache cache(2);
+  ASSERT_EQ(cache.get(session, "/nonexistent/loxlang-module.lox"), nullptr);
+  ASSERT_EQ(cache.size(), 0);
+}
+
+TEST(ModuleCache, SharesScriptsBetweenSessions) {
+  std::filesystem::path file =
+      writeScript("loxlang-module-shared.lox", "twice(20) + 2");
+  auto twice = [](double x) { return 2 * x; };
+  ModuleCache cache(2);
+
+  Session first;
+  first.bindNative("other", [](double x) { return x; });
+  first.bindNative("twice", twice);
+  Session::Script *compiled = cache.get(first, file);
+  ASSERT_NE(compiled, nullptr);
+  ASSERT_EQ(first.run(*compiled), Value(42.0));
+
+  // the native is in a different slot here
+  Session second;
+  second.bindNative("twice", twice);
+  Session::Script *copied = cache.get(second, file);
+  ASSERT_NE(copied, nullptr);
+  ASSERT_EQ(cache.hits(), 1);
+  ASSERT_EQ(cache.misses(), 1);
+  ASSERT_EQ(second.run(*copied), Value(42.0));
+
+  // without the native, the copy fails at run time, like a compiled script
+  Session third;
+  Session::Script *unbound = cache.get(third, file);
+  ASSERT_NE(unbound, nullptr);
+  ASSERT_EQ(third.run(*unbound), std::nullopt);
+}
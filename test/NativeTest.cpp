@@ -0,0 +1,41 @@
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace loxlang;
+
+TEST(Native, TypedBindings) {
+  Session session;
+  session.bindNative("repeat", [](const std::string &s, double n) {
+    std::string result;
+    for (int i = 0; i < static_cast<int>(n); ++i) {
+      result += s;
+    }
+    return result;
+  });
+  int calls = 0;
+  session.bindNative("count", [&calls]() { calls++; });
+  session.bindNative("isNil", [](const Value &v) {
+    return v.type() == Value::Type::Nil;
+  });
+
+  ASSERT_EQ(session.eval(R"LOX(repeat("ab", 3))LOX"),
+            Value(std::string("ababab")));
+  ASSERT_EQ(session.eval("count()"), Value());
+  ASSERT_EQ(calls, 1);
+  ASSERT_EQ(session.eval("isNil(nil)"), Value(true));
+
+  // wrong argument types and counts are runtime errors
+  ASSERT_EQ(session.eval(R"LOX(repeat(3, "ab"))LOX"), std::nullopt);
+  ASSERT_EQ(session.eval(R"LOX(repeat("ab"))LOX"), std::nullopt);
+}
+
+TEST(Native, LateDefinition) {
+  Session session;
+  Session::Script *script = session.compile("later(1)");
+  ASSERT_NE(script, nullptr);
+  ASSERT_EQ(session.run(*script), std::nullopt);
+  session.bindNative("later", [](double d) { return d + 1; });
+  ASSERT_EQ(session.run(*script), Value(2.0));
+}
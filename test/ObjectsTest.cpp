@@ -0,0 +1,36 @@
+#include "lib/Objects.hpp"
+#include "gtest/gtest.h"
+#include <string>
+
+using namespace loxlang;
+
+TEST(LoxString, ConcatenatesLazily) {
+  std::string expected;
+  LoxString rope;
+  for (int i = 0; i < 1000; ++i) {
+    std::string piece = "piece " + std::to_string(i) + ";";
+    expected += piece;
+    rope = LoxString::concat(rope, LoxString(piece));
+  }
+  LoxString copy = rope;
+  ASSERT_EQ(rope.size(), expected.size());
+  ASSERT_EQ(rope.str(), expected);
+  ASSERT_EQ(copy.str(), expected);
+  ASSERT_EQ(Value(rope), Value(expected));
+  ASSERT_NE(Value(rope), Value(std::string("piece")));
+}
+
+TEST(LoxString, LongChainsDoNotOverflowTheStack) {
+  LoxString rope(std::string(100, 'x'));
+  for (int i = 0; i < 1000000; ++i) {
+    rope = LoxString::concat(rope, LoxString("y"));
+  }
+  ASSERT_EQ(rope.size(), 1000100);
+  ASSERT_EQ(rope.str().back(), 'y');
+
+  LoxString unflattened(std::string(100, 'x'));
+  for (int i = 0; i < 1000000; ++i) {
+    unflattened = LoxString::concat(LoxString("y"), unflattened);
+  }
+  ASSERT_EQ(unflattened.size(), 1000100);
+}
@@ -0,0 +1,171 @@
+#include "lib/Output.hpp"
+#include "lib/Array.hpp"
+#include "lib/Map.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <array>
+#include <chrono>
+#include <fcntl.h>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace loxlang;
+
+namespace {
+
+class Pipe {
+public:
+  Pipe() {
+    EXPECT_EQ(pipe2(fds.data(), O_NONBLOCK), 0);
+  }
+  Pipe(const Pipe &) = delete;
+  Pipe &operator=(const Pipe &) = delete;
+  ~Pipe() {
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  int writeEnd() const { return fds[1]; }
+
+  std::string read() {
+    std::string text(1 << 16, '\0');
+    ssize_t n = ::read(fds[0], text.data(), text.size());
+    text.resize(n < 0 ? 0 : static_cast<std::size_t>(n));
+    return text;
+  }
+
+private:
+  std::array<int, 2> fds{};
+};
+
+} // namespace
+
+TEST(Output, LinePolicyWritesCompleteLines) {
+  Pipe pipe;
+  Output out(pipe.writeEnd(), FlushPolicy::Line);
+  out.print("a{}", 1);
+  ASSERT_EQ(pipe.read(), "");
+  out.print("b\nc");
+  ASSERT_EQ(pipe.read(), "a1b\n");
+  out.flush();
+  ASSERT_EQ(pipe.read(), "c");
+}
+
+TEST(Output, FullPolicyWritesWhenFull) {
+  Pipe pipe;
+  Output out(pipe.writeEnd(), FlushPolicy::Full, 16);
+  out.println("0123456789");
+  ASSERT_EQ(pipe.read(), "");
+  out.write("abcdefgh");
+  // only complete lines
+  ASSERT_EQ(pipe.read(), "0123456789\n");
+  out.flushAfterRun();
+  ASSERT_EQ(pipe.read(), "abcdefgh");
+}
+
+TEST(Output, ExitPolicyKeepsOutputAfterRuns) {
+  Pipe pipe;
+  {
+    Output out(pipe.writeEnd(), FlushPolicy::Exit);
+    out.println("done");
+    out.flushAfterRun();
+    ASSERT_EQ(pipe.read(), "");
+  }
+  ASSERT_EQ(pipe.read(), "done\n");
+}
+
+TEST(Output, FormatsValues) {
+  auto map = std::make_shared<Map>();
+  map->set(Value(1.0), Value(std::string("one")));
+  std::vector<Value> elements = {Value(0.5), Value(1e21), Value(nullptr),
+                                 Value(true), Value(map)};
+  Value array = std::make_shared<Array>(std::move(elements));
+
+  std::string text;
+  format(text, array);
+  ASSERT_EQ(text, R"([0.5, 1e+21, nil, true, {1: "one"}])");
+  std::ostringstream stream;
+  stream << array;
+  ASSERT_EQ(stream.str(), text);
+
+  Pipe pipe;
+  Output out(pipe.writeEnd(), FlushPolicy::Full);
+  out.printValue(Value(std::string("raw")));
+  out.printValue(Value(42.0));
+  out.flush();
+  ASSERT_EQ(pipe.read(), "raw42");
+}
+
+TEST(Output, LinePolicyDrainsLongLines) {
+  Pipe pipe;
+  Output out(pipe.writeEnd(), FlushPolicy::Line, 16);
+  out.write("0123456789");
+  ASSERT_EQ(pipe.read(), "");
+  out.write("0123456789");
+  ASSERT_EQ(pipe.read(), "01234567890123456789");
+}
+
+TEST(Output, WaitsForFullNonBlockingPipe) {
+  // much more than a pipe holds
+  constexpr std::size_t lines = 100000;
+  const std::string line = "0123456789abcdef\n";
+  Pipe pipe;
+  std::string received;
+  std::thread reader([&] {
+    while (received.size() < lines * line.size()) {
+      std::string part = pipe.read();
+      if (part.empty()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      received += part;
+    }
+  });
+  {
+    Output out(pipe.writeEnd(), FlushPolicy::Full, 4096);
+    for (std::size_t i = 0; i < lines; ++i) {
+      out.write(line);
+    }
+  }
+  reader.join();
+  ASSERT_EQ(received.size(), lines * line.size());
+  ASSERT_EQ(received.substr(received.size() - line.size()), line);
+}
+
+TEST(Output, FullOutputSuspendsOnlyThePrintingFiber) {
+  Pipe pipe;
+  Session session({STDIN_FILENO, pipe.writeEnd(), STDERR_FILENO});
+  std::vector<double> log;
+  session.bindNative("log", [&log](double n) { log.push_back(n); });
+  session.defineNative("seq", 3,
+                       [](std::span<const Value> args) { return args[2]; });
+  // more than the pipe and the output's buffer hold
+  const std::string big(2 * Output::defaultCapacity, 'x');
+  session.setGlobal("big", Value(std::string(big)));
+
+  std::size_t expected = 2 * (big.size() + 1);
+  std::size_t received = 0;
+  std::thread reader([&] {
+    while (received < expected) {
+      std::string part = pipe.read();
+      if (part.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      received += part.size();
+    }
+  });
+  auto result = session.eval(R"LOX(seq(
+      spawn("seq(println(big), println(big), log(1))"),
+      spawn("log(2)"),
+      0))LOX");
+  reader.join();
+  ASSERT_EQ(result, Value(0.0));
+  ASSERT_EQ(received, expected);
+  // the second fiber ran while the first one waited for the pipe
+  ASSERT_EQ(log, (std::vector<double>{2, 1}));
+}
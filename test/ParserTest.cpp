@@ -3,6 +3,7 @@
 #include "lib/Program.hpp"
 #include "lib/Scanner.hpp"
 #include "gtest/gtest.h"
+#include <string>
 #include <string_view>
 
 using namespace loxlang;
@@ -15,4 +16,66 @@ TEST(Parser, SimpleExpressions) {
   auto ast = parse::parse(p, s);
   std::string asString = ast->stringify();
   ASSERT_EQ(asString, "(+ (grouping (- 5 (grouping (- 3 1)))) (- 1))");
-}
\ No newline at end of file
+}
+TEST(Parser, NestingLimit) {
+  std::string text = std::string(100, '(') + "1" + std::string(100, ')');
+  Program p = Program("ParserTest", text);
+  Scanner s = Scanner(p);
+  auto ast = parse::parse(p, s, 50);
+  ASSERT_EQ(ast, nullptr);
+  ASSERT_TRUE(p.hadError());
+
+  // right operands and unary operators recurse, too
+  for (std::string_view op : {"a = ", "-", "a[0]["}) {
+    std::string nested;
+    for (int i = 0; i < 100; ++i) {
+      nested += op;
+    }
+    nested += "1";
+    Program q = Program("ParserTest", nested);
+    Scanner t = Scanner(q);
+    ASSERT_EQ(parse::parse(q, t, 50), nullptr);
+  }
+}
+
+TEST(Parser, DeepProgramsDoNotCrash) {
+  std::string text = "1";
+  for (int i = 0; i < 100000; ++i) {
+    text += "\n+ 1";
+  }
+  Program p = Program("ParserTest", text);
+  Scanner s = Scanner(p);
+  auto ast = parse::parse(p, s);
+  ASSERT_NE(ast, nullptr);
+  ASSERT_FALSE(p.hadError());
+  std::string asString = ast->stringify();
+  ASSERT_TRUE(asString.starts_with("(+ (+ (+ "));
+  ASSERT_TRUE(asString.ends_with(" 1) 1) 1)"));
+}
+
+TEST(Parser, PipelinedMatchesDirect) {
+  std::string text = "f(0";
+  for (int i = 1; i < 20000; ++i) {
+    text += ", " + std::to_string(i) + " * (x - " + std::to_string(i) + ")";
+  }
+  text += ")";
+  Program direct = Program("ParserTest", text);
+  Scanner directScanner = Scanner(direct);
+  auto expected = parse::parse(direct, directScanner);
+  ASSERT_NE(expected, nullptr);
+
+  Program pipelined = Program("ParserTest", text);
+  Scanner pipelinedScanner = Scanner(pipelined);
+  auto actual = parse::parsePipelined(pipelined, pipelinedScanner);
+  ASSERT_NE(actual, nullptr);
+  ASSERT_EQ(actual->stringify(), expected->stringify());
+}
+
+TEST(Parser, PipelinedStopsScannerOnError) {
+  std::string text = std::string(100000, '(') + "1";
+  Program p = Program("ParserTest", text);
+  Scanner s = Scanner(p);
+  auto ast = parse::parsePipelined(p, s);
+  ASSERT_EQ(ast, nullptr);
+  ASSERT_TRUE(p.hadError());
+}
@@ -1,6 +1,12 @@
 #include "lib/Scanner.hpp"
 #include "lib/Program.hpp"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 using namespace loxlang::scan;
 using namespace loxlang;
@@ -52,4 +58,78 @@ TEST(Scanner, SimpleTokens) {
   EXPECT_EQ(scanner.next().type, Token::Type::Var);
   EXPECT_EQ(scanner.next().type, Token::Type::While);
   EXPECT_EQ(scanner.next().type, Token::Type::Eof);
-}
\ No newline at end of file
+}
+TEST(Scanner, Streaming) {
+  constexpr std::size_t repetitions = 100000;
+  std::string_view chunk = "foo + 12.5 /* comment */ \"string\" <=\n";
+  std::size_t produced = 0;
+  std::size_t position = 0;
+  ChunkSource source = [&](std::span<char> buffer) -> std::size_t {
+    // hand out small, unaligned pieces to exercise the refilling
+    std::size_t count = 0;
+    while (count < std::min<std::size_t>(buffer.size(), 7) &&
+           produced < repetitions) {
+      buffer[count++] = chunk[position++];
+      if (position == chunk.size()) {
+        position = 0;
+        produced++;
+      }
+    }
+    return count;
+  };
+
+  auto program = Program("stream", "");
+  auto scanner = Scanner(program, source, 64);
+  std::size_t tokens = 0;
+  for (Token t = scanner.next(); t.type != Token::Type::Eof;
+       t = scanner.next()) {
+    ASSERT_NE(t.type, Token::Type::Err);
+    if (tokens % 5 == 4) {
+      ASSERT_EQ(t.text, "<=");
+      ASSERT_EQ(t.offset, (tokens / 5) * chunk.size() + 34);
+    }
+    tokens++;
+  }
+  ASSERT_EQ(tokens, 5 * repetitions);
+  ASSERT_FALSE(program.hadError());
+}
+
+TEST(Scanner, StreamingTokenTooLong) {
+  std::istringstream in = std::istringstream("a \"" + std::string(100, 'x'));
+  auto program = Program("stream", "");
+  auto scanner = Scanner(program, streamSource(in), 32);
+  EXPECT_EQ(scanner.next().type, Token::Type::Ident);
+  scanner.next();
+  EXPECT_TRUE(program.hadError());
+}
+
+TEST(Scanner, StreamingLongComments) {
+  std::istringstream in = std::istringstream(
+      "a // " + std::string(100, 'x') + "\n/* " + std::string(100, 'y') +
+      "\n */ b");
+  auto program = Program("stream", "");
+  auto scanner = Scanner(program, streamSource(in), 32);
+  EXPECT_EQ(scanner.next().text, "a");
+  Token b = scanner.next();
+  EXPECT_EQ(b.text, "b");
+  EXPECT_EQ(b.offset, 214);
+  EXPECT_EQ(scanner.next().type, Token::Type::Eof);
+  EXPECT_FALSE(program.hadError());
+}
+
+TEST(Scanner, InternsIdentifiers) {
+  auto program = Program("test", "foo bar foo whilst fo returns an foo");
+  auto scanner = Scanner(program);
+  std::vector<Token> tokens;
+  for (Token t = scanner.next(); t.type != Token::Type::Eof;
+       t = scanner.next()) {
+    ASSERT_EQ(t.type, Token::Type::Ident) << t.text;
+    tokens.push_back(t);
+  }
+  ASSERT_EQ(tokens.size(), 8);
+  EXPECT_EQ(tokens[0].symbol, tokens[2].symbol);
+  EXPECT_EQ(tokens[0].symbol, tokens[7].symbol);
+  EXPECT_NE(tokens[0].symbol, tokens[1].symbol);
+  EXPECT_EQ(program.symbols().size(), 6);
+  EXPECT_EQ(program.symbols().name(tokens[1].symbol), "bar");
+}
@@ -0,0 +1,72 @@
+#include "lib/Array.hpp"
+#include "lib/Map.hpp"
+#include "lib/Objects.hpp"
+#include "lib/ScriptPool.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace loxlang;
+
+TEST(ScriptPool, RunsAllJobs) {
+  ScriptPool pool = ScriptPool(4, [](Session &s) {
+    s.defineNative("square", 1, [](std::span<const Value> args) {
+      return Value(args[0].getNumber() * args[0].getNumber());
+    });
+  });
+
+  std::vector<Job> jobs;
+  for (int i = 0; i < 1000; ++i) {
+    jobs.push_back(Job{i % 2 == 0 ? "square(input)" : "input + 1",
+                       Value(static_cast<double>(i))});
+  }
+  jobs.push_back(Job{"undefined", Value()});
+
+  for (int round = 0; round < 2; ++round) {
+    BatchReport report = pool.run(jobs);
+    ASSERT_EQ(report.results.size(), jobs.size());
+    for (int i = 0; i < 1000; ++i) {
+      double expected = i % 2 == 0 ? i * i : i + 1;
+      ASSERT_EQ(report.results[i].value, Value(expected));
+    }
+    ASSERT_EQ(report.results.back().value, std::nullopt);
+    ASSERT_LE(report.p50, report.p99);
+    ASSERT_LE(report.p99, report.max);
+    ASSERT_LE(report.max, report.elapsed);
+    for (const JobResult &r : report.results) {
+      ASSERT_LE(r.wait + r.latency, report.elapsed);
+      ASSERT_LE(r.wait, report.maxWait);
+    }
+  }
+}
+
+TEST(ScriptPool, CopiesTheInputForEveryJob) {
+  ScriptPool pool = ScriptPool(4);
+
+  // One input, shared by all jobs: a rope, a map and the array itself
+  auto map = std::make_shared<Map>();
+  map->set(Value(std::string("key")), Value(1.0));
+  std::string half(100, 'x');
+  LoxString rope = LoxString::concat(LoxString(half), LoxString(half));
+  auto array = std::make_shared<Array>(
+      std::vector<Value>{Value(rope), Value(map), Value(2.0)});
+  array->push(Value(array));
+  Value input = Value(array);
+
+  std::vector<Job> jobs;
+  for (int i = 0; i < 200; ++i) {
+    jobs.push_back(Job{i % 2 == 0 ? "len(push(input, 1)) + len(input[1])"
+                                  : "len(push(input[3], 1)) + len(input[1])",
+                       input, "shared"});
+  }
+
+  BatchReport report = pool.run(jobs);
+  for (const JobResult &result : report.results) {
+    ASSERT_EQ(result.value, Value(6.0));
+  }
+  ASSERT_EQ(array->size(), 4);
+  ASSERT_EQ(rope.str(), half + half);
+}
@@ -0,0 +1,74 @@
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <span>
+#include <string>
+
+using namespace loxlang;
+
+TEST(Session, KeepsGlobalsBetweenEvaluations) {
+  Session session;
+  ASSERT_EQ(session.eval("a = 40"), Value(40.0));
+  ASSERT_EQ(session.eval("a + 2"), Value(42.0));
+
+  session.reset();
+  ASSERT_EQ(session.global("a"), nullptr);
+  ASSERT_EQ(session.eval("a"), std::nullopt);
+}
+
+TEST(Session, CallsNatives) {
+  Session session;
+  session.defineNative("twice", 1, [](std::span<const Value> args) {
+    return Value(2 * args[0].getNumber());
+  });
+  session.setGlobal("x", Value(3.0));
+  ASSERT_EQ(session.eval("twice(x) + twice(1)"), Value(8.0));
+  ASSERT_EQ(session.eval("twice(1, 2)"), std::nullopt);
+}
+
+TEST(Session, EvaluatesLongOperatorChains) {
+  Session session;
+  std::string text = "0";
+  for (int i = 0; i < 100000; ++i) {
+    text += " + 1";
+  }
+  ASSERT_EQ(session.eval(text), Value(100000.0));
+}
+
+TEST(Session, CachesScriptsByNameAndSource) {
+  Session session;
+  Session::Script *first = session.compile("1 + 2", "first");
+  ASSERT_NE(first, nullptr);
+  ASSERT_EQ(session.compile("1 + 2", "first"), first);
+  Session::Script *second = session.compile("1 + 2", "second");
+  ASSERT_NE(second, nullptr);
+  ASSERT_NE(second, first);
+  ASSERT_EQ(second->name, "second");
+  ASSERT_EQ(session.cachedScripts(), 2);
+}
+
+TEST(Session, BoundsTheScriptCache) {
+  Session session;
+  session.setCacheCapacity(2);
+  Session::Script *pinned = session.compile("0");
+  ASSERT_NE(pinned, nullptr);
+  session.pin(*pinned);
+  for (int i = 1; i <= 10; ++i) {
+    ASSERT_EQ(session.eval(std::to_string(i)), Value(static_cast<double>(i)));
+  }
+  ASSERT_EQ(session.cachedScripts(), 3);
+  ASSERT_EQ(session.run(*pinned), Value(0.0));
+
+  session.setCacheCapacity(0);
+  ASSERT_EQ(session.cachedScripts(), 1);
+  ASSERT_EQ(session.eval("40 + 2"), Value(42.0));
+  Session::Script *script = session.compile("2 * 21", "other");
+  ASSERT_NE(script, nullptr);
+  ASSERT_EQ(session.run(*script), Value(42.0));
+  ASSERT_EQ(session.cachedScripts(), 2);
+
+  // spawned fibers' scripts are kept while they run
+  ASSERT_EQ(session.eval(R"LOX(join(spawn("1")) + join(spawn("2")) +
+                               join(spawn("3")))LOX"),
+            Value(6.0));
+}
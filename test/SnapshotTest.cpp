@@ -0,0 +1,64 @@
+#include "lib/Array.hpp"
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "lib/Snapshot.hpp"
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace loxlang;
+
+namespace {
+
+std::filesystem::path tempFile(const char *name) {
+  return std::filesystem::temp_directory_path() / name;
+}
+
+} // namespace
+
+TEST(Snapshot, RestoresGlobals) {
+  std::filesystem::path file = tempFile("loxlang-snapshot-test");
+  {
+    Session prelude;
+    ASSERT_TRUE(prelude.eval(R"LOX(greeting = "hello")LOX"));
+    ASSERT_TRUE(prelude.eval("numbers = range(5)"));
+    ASSERT_TRUE(prelude.eval(R"LOX(mixed = push(push(array(0), "a"), nil))LOX"));
+    ASSERT_TRUE(prelude.eval(R"LOX(table = {"numbers": numbers, 1: true})LOX"));
+    ASSERT_TRUE(prelude.eval(R"LOX(table["self"] = table)LOX"));
+    prelude.saveSnapshot(file);
+  }
+
+  Session session;
+  session.loadSnapshot(file);
+  ASSERT_EQ(session.eval("greeting + \" world\""),
+            Value(std::string("hello world")));
+  ASSERT_EQ(session.eval("sum(numbers)"), Value(10.0));
+  ASSERT_EQ(session.eval("mixed[0] + mixed[1]"), std::nullopt);
+  ASSERT_EQ(session.eval("mixed[0]"), Value(std::string("a")));
+  ASSERT_EQ(session.eval("table[1]"), Value(true));
+  // sharing and cycles survive
+  ASSERT_EQ(session.eval(R"LOX(table["numbers"] == numbers)LOX"), Value(true));
+  ASSERT_EQ(session.eval(R"LOX(table["self"]["self"] == table)LOX"),
+            Value(true));
+  std::filesystem::remove(file);
+}
+
+TEST(Snapshot, RejectsMalformedFiles) {
+  std::filesystem::path file = tempFile("loxlang-snapshot-malformed");
+  {
+    Session prelude;
+    ASSERT_TRUE(prelude.eval(R"LOX(a = {"key": range(100)})LOX"));
+    prelude.saveSnapshot(file);
+  }
+  std::filesystem::resize_file(file, std::filesystem::file_size(file) - 1);
+
+  Session session;
+  session.setGlobal("a", Value(1.0));
+  ASSERT_THROW(session.loadSnapshot(file), snapshot::SnapshotError);
+  ASSERT_EQ(*session.global("a"), Value(1.0));
+
+  std::ofstream(file) << "not a snapshot";
+  ASSERT_THROW(session.loadSnapshot(file), snapshot::SnapshotError);
+  std::filesystem::remove(file);
+  ASSERT_THROW(session.loadSnapshot(file), snapshot::SnapshotError);
+}
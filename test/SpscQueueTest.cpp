@@ -0,0 +1,41 @@
+#include "lib/SpscQueue.hpp"
+#include "gtest/gtest.h"
+#include <cstddef>
+#include <thread>
+
+using namespace loxlang::util;
+
+TEST(SpscQueue, BoundedCapacity) {
+  SpscQueue<int> queue(3);
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.tryPush(i));
+  }
+  int value = 4;
+  ASSERT_FALSE(queue.tryPush(value));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(queue.tryPop(value));
+    ASSERT_EQ(value, i);
+  }
+  ASSERT_FALSE(queue.tryPop(value));
+}
+
+TEST(SpscQueue, KeepsOrderAcrossThreads) {
+  constexpr std::size_t count = 100000;
+  SpscQueue<std::size_t> queue(8);
+  std::thread producer([&queue] {
+    for (std::size_t i = 0; i < count; ++i) {
+      std::size_t value = i;
+      while (!queue.tryPush(value)) {
+        queue.waitForSpace();
+      }
+    }
+  });
+  for (std::size_t i = 0; i < count; ++i) {
+    std::size_t value = 0;
+    while (!queue.tryPop(value)) {
+      queue.waitForData();
+    }
+    ASSERT_EQ(value, i);
+  }
+  producer.join();
+}
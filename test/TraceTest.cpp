@@ -0,0 +1,38 @@
+#include "lib/Objects.hpp"
+#include "lib/Session.hpp"
+#include "lib/Trace.hpp"
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+using namespace loxlang;
+
+TEST(Trace, RecordsPhasesAndCalls) {
+  if (!trace::traceCompiledIn) {
+    GTEST_SKIP();
+  }
+  std::filesystem::path file =
+      std::filesystem::temp_directory_path() / "loxlang-trace-test";
+  Session session;
+  ASSERT_TRUE(trace::start(file));
+  ASSERT_FALSE(trace::start(file));
+  ASSERT_EQ(session.eval("sum(range(10))"), Value(45.0));
+  trace::stop();
+  // not recorded
+  ASSERT_EQ(session.eval("len(range(10))"), Value(10.0));
+
+  std::ostringstream json;
+  ASSERT_TRUE(trace::toChromeJson(file, json));
+  std::string text = json.str();
+  for (const char *name : {"parse", "compile", "run", "fiber", "range", "sum"}) {
+    ASSERT_NE(text.find("\"name\":\"" + std::string(name) + "\",\"ph\":\"B\""),
+              std::string::npos)
+        << name;
+    ASSERT_NE(text.find("\"name\":\"" + std::string(name) + "\",\"ph\":\"E\""),
+              std::string::npos)
+        << name;
+  }
+  ASSERT_EQ(text.find("\"len\""), std::string::npos);
+  std::filesystem::remove(file);
+}
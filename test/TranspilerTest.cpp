@@ -0,0 +1,176 @@
+#include "lib/Transpiler.hpp"
+#include "lib/Ast.hpp"
+#include "lib/Parser.hpp"
+#include "lib/Program.hpp"
+#include "lib/Runtime.hpp"
+#include "lib/Scanner.hpp"
+#include "lib/Session.hpp"
+#include "gtest/gtest.h"
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+
+// Set by the build like for loxc, see tools/Loxc.cpp
+#ifndef LOXC_CXXFLAGS
+#define LOXC_CXXFLAGS ""
+#endif
+#ifndef LOXC_LIBS
+#define LOXC_LIBS ""
+#endif
+
+using namespace loxlang;
+
+namespace {
+
+std::optional<std::string> translate(std::string_view text) {
+  Program p = Program("TranspilerTest", text);
+  scan::Scanner s = scan::Scanner(p);
+  auto ast = parse::parse(p, s);
+  if (ast == nullptr) {
+    return std::nullopt;
+  }
+  return transpile::transpile(p, ast.get(), "TranspilerTest");
+}
+
+bool contains(const std::string &code, std::string_view part) {
+  return code.find(part) != std::string::npos;
+}
+
+/**
+ * @brief Compile generated code and run it.
+ * @return What the program printed, or `std::nullopt` if it did not compile
+ */
+std::optional<std::string> compileAndRun(const std::string &code) {
+  std::filesystem::path dir =
+      std::filesystem::temp_directory_path() /
+      ("loxlang-transpiler-" + std::to_string(getpid()));
+  std::filesystem::create_directories(dir);
+  std::filesystem::path source = dir / "script.cpp";
+  std::filesystem::path program = dir / "script";
+  std::ofstream(source) << code;
+
+  const char *cxx = std::getenv("CXX");
+  std::string command =
+      std::format("{} {} {} -o {} {}", cxx != nullptr ? cxx : "c++",
+                  LOXC_CXXFLAGS, source.string(), program.string(), LOXC_LIBS);
+  std::optional<std::string> output = std::nullopt;
+  if (std::system(command.c_str()) == 0) {
+    FILE *pipe = popen(program.c_str(), "r");
+    std::string text;
+    std::array<char, 256> buffer{};
+    while (std::size_t n = std::fread(buffer.data(), 1, buffer.size(), pipe)) {
+      text.append(buffer.data(), n);
+    }
+    pclose(pipe);
+    output = std::move(text);
+  }
+  std::filesystem::remove_all(dir);
+  return output;
+}
+
+} // namespace
+
+TEST(Transpiler, InfersNumbers) {
+  auto code = translate("x = 1 + 2 * -x");
+  ASSERT_TRUE(code.has_value());
+  EXPECT_TRUE(contains(*code, "std::optional<double> g_x;"));
+  EXPECT_FALSE(contains(*code, "rt.number"));
+  EXPECT_FALSE(contains(*code, "rt.add"));
+}
+
+TEST(Transpiler, FallsBackToValues) {
+  auto code = translate(R"LOX(x = (x = 1) + "one")LOX");
+  ASSERT_TRUE(code.has_value());
+  EXPECT_TRUE(contains(*code, "std::optional<Value> g_x;"));
+
+  // only assigned each other
+  code = translate("x = y = x");
+  ASSERT_TRUE(code.has_value());
+  EXPECT_TRUE(contains(*code, "std::optional<Value> g_x;"));
+  EXPECT_TRUE(contains(*code, "std::optional<Value> g_y;"));
+
+  code = translate("b = x < 1 == !y");
+  ASSERT_TRUE(code.has_value());
+  EXPECT_TRUE(contains(*code, "std::optional<bool> g_b;"));
+  EXPECT_TRUE(contains(*code, "rt.number("));
+}
+
+TEST(Transpiler, LongOperatorChains) {
+  std::string text = "x = 0";
+  for (int i = 0; i < 100000; ++i) {
+    text += " - 1";
+  }
+  auto code = translate(text);
+  ASSERT_TRUE(code.has_value());
+  EXPECT_TRUE(contains(*code, "std::optional<double> g_x;"));
+}
+
+TEST(Transpiler, NumbersThatAreNotLiteralsInCpp) {
+  constexpr double inf = std::numeric_limits<double>::infinity();
+  Program p = Program("TranspilerTest", "1");
+  for (auto [number, expected] :
+       {std::pair{inf, "std::numeric_limits<double>::infinity()"},
+        std::pair{-inf, "(-std::numeric_limits<double>::infinity())"},
+        std::pair{std::nan(""), "std::numeric_limits<double>::quiet_NaN()"},
+        std::pair{-2.5, "(-2.5)"}}) {
+    auto negated = std::make_unique<ast::Unary>(
+        scan::Token(scan::Token::Type::Minus, "-"),
+        std::make_unique<ast::Literal>(
+            scan::Token(scan::Token::Type::Number, "1"), Value(number)));
+    auto code = transpile::transpile(p, negated.get(), "TranspilerTest");
+    ASSERT_TRUE(code.has_value());
+    EXPECT_TRUE(contains(*code, std::format("-{};", expected))) << expected;
+  }
+}
+
+TEST(Transpiler, CompiledProgramsMatchTheInterpreter) {
+  if (std::string_view(LOXC_LIBS).empty()) {
+    GTEST_SKIP() << "the build does not say how to link generated code";
+  }
+  std::string_view text =
+      R"LOX({"sum": (x = 0.1) + 0.2, "concat": "con" + "cat", "inf": -1 / 0,
+             "cmp": x < 1 == !nil, "eq": "a" == 1, "len": len(array(3)),
+             "index": range(5)[3], "product": x * -x, "big": 4294967296 * 4294967296})LOX";
+  Session session;
+  std::optional<Value> value = session.eval(text);
+  ASSERT_TRUE(value.has_value());
+  std::string expected;
+  format(expected, *value);
+  expected += '\n';
+
+  auto code = translate(text);
+  ASSERT_TRUE(code.has_value());
+  ASSERT_EQ(compileAndRun(*code), expected);
+}
+
+TEST(Transpiler, RejectsNativesOfTheInterpreter) {
+  ASSERT_TRUE(translate("println(len(array(2)))").has_value());
+  ASSERT_EQ(translate(R"LOX(join(spawn("1")))LOX"), std::nullopt);
+  ASSERT_EQ(translate("1 = 2"), std::nullopt);
+}
+
+TEST(Transpiler, RuntimeChecksLikeTheInterpreter) {
+  std::string_view text = R"LOX(m["a"] + 1)LOX";
+  aot::Runtime rt("RuntimeTest", text, Value());
+  Value map = rt.buildMap(std::array<Value, 2>{Value(std::string("a")),
+                                              Value(1.0)},
+                          aot::Location{1, 1});
+  Value one = rt.getIndex(map, Value(std::string("a")), aot::Location{1, 1});
+  ASSERT_EQ(rt.add(one, Value(1.0), aot::Location{7, 1}), Value(2.0));
+  ASSERT_EQ(rt.getIndex(map, Value(2.0), aot::Location{1, 1}), Value());
+  ASSERT_THROW(rt.add(map, Value(1.0), aot::Location{7, 1}),
+               aot::RuntimeError);
+  ASSERT_THROW(rt.getIndex(one, one, aot::Location{1, 1}), aot::RuntimeError);
+  ASSERT_THROW(rt.call(rt.native("nothing"), {}, aot::Location{0, 1}),
+               aot::RuntimeError);
+}
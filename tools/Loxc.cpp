@@ -0,0 +1,67 @@
+#include "lib/LoxLang.hpp"
+#include <cstdlib>
+#include <format>
+#include <string>
+#include <string_view>
+
+// Set by the build, so that loxc can compile the code it generates against
+// the same headers and library.
+#ifndef LOXC_CXXFLAGS
+#define LOXC_CXXFLAGS ""
+#endif
+#ifndef LOXC_LIBS
+#define LOXC_LIBS ""
+#endif
+
+namespace {
+
+std::string shellQuote(std::string_view arg) {
+  std::string quoted = "'";
+  for (char c : arg) {
+    if (c == '\'') {
+      quoted += "'\\''";
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted += "'";
+}
+
+std::string_view environment(const char *name, std::string_view fallback) {
+  const char *value = std::getenv(name);
+  return value != nullptr ? value : fallback;
+}
+
+} // namespace
+
+int main(int argc, char const *argv[]) {
+  loxlang::Output &out = loxlang::Output::standard();
+  if (argc == 3) {
+    return loxlang::transpileFile(argv[1], argv[2]) ? 0 : 1;
+  }
+  if (argc == 4 && std::string_view(argv[2]) == "-o") {
+    std::string source = std::string(argv[3]) + ".cpp";
+    if (!loxlang::transpileFile(argv[1], source)) {
+      return 1;
+    }
+    if (std::string_view(LOXC_LIBS).empty()) {
+      out.println("loxc does not know where the lox library is; compile {} "
+                  "and link it with the library yourself",
+                  source);
+      return 1;
+    }
+    std::string command = std::format(
+        "{} {} {} {} -o {} {}", environment("CXX", "c++"), LOXC_CXXFLAGS,
+        environment("CXXFLAGS", "-O2"), shellQuote(source),
+        shellQuote(argv[3]), LOXC_LIBS);
+    out.flush();
+    return std::system(command.c_str()) == 0 ? 0 : 1;
+  }
+
+  out.println("Usage: {} <script> <output.cpp>", argv[0]);
+  out.println("           -- translate a script to C++");
+  out.println("       {} <script> -o <executable>", argv[0]);
+  out.println("           -- compile a script to a native executable, with");
+  out.println("              $CXX and $CXXFLAGS (default: c++ -O2)");
+  return 1;
+}
@@ -1,13 +1,102 @@
 #include "lib/LoxLang.hpp"
-#include <print>
+#include "lib/Trace.hpp"
+#include <charconv>
+#include <fstream>
+#include <string_view>
+#include <vector>
 
 int main(int argc, char const *argv[]) {
-  if (argc == 1) {
+  loxlang::Output &out = loxlang::Output::standard();
+  constexpr std::string_view tracePrefix = "--trace=";
+  bool tracing =
+      argc >= 2 && std::string_view(argv[1]).starts_with(tracePrefix);
+  if (tracing) {
+    std::string_view file =
+        std::string_view(argv[1]).substr(tracePrefix.size());
+    if (!loxlang::trace::start(file)) {
+      out.println("cannot write trace {}", file);
+      return 1;
+    }
+    argv[1] = argv[0];
+    ++argv;
+    --argc;
+  }
+
+  constexpr std::string_view flushPrefix = "--flush=";
+  if (argc >= 2 && std::string_view(argv[1]).starts_with(flushPrefix)) {
+    std::string_view policy =
+        std::string_view(argv[1]).substr(flushPrefix.size());
+    if (policy == "line") {
+      loxlang::setFlushPolicy(loxlang::FlushPolicy::Line);
+    } else if (policy == "full") {
+      loxlang::setFlushPolicy(loxlang::FlushPolicy::Full);
+    } else if (policy == "exit") {
+      loxlang::setFlushPolicy(loxlang::FlushPolicy::Exit);
+    } else {
+      out.println("unknown flush policy {}", policy);
+      return 1;
+    }
+    argv[1] = argv[0];
+    ++argv;
+    --argc;
+  }
+
+  int status = 0;
+  std::size_t threads = 0;
+  if (argc >= 4 && std::string_view(argv[1]) == "--pool" &&
+      std::from_chars(argv[2], argv[2] + std::string_view(argv[2]).size(),
+                      threads)
+              .ec == std::errc()) {
+    std::vector<std::string_view> files(argv + 3, argv + argc);
+    loxlang::runFiles(files, threads);
+  } else if (argc == 4 && std::string_view(argv[1]) == "--snapshot") {
+    loxlang::makeSnapshot(argv[3], argv[2]);
+  } else if (argc == 4 && std::string_view(argv[1]) == "--boot") {
+    loxlang::runFileWithSnapshot(argv[2], argv[3]);
+  } else if (argc == 3 && std::string_view(argv[1]) == "--daemon") {
+    loxlang::runDaemon(argv[2]);
+  } else if (argc >= 4 && std::string_view(argv[1]) == "--client") {
+    std::vector<std::string_view> args(argv + 3, argv + argc);
+    status = loxlang::runClient(argv[2], args);
+  } else if (argc == 3 && std::string_view(argv[1]) == "--check") {
+    status = loxlang::checkFile(argv[2]) ? 0 : 1;
+  } else if (argc == 3 && std::string_view(argv[1]) == "--debug") {
+    loxlang::debugFile(argv[2]);
+  } else if (argc == 4 && std::string_view(argv[1]) == "--trace-json") {
+    std::ofstream json(argv[3]);
+    if (!loxlang::trace::toChromeJson(argv[2], json)) {
+      out.println("{} is not a valid trace", argv[2]);
+    }
+  } else if (argc == 1) {
     loxlang::runPrompt();
   } else if (argc == 2) {
     loxlang::runFile(argv[1]);
   } else {
-    std::println("Usage: {}             -- start a interactive shell", argv[0]);
-    std::println("       {} <script>    -- execute a script file", argv[0]);
+    out.println("Usage: {}             -- start a interactive shell", argv[0]);
+    out.println("       {} <script>    -- execute a script file", argv[0]);
+    out.println("       {} --pool <threads> <script>...", argv[0]);
+    out.println("           -- execute many script files concurrently");
+    out.println("       {} --snapshot <snapshot> <prelude>", argv[0]);
+    out.println("           -- save the globals of a prelude to a snapshot");
+    out.println("       {} --boot <snapshot> <script>", argv[0]);
+    out.println("           -- execute a script starting from a snapshot");
+    out.println("       {} --daemon <socket>", argv[0]);
+    out.println("           -- serve script runs, keeping compiled code");
+    out.println("       {} --client <socket> <script> <arg>...", argv[0]);
+    out.println("           -- execute a script on a daemon");
+    out.println("       {} --check <script>|-", argv[0]);
+    out.println("           -- check the tokens of a script of any size");
+    out.println("       {} --debug <script>", argv[0]);
+    out.println("           -- execute a script in the debugger");
+    out.println("       {} --trace-json <trace> <json>", argv[0]);
+    out.println("           -- convert a trace to Chrome's trace format");
+    out.println("Prefix any command with --trace=<file> to record a trace,");
+    out.println("and then with --flush=line|full|exit to choose when output");
+    out.println("is written.");
+  }
+
+  if (tracing) {
+    loxlang::trace::stop();
   }
+  return status;
 }